@@ -9,34 +9,179 @@
 // Network Configuration
 #define WIFI_SSID "GL"
 #define WIFI_PASSWORD "98754321"
-#define WIFI_CONNECTION_TIMEOUT 30000 // 30 seconds
-#define WIFI_RETRY_DELAY 500
+#define WIFI_CONNECTION_TIMEOUT 30000 // 30 seconds per connection attempt
+#define WIFI_FAST_CONNECT_TIMEOUT 3000 // Cached BSSID/channel/IP attempt before full connect
+#define WIFI_BACKOFF_MIN_MS 1000      // First delay after a failed attempt
+#define WIFI_BACKOFF_MAX_MS 60000     // Backoff doubles up to this limit
 
 // Timing Configuration
 #define SENSOR_READ_INTERVAL 10000    // 10 seconds between readings
 #define WIFI_SCAN_INTERVAL 10000      // 10 seconds between WiFi scans
 #define SERIAL_BAUD_RATE 115200
 
+// Task Runtime Configuration
+#define SENSOR_TASK_CORE 1            // GPS parsing and power detection
+#define NETWORK_TASK_CORE 0           // WiFi, scanning and uploads (shares core with WiFi stack)
+#define SENSOR_TASK_PRIORITY 3
+#define NETWORK_TASK_PRIORITY 2
+#define SENSOR_TASK_STACK_SIZE 5120    // Status dumps (float printf) are the deepest path; check "t"
+#define NETWORK_TASK_STACK_SIZE 8192
+#define SENSOR_TASK_PERIOD_MS 10      // Sensor polling period
+#define NETWORK_TASK_IDLE_MS 250      // Network task wakes at least this often
+#define SAMPLE_QUEUE_CAPACITY 8       // Sensor -> network queue slots (power of two)
+
 // GPS Configuration
 #define GPS_BAUDRATE 9600             // Default NEO-6M GPS module baud rate
 #define GPS_TIMEOUT_MS 30000          // 30 seconds timeout for GPS data
 #define GPS_UPDATE_INTERVAL 1000      // 1 second between GPS updates
+#define GPS_RX_BUFFER_SIZE 4096       // UART RX buffer, ~4 s of NMEA at 9600 baud
+#define GPS_READER_TASK true          // Parse in a task woken by UART events (false = poll from the sensor task)
+#define GPS_TASK_PRIORITY 4           // Above the sensor task so bursts are drained promptly
+#define GPS_TASK_STACK_SIZE 4096
+#define GPS_READER_IDLE_MS 100        // Reader wakes at least this often without a UART event
+#define GPS_PROTOCOL_NMEA 0           // NMEA GGA/RMC parsed by TinyGPS++ (any receiver, incl. NEO-6M)
+#define GPS_PROTOCOL_UBX 1            // Binary UBX NAV-PVT (u-blox 7/M8 and later)
+#define GPS_PROTOCOL GPS_PROTOCOL_NMEA
+#define GPS_UBX_CONFIG true           // Configure the u-blox receiver at startup (baud, nav rate, sentences)
+#define GPS_TARGET_BAUDRATE 38400     // Baud rate requested with CFG-PRT (falls back to GPS_BAUDRATE)
+#define GPS_NAV_RATE_HZ 5             // Navigation solutions per second (NEO-6M: 1-5)
+#define GPS_ACK_TIMEOUT_MS 250        // Wait for a UBX ACK/NAK
+#define GPS_WARM_START true           // Keep the last fix in RTC/NVS and send it as UBX AID-INI at boot
+#define GPS_WARM_START_SAVE_MS 900000 // NVS copy of the last fix at most every 15 min (flash wear)
+#define GPS_AID_POSITION_ACC_M 1000   // Accuracy claimed for the saved position (unit may have moved)
+#define GPS_AID_TIME_ACC_MS 2000      // Accuracy claimed for the system clock kept across soft resets
+#define GPS_AID_FILE "/gps_aid.ubx"   // Optional pre-framed UBX aiding (AID-EPH/ALM/ALP) sent at boot
+
+// Position Filter
+#define POSITION_FILTER_ENABLED true    // Kalman-filter fixes; filtered position reported alongside the raw one
+#define POSITION_FILTER_ACCEL_MS2 0.5f  // Process noise: expected acceleration (m/s^2)
+#define POSITION_FILTER_UERE_M 5.0f     // Range error per unit HDOP (NMEA sigma = HDOP x UERE)
+#define POSITION_FILTER_REF_SATS 6      // Fewer satellites inflate the measurement sigma
+#define POSITION_FILTER_MIN_SATS 4      // Fixes with fewer satellites are not used
+#define POSITION_FILTER_GATE 9.21f      // Innovation gate (chi-square, 2 DoF, 99%)
+#define POSITION_FILTER_MAX_REJECTS 5   // Consecutive outliers before restarting on the fix
+#define POSITION_FILTER_RESET_MS 10000  // Fix gap after which the filter restarts
+
+// Motion Detection
+#define MOTION_DUTY_CYCLE true          // Power-save the receiver and stretch location reports while parked
+#define MOTION_PARKED_SPEED_MMS 500     // Slower than this counts as standing still
+#define MOTION_MOVING_SPEED_MMS 1500    // Faster than this ends parking at once
+#define MOTION_ANCHOR_RADIUS_M 25       // Leaving this radius around the parking spot ends parking
+#define MOTION_PARKED_HOLD_MS 120000    // Standing still this long before parking
+#define MOTION_PARKED_OUTPUT_DIVIDER 5  // While parked: one fix output per N solutions (1 Hz)
+#define MOTION_PARKED_REPORT_MS 300000  // While parked: location reported at most this often
 
 // Optocoupler Configuration
 #define OPTOCOUPLER_PIN 34         // GPIO pin connected to optocoupler output
 #define OPTOCOUPLER_ACTIVE_LOW true   // Optocoupler output is active low
 #define OPTOCOUPLER_DEBOUNCE_MS 50    // Debounce time for power state changes
 #define OPTOCOUPLER_STABLE_TIME 5000  // Time to consider power state stable (5 seconds)
+#define OPTOCOUPLER_EDGE_CAPTURE true // Timestamp edges in a GPIO interrupt (false = poll the pin)
+#define OPTOCOUPLER_EDGE_QUEUE_SIZE 64  // Edge ring slots between ISR and consumer (power of two)
+#define OPTOCOUPLER_GLITCH_US 1000    // Pulses shorter than this are counted as glitches, not bounces
+
+// AC Mains Monitoring (optocoupler driven from the mains waveform)
+#define OPTOCOUPLER_AC_MAINS false    // Count mains pulses with PCNT instead of reading a DC level
+#define MAINS_NOMINAL_HZ 50           // Nominal line frequency (50 or 60)
+#define MAINS_PULSES_PER_CYCLE 1      // 1 = half-wave, 2 = full-wave (bridge) optocoupler input
+#define MAINS_PCNT_LIMIT 100          // Pulses per frequency measurement (hardware counter wrap)
+#define MAINS_WINDOW_MS 100           // Sag detection window
+#define MAINS_SAG_MISSING_CYCLES 2    // Cycles missing from a window to count a sag
+#define MAINS_DROPOUT_MS 100          // No pulses for this long means power is lost
+
+// Line Voltage Sampling (continuous ADC DMA)
+#define VOLTAGE_MONITOR_ENABLED false // Sample the line voltage through a divider/transformer
+#define VOLTAGE_ADC_CHANNEL ADC1_CHANNEL_7  // GPIO35 (ADC1 only - ADC2 is used by WiFi)
+#define VOLTAGE_SAMPLE_RATE_HZ 20000  // DMA sample rate; one frame holds one nominal cycle
+#define VOLTAGE_WINDOW_CYCLES 10      // Cycles per published RMS value
+#define VOLTAGE_CAL_MV_PER_COUNT 217  // Line millivolts per ADC count (calibrate per front end)
+#define VOLTAGE_NOMINAL_MV 230000     // Nominal line RMS voltage
+#define VOLTAGE_SAG_PERCENT 90        // Cycle RMS below this % of nominal starts a sag
+#define VOLTAGE_SWELL_PERCENT 110     // Cycle RMS above this % of nominal starts a swell
+#define VOLTAGE_HYSTERESIS_PERCENT 2  // Margin back inside the band that ends a sag/swell
+#define VOLTAGE_DMA_FRAMES 4          // Frames buffered by the ADC DMA driver
+#define VOLTAGE_TASK_PRIORITY 4       // Above the sensor task so DMA frames are never starved
+#define VOLTAGE_TASK_STACK_SIZE 3072
+
+// Multi-channel Power Detection
+#define POWER_CHANNELS_ENABLED false  // Watch POWER_CHANNEL_PINS besides the main optocoupler
+#define POWER_CHANNEL_PINS { 25, 26, 27, 32, 33, 36, 39 }  // One GPIO per monitored circuit (not the voltage ADC pin)
+#define POWER_CHANNEL_ACTIVE_LOW true // Channel optocouplers are active low
+#define POWER_CHANNEL_MAX 16          // Channel slots (debounce: 4 sensor task periods)
+
+// Outage Log Configuration
+#define OUTAGE_LOG_SIZE 32            // Completed outages kept in the event ring
+#define OUTAGE_WINDOW_BUCKETS 12      // Time buckets per rolling window (minute/hour/day)
+#define OUTAGE_FLICKER_MAX_MS 1000    // Outages shorter than this count as flickers
+#define OUTAGE_LOG_PRINT_COUNT 5      // Recent outages listed on the serial console
+
+// Geofences (loaded from LittleFS, evaluated on every GPS solution)
+#define GEOFENCE_ENABLED true         // Enter/exit/dwell events from GEOFENCE_FILE
+#define GEOFENCE_FILE "/geofences.txt"
+#define GEOFENCE_MAX_FENCES 256
+#define GEOFENCE_MAX_VERTICES 2048    // Polygon vertices of all fences together
+#define GEOFENCE_GRID_SIZE 16         // Index cells per side over the fences' bounding box
+#define GEOFENCE_MAX_CELL_ENTRIES 2048  // Fence references held by the grid index
+#define GEOFENCE_CONFIRM_FIXES 3      // Consecutive fixes that confirm an enter or exit
+#define GEOFENCE_MAX_TRACKED 16       // Fences a position can be inside (or entering) at once
+#define GEOFENCE_EVENT_QUEUE 16       // Events waiting for a sample
+#define GEOFENCE_EVENTS_PER_SAMPLE 4
+
+// Track Recorder (route between samples, simplified on the device)
+#define TRACK_ENABLED true            // Send the route since the last sample as an encoded polyline
+#define TRACK_TOLERANCE_M 5           // Douglas-Peucker error bound
+#define TRACK_WINDOW_FIXES 128        // Fixes buffered between samples (25 s at 5 Hz)
+#define TRACK_MAX_VERTICES 24         // Vertices per sample; the tolerance widens beyond this
+
+// WiFi Fingerprint Location (learned while GPS is valid, used when it is not)
+#define WIFI_FINGERPRINT_ENABLED true // Estimate the position from the scan table without a GPS fix
+#define WIFI_FP_FILE "/wifi_fp.bin"
+#define WIFI_FP_MAX_RECORDS 256       // Flash slots (~20 KB); the RAM index takes ~7 KB
+#define WIFI_FP_APS 8                 // Strongest access points kept per fingerprint
+#define WIFI_FP_MIN_APS 3             // Fewer visible access points are neither learned nor matched
+#define WIFI_FP_SPACING_M 25          // A new fingerprint this close to an old one replaces it
+#define WIFI_FP_LEARN_INTERVAL_MS 30000  // Fingerprints are written at most this often
+#define WIFI_FP_LEARN_ACCURACY_M 20   // Filtered GPS uncertainty required for learning
+#define WIFI_FP_MIN_COMMON 2          // Shared access points that make a fingerprint a candidate
+#define WIFI_FP_CANDIDATES 8          // Candidates read from flash per lookup
+#define WIFI_FP_K 3                   // Nearest fingerprints averaged into the estimate
+#define WIFI_FP_MISSING_RSSI -100     // RSSI assumed for an access point only one side saw
 
 // Data Configuration
-#define JSON_BUFFER_SIZE 1024
 #define MAX_WIFI_NETWORKS 20
+#define WIFI_SCAN_TABLE_SIZE MAX_WIFI_NETWORKS  // Preallocated BSSID table slots
+#define WIFI_RSSI_CHANGE_THRESHOLD 6  // dB change reported as an RSSI diff
+#define WIFI_NETWORK_EXPIRY_MS 30000  // Unseen networks are dropped after this time
 #define DEFAULT_LATITUDE 52.5200
 #define DEFAULT_LONGITUDE 13.4050
 
+// Sample Journal Configuration (LittleFS store-and-forward)
+#define SAMPLE_JOURNAL_DIR "/journal"
+#define SAMPLE_JOURNAL_SEGMENT_RECORDS 64    // Records per segment file
+#define SAMPLE_JOURNAL_MAX_SEGMENTS 32       // Oldest segment is dropped beyond this (~5.6 h at 10 s)
+#define SAMPLE_JOURNAL_CURSOR_INTERVAL 16    // Persist read position every N delivered records
+
+// Upload Batching Configuration (one multi-location PATCH per batch)
+#define UPLOAD_BATCH_MAX_SAMPLES 6           // Flush after this many samples (1 = no batching)
+#define UPLOAD_BATCH_MAX_AGE_MS 60000        // Flush when the oldest sample has waited this long
+#define UPLOAD_BATCH_MAX_BYTES 12288         // Flush when the encoded batch reaches this size
+
+// Report-by-exception Configuration (only changed field groups are uploaded)
+#define REPORT_BY_EXCEPTION true             // false = upload every field of every sample
+#define REPORT_HEARTBEAT_MS 300000           // Full report at least this often (5 minutes)
+#define REPORT_LOCATION_DEADBAND_M 25        // Movement needed to report a new location
+
+// Payload Encoding (PAYLOAD_ENCODING_JSON or PAYLOAD_ENCODING_COMPACT, toggled with 'c')
+#define FIREBASE_PAYLOAD_ENCODING PAYLOAD_ENCODING_JSON
+
 // HTTP Configuration
 #define HTTP_TIMEOUT 15000        // 15 seconds timeout for HTTP requests
 #define HTTP_MAX_RETRIES 3        // Maximum number of HTTP retry attempts
+#define HTTPS_KEEPALIVE_IDLE_MS 50000   // Reconnect instead of reusing a socket idle this long
+#define HTTPS_DNS_CACHE_TTL_MS 300000   // Resolved host address is reused for 5 minutes
+#define HTTPS_DRAIN_BUFFER_SIZE 128     // Stack scratch buffer for discarding response bodies
+#define HTTPS_WRITE_BUFFER_SIZE 512     // Stack buffer for streamed request bodies (one TLS record per flush)
+#define HTTPS_ERROR_BODY_SIZE 160       // Start of a non-2xx response body kept for the log
 
 // Debug Configuration
 #ifdef DEBUG
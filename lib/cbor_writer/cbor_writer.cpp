@@ -0,0 +1,123 @@
+#include "cbor_writer.h"
+
+// Major types (RFC 8949 section 3.1)
+#define CBOR_UNSIGNED   0
+#define CBOR_NEGATIVE   1
+#define CBOR_BYTES      2
+#define CBOR_TEXT       3
+#define CBOR_ARRAY      4
+#define CBOR_MAP        5
+#define CBOR_SIMPLE     7
+
+#define CBOR_INDEFINITE 31
+#define CBOR_FALSE      0xF4
+#define CBOR_TRUE       0xF5
+#define CBOR_BREAK      0xFF
+
+CborWriter::CborWriter(Print& output) : out(output) {
+}
+
+void CborWriter::writeHead(uint8_t majorType, uint64_t value) {
+    uint8_t head[9];
+    size_t length;
+    
+    if (value < 24) {
+        head[0] = (majorType << 5) | (uint8_t)value;
+        length = 1;
+    } else if (value <= 0xFF) {
+        head[0] = (majorType << 5) | 24;
+        head[1] = (uint8_t)value;
+        length = 2;
+    } else if (value <= 0xFFFF) {
+        head[0] = (majorType << 5) | 25;
+        head[1] = (uint8_t)(value >> 8);
+        head[2] = (uint8_t)value;
+        length = 3;
+    } else if (value <= 0xFFFFFFFFULL) {
+        head[0] = (majorType << 5) | 26;
+        for (int i = 0; i < 4; i++) {
+            head[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+        }
+        length = 5;
+    } else {
+        head[0] = (majorType << 5) | 27;
+        for (int i = 0; i < 8; i++) {
+            head[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+        }
+        length = 9;
+    }
+    
+    out.write(head, length);
+}
+
+void CborWriter::beginMap() {
+    out.write((uint8_t)((CBOR_MAP << 5) | CBOR_INDEFINITE));
+}
+
+void CborWriter::beginArray() {
+    out.write((uint8_t)((CBOR_ARRAY << 5) | CBOR_INDEFINITE));
+}
+
+void CborWriter::end() {
+    out.write((uint8_t)CBOR_BREAK);
+}
+
+void CborWriter::addInt(int64_t value) {
+    if (value >= 0) {
+        writeHead(CBOR_UNSIGNED, (uint64_t)value);
+    } else {
+        // Negative n is encoded as -1 - n
+        writeHead(CBOR_NEGATIVE, (uint64_t)(-1 - value));
+    }
+}
+
+void CborWriter::addBool(bool value) {
+    out.write((uint8_t)(value ? CBOR_TRUE : CBOR_FALSE));
+}
+
+void CborWriter::addText(const char* value) {
+    size_t length = strlen(value);
+    writeHead(CBOR_TEXT, length);
+    out.write((const uint8_t*)value, length);
+}
+
+void CborWriter::addBytes(const uint8_t* data, size_t length) {
+    writeHead(CBOR_BYTES, length);
+    out.write(data, length);
+}
+
+static const char BASE64_ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+Base64Print::Base64Print(Print& output) : out(output) {
+    pendingCount = 0;
+}
+
+void Base64Print::emit(uint8_t count) {
+    uint32_t group = ((uint32_t)pending[0] << 16) |
+                     ((uint32_t)(count > 1 ? pending[1] : 0) << 8) |
+                     (count > 2 ? pending[2] : 0);
+    
+    uint8_t encoded[4];
+    encoded[0] = BASE64_ALPHABET[(group >> 18) & 0x3F];
+    encoded[1] = BASE64_ALPHABET[(group >> 12) & 0x3F];
+    encoded[2] = count > 1 ? BASE64_ALPHABET[(group >> 6) & 0x3F] : '=';
+    encoded[3] = count > 2 ? BASE64_ALPHABET[group & 0x3F] : '=';
+    out.write(encoded, 4);
+    
+    pendingCount = 0;
+}
+
+size_t Base64Print::write(uint8_t c) {
+    pending[pendingCount++] = c;
+    if (pendingCount == 3) {
+        emit(3);
+    }
+    return 1;
+}
+
+void Base64Print::finish() {
+    if (pendingCount > 0) {
+        emit(pendingCount);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <Arduino.h>
+
+/**
+ * CborWriter Class
+ *
+ * Forward-only CBOR (RFC 8949) encoder that writes straight to a Print sink.
+ * Maps and arrays use indefinite length so no element counts are needed up
+ * front. Integers always take the shortest encoding, which is what makes
+ * integer field IDs and scaled fixed-point values cheap on the wire.
+ */
+class CborWriter {
+private:
+    Print& out;
+    
+    void writeHead(uint8_t majorType, uint64_t value);
+
+public:
+    /**
+     * Constructor
+     * @param output sink receiving the encoded bytes
+     */
+    CborWriter(Print& output);
+    
+    /**
+     * Open an indefinite-length map (close with end())
+     */
+    void beginMap();
+    
+    /**
+     * Open an indefinite-length array (close with end())
+     */
+    void beginArray();
+    
+    /**
+     * Close the innermost map or array
+     */
+    void end();
+    
+    /**
+     * Write an integer (used for both field IDs and values)
+     * @param value value to encode
+     */
+    void addInt(int64_t value);
+    
+    /**
+     * Write a boolean
+     * @param value value to encode
+     */
+    void addBool(bool value);
+    
+    /**
+     * Write a UTF-8 text string
+     * @param value NUL-terminated string
+     */
+    void addText(const char* value);
+    
+    /**
+     * Write a byte string
+     * @param data bytes to encode
+     * @param length number of bytes
+     */
+    void addBytes(const uint8_t* data, size_t length);
+};
+
+/**
+ * Base64Print Class
+ *
+ * Print adapter that base64-encodes everything written to it into another
+ * sink (RFC 4648, with padding). Call finish() after the last byte.
+ */
+class Base64Print : public Print {
+private:
+    Print& out;
+    uint8_t pending[3];
+    uint8_t pendingCount;
+    
+    void emit(uint8_t count);
+
+public:
+    Base64Print(Print& output);
+    size_t write(uint8_t c) override;
+    void finish();
+};
+
+#endif // CBOR_WRITER_H
@@ -2,164 +2,766 @@
 #include "config.h"
 #include "firebase-config.h"
 #include "wifi_manager.h"
-#include "gps_manager.h"
-#include "optocoupler_manager.h"
+#include "sample_journal.h"
 
 FirebaseClient::FirebaseClient() {
+    journal = nullptr;
+    memset(&context, 0, sizeof(context));
+    pendingBatch = nullptr;
+    pendingWifi = nullptr;
+    encoding = FIREBASE_PAYLOAD_ENCODING;
+    memset(&lastSample, 0, sizeof(lastSample));
+    lastSampleWifi = nullptr;
+    hasLastSample = false;
+    deviceId[0] = '\0';
+    batchesSent = 0;
+    lastBatchSamples = 0;
+    lastBatchBytes = 0;
+    lastBatchLatency = 0;
 }
 
 bool FirebaseClient::begin() {
+    if (!connection.begin(FIREBASE_HOST)) {
+        return false;
+    }
+    
+    uint64_t mac = ESP.getEfuseMac();
+    snprintf(deviceId, sizeof(deviceId), "%04X%08X",
+             (unsigned)((mac >> 32) & 0xFFFF), (unsigned)(mac & 0xFFFFFFFF));
+    
     DEBUG_PRINTLN("Firebase client initialized");
     
     return true;
 }
 
-String FirebaseClient::constructURL() {
-    return String("https://") + FIREBASE_HOST + "/iot-data.json?auth=" + FIREBASE_AUTH;
+// Request path is a compile-time constant - no per-request String building
+#define FIREBASE_DATA_PATH "/iot-data.json?auth=" FIREBASE_AUTH
+#define FIREBASE_COMPACT_PATH "/iot-data-compact.json?auth=" FIREBASE_AUTH
+
+void FirebaseClient::attachJournal(SampleJournal* sampleJournal) {
+    journal = sampleJournal;
+}
+
+void FirebaseClient::formatSampleKey(const SensorSample& sample, char* buffer, size_t size) {
+    // Deterministic per sample: re-sending after a lost response overwrites, never duplicates
+    snprintf(buffer, size, "%s-%05lu-%08lu", deviceId,
+             (unsigned long)sample.bootId, (unsigned long)sample.sequence);
+}
+
+void FirebaseClient::captureContext(WiFiManager* wifiMgr) {
+    memset(&context, 0, sizeof(context));
+    context.uptimeMs = millis();
+    context.wifiConnected = (wifiMgr && wifiMgr->isWiFiConnected());
+    context.hasWifi = (wifiMgr != nullptr);
+    if (wifiMgr) {
+        context.connectAttempts = wifiMgr->getConnectAttempts();
+        context.disconnects = wifiMgr->getDisconnectCount();
+        context.connectMs = wifiMgr->getLastConnectDuration();
+        context.connectFast = wifiMgr->wasLastConnectFast();
+        context.firstConnectMs = wifiMgr->getFirstConnectTime();
+    }
+    context.hasJournal = (journal != nullptr);
+    if (journal) {
+        context.journalPending = journal->getPendingCount();
+        context.journalDropped = journal->getDroppedCount();
+    }
+    // Timing of the previous upload (this one is still being built)
+    context.lastTiming = connection.getLastTiming();
+    context.handshakes = connection.getHandshakeCount();
 }
 
-String FirebaseClient::createJSONPayload(int networkCount, WiFiManager* wifiMgr, GPSManager* gpsMgr, OptocouplerManager* optocouplerMgr) {
-    StaticJsonDocument<JSON_BUFFER_SIZE> doc;
+void FirebaseClient::writeSample(JsonWriter& json, const char* key, const SensorSample& sample, uint8_t mask, WiFiManager* wifiMgr, bool replayed) {
+    json.beginObject(key);
     
     // Add timestamp (both epoch milliseconds and readable format)
-    doc["timestamp"] = millis();
-    doc["datetime"] = String(__DATE__) + " " + String(__TIME__);
-    
-    // Add external power data from optocoupler
-    JsonObject power = doc.createNestedObject("external_power");
-    if (optocouplerMgr) {
-        power["status"] = optocouplerMgr->getPowerStatusString();
-        power["status_boolean"] = optocouplerMgr->isPowerPresent();
-        power["stability"] = optocouplerMgr->getPowerStability();
-        power["time_since_change"] = optocouplerMgr->getTimeSinceLastChange();
-        power["state_changes"] = optocouplerMgr->getStateChangeCount();
-        power["total_on_time"] = optocouplerMgr->getTotalPowerOnTime();
-        power["total_off_time"] = optocouplerMgr->getTotalPowerOffTime();
-        power["last_power_on"] = optocouplerMgr->getLastPowerOnTime();
-        power["last_power_off"] = optocouplerMgr->getLastPowerOffTime();
-        
-        // Calculate uptime percentage
-        unsigned long totalTime = optocouplerMgr->getTotalPowerOnTime() + optocouplerMgr->getTotalPowerOffTime();
-        if (totalTime > 0) {
-            float uptime = (float)optocouplerMgr->getTotalPowerOnTime() / totalTime * 100.0;
-            power["uptime_percentage"] = uptime;
+    json.add("timestamp", (unsigned long)sample.timestampMs);
+    if (mask & REPORT_FIELD_SYSTEM) {
+        json.add("datetime", __DATE__ " " __TIME__);
+    }
+    
+    // Field groups carried by this sample (report-by-exception)
+    json.beginObject("report");
+    json.add("fields", (unsigned int)(mask & REPORT_FIELD_ALL));
+    json.add("heartbeat", (mask & REPORT_HEARTBEAT) != 0);
+    json.endObject();
+    
+    if (mask & REPORT_FIELD_POWER) {
+        // Add external power data from optocoupler
+        const PowerSnapshot& powerState = sample.power;
+        json.beginObject("external_power");
+        if (powerState.initialized) {
+            json.add("status", powerState.powerPresent ? "ON" : "OFF");
+            json.add("status_boolean", powerState.powerPresent);
+            json.add("stability", powerStabilityToString(powerState.stability));
+            json.add("time_since_change", powerState.timeSinceChange);
+            json.add("state_changes", powerState.stateChanges);
+            json.add("total_on_time", powerState.totalOnTime);
+            json.add("total_off_time", powerState.totalOffTime);
+            json.add("last_power_on", powerState.lastPowerOn);
+            json.add("last_power_off", powerState.lastPowerOff);
+            
+            // Rolling outage metrics (outages that ended inside each window)
+            json.beginObject("outages");
+            json.add("since_boot", powerState.outages.totalOutages);
+            for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+                const OutageWindowStats& window = powerState.outages.windows[i];
+                json.beginObject(outageWindowToString((OutageWindow)i));
+                json.add("count", window.count);
+                json.add("total_ms", window.totalMs);
+                json.add("longest_ms", window.longestMs);
+                json.add("mean_ms", window.count > 0 ? window.totalMs / window.count : 0);
+                json.add("flickers", window.flickers);
+                json.endObject();
+            }
+            json.endObject();
+            
+            // AC mains pulse-train analysis
+            const MainsSnapshot& mains = powerState.mains;
+            if (mains.enabled) {
+                json.beginObject("mains");
+                if (mains.frequencyMilliHz > 0) {
+                    json.add("frequency_hz", mains.frequencyMilliHz / 1000.0, 3);
+                } else {
+                    json.add("frequency_hz", (const char*)nullptr);
+                }
+                json.add("sags", mains.sagCount);
+                json.add("missing_cycles", mains.missingCycles);
+                json.add("dropouts", mains.dropoutCount);
+                json.add("last_dropout_ms", mains.lastDropoutMs);
+                json.add("longest_dropout_ms", mains.longestDropoutMs);
+                json.endObject();
+            }
+            
+            // Calculate uptime percentage
+            unsigned long totalTime = powerState.totalOnTime + powerState.totalOffTime;
+            if (totalTime > 0) {
+                float uptime = (float)powerState.totalOnTime / totalTime * 100.0;
+                json.add("uptime_percentage", uptime, 2);
+            } else {
+                json.add("uptime_percentage", 0.0, 2);
+            }
+            
+            char config[100];
+            snprintf(config, sizeof(config), "Pin=%d, ActiveLow=%s, Debounce=%lums",
+                     powerState.pin, powerState.activeLow ? "YES" : "NO", (unsigned long)powerState.debounceMs);
+            json.add("source", "OPTOCOUPLER");
+            json.add("config", config);
         } else {
-            power["uptime_percentage"] = 0.0;
+            json.add("status", "UNKNOWN");
+            json.add("status_boolean", false);
+            json.add("source", "NOT_INITIALIZED");
         }
         
-        power["source"] = "OPTOCOUPLER";
-        power["config"] = optocouplerMgr->getConfigInfo();
-    } else {
-        power["status"] = "UNKNOWN";
-        power["status_boolean"] = false;
-        power["source"] = "NOT_INITIALIZED";
+        // Line voltage aggregates; "value" is the RMS shown by the dashboard
+        const VoltageSnapshot& voltage = sample.voltage;
+        if (voltage.enabled) {
+            json.add("value", voltage.rmsMv / 1000.0, 1);
+            json.beginObject("voltage");
+            json.add("rms_v", voltage.rmsMv / 1000.0, 1);
+            json.add("min_rms_v", voltage.minRmsMv / 1000.0, 1);
+            json.add("max_rms_v", voltage.maxRmsMv / 1000.0, 1);
+            json.add("min_raw", (unsigned int)voltage.minRaw);
+            json.add("max_raw", (unsigned int)voltage.maxRaw);
+            json.add("sags", voltage.sagCount);
+            json.add("swells", voltage.swellCount);
+            json.add("last_event_ms", voltage.lastEventMs);
+            json.add("overruns", voltage.overruns);
+            json.endObject();
+        }
+        json.endObject();
     }
     
-    // Add system information
-    JsonObject system = doc.createNestedObject("system");
-    system["uptime_ms"] = millis();
-    system["free_heap"] = ESP.getFreeHeap();
-    system["wifi_connected"] = (wifiMgr && wifiMgr->isWiFiConnected());
-    
-    // Add location data - Use GPS if available, otherwise fallback to default
-    JsonObject location = doc.createNestedObject("location");
-    JsonObject gpsInfo = doc.createNestedObject("gps_info");
-    
-    if (gpsMgr && gpsMgr->isLocationValid()) {
-        // Use real GPS coordinates
-        location["lat"] = gpsMgr->getLatitude();
-        location["lng"] = gpsMgr->getLongitude();
-        location["source"] = "GPS";
+    // WiFi scan summary (the table itself follows after location)
+    bool withNetworks = (mask & REPORT_FIELD_NETWORKS) && wifiMgr && wifiMgr->getScanTable().size() > 0;
+    if (mask & REPORT_FIELD_SYSTEM) {
+        // Add system information
+        json.beginObject("system");
+        json.add("uptime_ms", (unsigned long)context.uptimeMs);
+        json.add("free_heap", (unsigned long)sample.freeHeap);
+        json.add("wifi_connected", context.wifiConnected);
+        if (context.hasWifi) {
+            json.add("wifi_connect_attempts", (unsigned long)context.connectAttempts);
+            json.add("wifi_disconnects", (unsigned long)context.disconnects);
+            json.add("wifi_connect_ms", (unsigned long)context.connectMs);
+            json.add("wifi_connect_fast", context.connectFast);
+            json.add("wifi_first_connect_ms", (unsigned long)context.firstConnectMs);
+        }
+        json.add("sample_sequence", (unsigned long)sample.sequence);
+        json.add("boot_id", (unsigned long)sample.bootId);
+        json.add("batch_samples", lastBatchSamples);
+        json.add("batch_bytes", (unsigned long)lastBatchBytes);
+        json.add("batch_latency_ms", (unsigned long)lastBatchLatency);
+        if (replayed) {
+            // Sent from the offline journal - uptime/WiFi fields describe the upload, not the sample
+            json.add("replayed", true);
+        }
+        if (context.hasJournal) {
+            json.add("journal_pending", (unsigned long)context.journalPending);
+            json.add("journal_dropped", (unsigned long)context.journalDropped);
+        }
         
-        // Add detailed GPS information
-        gpsInfo["altitude"] = gpsMgr->getAltitude();
-        gpsInfo["speed_kmh"] = gpsMgr->getSpeed();
-        gpsInfo["satellites"] = gpsMgr->getSatelliteCount();
-        gpsInfo["signal_quality"] = gpsMgr->getSignalQuality();
-        gpsInfo["gps_time"] = gpsMgr->getFormattedDateTime();
-        gpsInfo["time_since_update"] = gpsMgr->getTimeSinceLastUpdate();
-        gpsInfo["active"] = gpsMgr->isGPSActive();
-        gpsInfo["time_valid"] = gpsMgr->isTimeValid();
-    } else {
-        // Fallback to default coordinates
-        location["lat"] = DEFAULT_LATITUDE;
-        location["lng"] = DEFAULT_LONGITUDE;
-        location["source"] = "DEFAULT";
+        json.add("http_connect_ms", (unsigned long)context.lastTiming.connectMs);
+        json.add("http_ttfb_ms", (unsigned long)context.lastTiming.ttfbMs);
+        json.add("http_total_ms", (unsigned long)context.lastTiming.totalMs);
+        json.add("http_reused", context.lastTiming.reused);
+        json.add("http_heap_used", (unsigned long)context.lastTiming.heapUsed);
+        json.add("tls_handshakes", (unsigned long)context.handshakes);
         
-        // GPS status information
-        if (gpsMgr) {
-            gpsInfo["active"] = gpsMgr->isGPSActive();
-            gpsInfo["satellites"] = gpsMgr->getSatelliteCount();
-            gpsInfo["signal_quality"] = gpsMgr->getSignalQuality();
-            gpsInfo["time_since_update"] = gpsMgr->getTimeSinceLastUpdate();
+        if (withNetworks) {
+            const WiFiScanTable& table = wifiMgr->getScanTable();
+            const WiFiScanDiff& diff = table.getLastDiff();
+            json.add("wifi_networks_detected", table.size());
+            json.add("wifi_networks_appeared", diff.appeared);
+            json.add("wifi_networks_disappeared", diff.disappeared);
+            json.add("wifi_rssi_changes", diff.rssiChanged);
+        } else {
+            json.add("wifi_networks_detected", 0);
+        }
+        json.endObject();
+    }
+    
+    // Add location data - Use GPS if available, otherwise fallback to default
+    const GpsSnapshot& gpsState = sample.gps;
+    bool gpsFix = gpsState.initialized && gpsState.locationValid;
+    if (mask & REPORT_FIELD_LOCATION) {
+        json.beginObject("location");
+        if (gpsFix) {
+            // Use real GPS coordinates
+            json.addFixed("lat", gpsState.latitudeE7, 7);
+            json.addFixed("lng", gpsState.longitudeE7, 7);
+            json.add("source", "GPS");
+            if (gpsState.filtered.valid) {
+                const PositionEstimate& filtered = gpsState.filtered;
+                json.beginObject("filtered");
+                json.addFixed("lat", filtered.latitudeE7, 7);
+                json.addFixed("lng", filtered.longitudeE7, 7);
+                json.addFixed("accuracy_m", (int32_t)filtered.uncertaintyMm, 3);
+                json.addFixed("velocity_north_ms", filtered.velocityNorthMms, 3);
+                json.addFixed("velocity_east_ms", filtered.velocityEastMms, 3);
+                json.endObject();
+            }
+        } else if (sample.wifiLocation.valid) {
+            // Estimated from the WiFi fingerprints learned while GPS had a fix
+            const WiFiLocation& wifi = sample.wifiLocation;
+            json.addFixed("lat", wifi.latitudeE7, 7);
+            json.addFixed("lng", wifi.longitudeE7, 7);
+            json.add("source", "WIFI");
+            json.add("accuracy_m", (unsigned int)wifi.accuracyM);
+            json.add("fingerprints", (unsigned int)wifi.neighbours);
         } else {
-            gpsInfo["active"] = false;
-            gpsInfo["status"] = "GPS_NOT_INITIALIZED";
+            // Fallback to default coordinates
+            json.addFixed("lat", gpsDegreesToE7(DEFAULT_LATITUDE), 7);
+            json.addFixed("lng", gpsDegreesToE7(DEFAULT_LONGITUDE), 7);
+            json.add("source", "DEFAULT");
         }
+        json.endObject();
     }
     
-    // Add WiFi networks (only if wifiMgr is provided and networkCount > 0)
-    if (wifiMgr && networkCount > 0) {
-        JsonArray networks = doc.createNestedArray("wifi_networks");
-        for (int i = 0; i < networkCount && i < MAX_WIFI_NETWORKS; i++) {
-            JsonObject net = networks.createNestedObject();
-            net["ssid"] = wifiMgr->getNetworkSSID(i);
-            net["rssi"] = wifiMgr->getNetworkRSSI(i);
-            net["signal_strength"] = wifiMgr->getNetworkRSSI(i) > -50 ? "STRONG" : 
-                                   (wifiMgr->getNetworkRSSI(i) > -70 ? "MEDIUM" : "WEAK");
+    if (mask & REPORT_FIELD_GPS) {
+        json.beginObject("gps_info");
+        if (gpsFix) {
+            // Add detailed GPS information
+            // mm -> cm and mm/s -> 1/100 km/h, formatted with two decimals
+            json.addFixed("altitude", gpsDivRound(gpsState.altitudeMm, 10), 2);
+            json.addFixed("speed_kmh", gpsDivRound(gpsState.speedMms * 36, 100), 2);
+            json.add("satellites", gpsState.satellites);
+            json.add("signal_quality", gpsSignalQualityToString(gpsState.signalQuality));
+            json.add("motion", motionStateToString(gpsState.motion));
+            if (gpsState.timeValid) {
+                char dateTime[32];
+                snprintf(dateTime, sizeof(dateTime), "%04d-%02d-%02d %02d:%02d:%02d",
+                         gpsState.year, gpsState.month, gpsState.day,
+                         gpsState.hour, gpsState.minute, gpsState.second);
+                json.add("gps_time", dateTime);
+            } else {
+                json.add("gps_time", "INVALID");
+            }
+            json.add("time_since_update", gpsState.timeSinceUpdate);
+            json.add("active", gpsState.active);
+            json.add("time_valid", gpsState.timeValid);
+            json.add("ttff_ms", gpsState.ttffMs);
+            json.add("start_aid", gpsAidToString(gpsState.startAid));
+        } else if (gpsState.initialized) {
+            // GPS status information
+            json.add("active", gpsState.active);
+            json.add("satellites", gpsState.satellites);
+            json.add("signal_quality", gpsSignalQualityToString(gpsState.signalQuality));
+            json.add("time_since_update", gpsState.timeSinceUpdate);
+            json.add("ttff_ms", gpsState.ttffMs);
+            json.add("start_aid", gpsAidToString(gpsState.startAid));
+        } else {
+            json.add("active", false);
+            json.add("status", "GPS_NOT_INITIALIZED");
         }
-        system["wifi_networks_detected"] = networkCount;
-    } else {
-        system["wifi_networks_detected"] = 0;
+        json.endObject();
+    }
+    
+    // Geofence events, oldest first (age relative to the sample timestamp)
+    if ((mask & REPORT_FIELD_GEOFENCE) && sample.geofenceEventCount > 0) {
+        json.beginArray("geofence_events");
+        for (int i = 0; i < sample.geofenceEventCount; i++) {
+            const GeofenceEvent& event = sample.geofenceEvents[i];
+            json.beginObject();
+            json.add("fence", (unsigned int)event.fenceId);
+            json.add("event", geofenceEventToString(event.type));
+            json.add("age_ms", (unsigned long)(sample.timestampMs - event.timestampMs));
+            json.addFixed("lat", event.latitudeE7, 7);
+            json.addFixed("lng", event.longitudeE7, 7);
+            json.add("inside_ms", (unsigned long)event.insideMs);
+            json.endObject();
+        }
+        json.endArray();
+    }
+    
+    // Route since the previous sample (times relative to the sample timestamp)
+    const TrackSegment& track = sample.track;
+    if ((mask & REPORT_FIELD_TRACK) && track.pointCount > 0) {
+        char polyline[TRACK_POLYLINE_MAX];
+        trackEncodePolyline(track, polyline, sizeof(polyline));
+        json.beginObject("track");
+        json.add("polyline", polyline);
+        json.add("points", (unsigned int)track.pointCount);
+        json.add("fixes", (unsigned int)track.fixCount);
+        json.addFixed("tolerance_m", (int32_t)track.toleranceCm, 2);
+        json.add("start_age_ms", (unsigned long)(sample.timestampMs - track.startMs));
+        json.add("duration_ms", (unsigned long)(track.endMs - track.startMs));
+        json.endObject();
+    }
+    
+    // Add WiFi networks from the scan table snapshot (newest live sample of a batch only)
+    if (withNetworks) {
+        const WiFiScanTable& table = wifiMgr->getScanTable();
+        char bssid[18];
+        json.beginArray("wifi_networks");
+        for (int i = 0; i < table.size() && i < MAX_WIFI_NETWORKS; i++) {
+            const WiFiNetworkEntry& entry = table.getEntry(i);
+            WiFiScanTable::formatBssid(entry.bssid, bssid);
+            json.beginObject();
+            json.add("ssid", entry.ssid);
+            json.add("bssid", bssid);
+            json.add("channel", entry.channel);
+            json.add("rssi", entry.rssi);
+            json.add("signal_strength", entry.rssi > -50 ? "STRONG" : 
+                                      (entry.rssi > -70 ? "MEDIUM" : "WEAK"));
+            json.endObject();
+        }
+        json.endArray();
     }
     
-    String jsonString;
-    serializeJson(doc, jsonString);
-    return jsonString;
+    json.endObject();
 }
 
-bool FirebaseClient::sendData(int networkCount, WiFiManager* wifiMgr, GPSManager* gpsMgr, OptocouplerManager* optocouplerMgr) {
-    if (wifiMgr && !wifiMgr->isWiFiConnected()) {
-        DEBUG_PRINTLN("❌ Cannot send data - WiFi not connected");
-        return false;
+void FirebaseClient::writeCompactSample(CborWriter& cbor, const SensorSample& sample, uint8_t mask, WiFiManager* wifiMgr, bool replayed) {
+    cbor.beginMap();
+    cbor.addInt(FIELD_SCHEMA);
+    cbor.addInt(PAYLOAD_SCHEMA_VERSION);
+    cbor.addInt(FIELD_TIMESTAMP);
+    cbor.addInt(sample.timestampMs);
+    cbor.addInt(FIELD_REPORT);
+    cbor.addInt(mask);
+    
+    // Power map (status strings and uptime percentage are derived on the host)
+    const PowerSnapshot& powerState = sample.power;
+    if ((mask & REPORT_FIELD_POWER) && powerState.initialized) {
+        cbor.addInt(FIELD_POWER);
+        cbor.beginMap();
+        cbor.addInt(FIELD_POWER_PRESENT);
+        cbor.addBool(powerState.powerPresent);
+        cbor.addInt(FIELD_POWER_STABILITY);
+        cbor.addInt(powerState.stability);
+        cbor.addInt(FIELD_POWER_TIME_SINCE_CHANGE);
+        cbor.addInt(powerState.timeSinceChange);
+        cbor.addInt(FIELD_POWER_STATE_CHANGES);
+        cbor.addInt(powerState.stateChanges);
+        cbor.addInt(FIELD_POWER_TOTAL_ON);
+        cbor.addInt(powerState.totalOnTime);
+        cbor.addInt(FIELD_POWER_TOTAL_OFF);
+        cbor.addInt(powerState.totalOffTime);
+        cbor.addInt(FIELD_POWER_LAST_ON);
+        cbor.addInt(powerState.lastPowerOn);
+        cbor.addInt(FIELD_POWER_LAST_OFF);
+        cbor.addInt(powerState.lastPowerOff);
+        cbor.addInt(FIELD_POWER_OUTAGES);
+        cbor.addInt(powerState.outages.totalOutages);
+        cbor.addInt(FIELD_POWER_OUTAGE_WINDOWS);
+        cbor.beginArray();
+        for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+            const OutageWindowStats& window = powerState.outages.windows[i];
+            cbor.beginArray();
+            cbor.addInt(window.count);
+            cbor.addInt(window.totalMs);
+            cbor.addInt(window.longestMs);
+            cbor.addInt(window.flickers);
+            cbor.end();
+        }
+        cbor.end();
+        if (powerState.mains.enabled) {
+            const MainsSnapshot& mains = powerState.mains;
+            cbor.addInt(FIELD_POWER_MAINS);
+            cbor.beginArray();
+            cbor.addInt(mains.frequencyMilliHz);
+            cbor.addInt(mains.sagCount);
+            cbor.addInt(mains.missingCycles);
+            cbor.addInt(mains.dropoutCount);
+            cbor.addInt(mains.lastDropoutMs);
+            cbor.addInt(mains.longestDropoutMs);
+            cbor.end();
+        }
+        cbor.end();
     }
     
-    String url = constructURL();
-    String jsonPayload = createJSONPayload(networkCount, wifiMgr, gpsMgr, optocouplerMgr);
+    // Line voltage aggregates (independent of the optocoupler)
+    const VoltageSnapshot& voltage = sample.voltage;
+    if ((mask & REPORT_FIELD_POWER) && voltage.enabled) {
+        cbor.addInt(FIELD_VOLTAGE);
+        cbor.beginArray();
+        cbor.addInt(voltage.rmsMv);
+        cbor.addInt(voltage.minRmsMv);
+        cbor.addInt(voltage.maxRmsMv);
+        cbor.addInt(voltage.minRaw);
+        cbor.addInt(voltage.maxRaw);
+        cbor.addInt(voltage.sagCount);
+        cbor.addInt(voltage.swellCount);
+        cbor.addInt(voltage.lastEventMs);
+        cbor.addInt(voltage.overruns);
+        cbor.end();
+    }
     
-    // Remove verbose debug output - only show in case of errors
+    // System map - same values as the JSON "system" object
+    bool withNetworks = (mask & REPORT_FIELD_NETWORKS) && wifiMgr && wifiMgr->getScanTable().size() > 0;
+    if (mask & REPORT_FIELD_SYSTEM) {
+        cbor.addInt(FIELD_SYSTEM);
+        cbor.beginMap();
+        cbor.addInt(FIELD_SYSTEM_UPTIME);
+        cbor.addInt(context.uptimeMs);
+        cbor.addInt(FIELD_SYSTEM_FREE_HEAP);
+        cbor.addInt(sample.freeHeap);
+        cbor.addInt(FIELD_SYSTEM_WIFI_CONNECTED);
+        cbor.addBool(context.wifiConnected);
+        if (context.hasWifi) {
+            cbor.addInt(FIELD_SYSTEM_WIFI_ATTEMPTS);
+            cbor.addInt(context.connectAttempts);
+            cbor.addInt(FIELD_SYSTEM_WIFI_DISCONNECTS);
+            cbor.addInt(context.disconnects);
+            cbor.addInt(FIELD_SYSTEM_WIFI_CONNECT_MS);
+            cbor.addInt(context.connectMs);
+            cbor.addInt(FIELD_SYSTEM_WIFI_CONNECT_FAST);
+            cbor.addBool(context.connectFast);
+            cbor.addInt(FIELD_SYSTEM_WIFI_FIRST_CONNECT);
+            cbor.addInt(context.firstConnectMs);
+        }
+        cbor.addInt(FIELD_SYSTEM_SEQUENCE);
+        cbor.addInt(sample.sequence);
+        cbor.addInt(FIELD_SYSTEM_BOOT_ID);
+        cbor.addInt(sample.bootId);
+        cbor.addInt(FIELD_SYSTEM_BATCH_SAMPLES);
+        cbor.addInt(lastBatchSamples);
+        cbor.addInt(FIELD_SYSTEM_BATCH_BYTES);
+        cbor.addInt(lastBatchBytes);
+        cbor.addInt(FIELD_SYSTEM_BATCH_LATENCY);
+        cbor.addInt(lastBatchLatency);
+        if (replayed) {
+            cbor.addInt(FIELD_SYSTEM_REPLAYED);
+            cbor.addBool(true);
+        }
+        if (context.hasJournal) {
+            cbor.addInt(FIELD_SYSTEM_JOURNAL_PENDING);
+            cbor.addInt(context.journalPending);
+            cbor.addInt(FIELD_SYSTEM_JOURNAL_DROPPED);
+            cbor.addInt(context.journalDropped);
+        }
+        cbor.addInt(FIELD_SYSTEM_HTTP_CONNECT);
+        cbor.addInt(context.lastTiming.connectMs);
+        cbor.addInt(FIELD_SYSTEM_HTTP_TTFB);
+        cbor.addInt(context.lastTiming.ttfbMs);
+        cbor.addInt(FIELD_SYSTEM_HTTP_TOTAL);
+        cbor.addInt(context.lastTiming.totalMs);
+        cbor.addInt(FIELD_SYSTEM_HTTP_REUSED);
+        cbor.addBool(context.lastTiming.reused);
+        cbor.addInt(FIELD_SYSTEM_HTTP_HEAP);
+        cbor.addInt(context.lastTiming.heapUsed);
+        cbor.addInt(FIELD_SYSTEM_TLS_HANDSHAKES);
+        cbor.addInt(context.handshakes);
+        if (withNetworks) {
+            const WiFiScanDiff& diff = wifiMgr->getScanTable().getLastDiff();
+            cbor.addInt(FIELD_SYSTEM_NETWORKS_DETECTED);
+            cbor.addInt(wifiMgr->getScanTable().size());
+            cbor.addInt(FIELD_SYSTEM_NETWORKS_APPEARED);
+            cbor.addInt(diff.appeared);
+            cbor.addInt(FIELD_SYSTEM_NETWORKS_DISAPPEARED);
+            cbor.addInt(diff.disappeared);
+            cbor.addInt(FIELD_SYSTEM_RSSI_CHANGES);
+            cbor.addInt(diff.rssiChanged);
+        }
+        cbor.end();
+    }
+    
+    // GPS map for location and status alike (coordinates as fixed-point;
+    // no coordinates means default coordinates)
+    const GpsSnapshot& gpsState = sample.gps;
+    if ((mask & (REPORT_FIELD_LOCATION | REPORT_FIELD_GPS)) && gpsState.initialized) {
+        cbor.addInt(FIELD_GPS);
+        cbor.beginMap();
+        cbor.addInt(FIELD_GPS_ACTIVE);
+        cbor.addBool(gpsState.active);
+        cbor.addInt(FIELD_GPS_LOCATION_VALID);
+        cbor.addBool(gpsState.locationValid);
+        cbor.addInt(FIELD_GPS_TIME_VALID);
+        cbor.addBool(gpsState.timeValid);
+        cbor.addInt(FIELD_GPS_QUALITY);
+        cbor.addInt(gpsState.signalQuality);
+        cbor.addInt(FIELD_GPS_SATELLITES);
+        cbor.addInt(gpsState.satellites);
+        if (gpsState.locationValid) {
+            cbor.addInt(FIELD_GPS_LATITUDE_E7);
+            cbor.addInt(gpsState.latitudeE7);
+            cbor.addInt(FIELD_GPS_LONGITUDE_E7);
+            cbor.addInt(gpsState.longitudeE7);
+            cbor.addInt(FIELD_GPS_ALTITUDE_CM);
+            cbor.addInt(gpsDivRound(gpsState.altitudeMm, 10));
+            cbor.addInt(FIELD_GPS_SPEED_CMH);
+            cbor.addInt(gpsDivRound(gpsState.speedMms * 36, 100));
+            if (gpsState.timeValid) {
+                cbor.addInt(FIELD_GPS_DATETIME);
+                cbor.beginArray();
+                cbor.addInt(gpsState.year);
+                cbor.addInt(gpsState.month);
+                cbor.addInt(gpsState.day);
+                cbor.addInt(gpsState.hour);
+                cbor.addInt(gpsState.minute);
+                cbor.addInt(gpsState.second);
+                cbor.end();
+            }
+        }
+        if (gpsState.filtered.valid) {
+            cbor.addInt(FIELD_GPS_FILTERED_LATITUDE_E7);
+            cbor.addInt(gpsState.filtered.latitudeE7);
+            cbor.addInt(FIELD_GPS_FILTERED_LONGITUDE_E7);
+            cbor.addInt(gpsState.filtered.longitudeE7);
+            cbor.addInt(FIELD_GPS_FILTERED_ACCURACY_MM);
+            cbor.addInt(gpsState.filtered.uncertaintyMm);
+            cbor.addInt(FIELD_GPS_VELOCITY_NORTH_MMS);
+            cbor.addInt(gpsState.filtered.velocityNorthMms);
+            cbor.addInt(FIELD_GPS_VELOCITY_EAST_MMS);
+            cbor.addInt(gpsState.filtered.velocityEastMms);
+        }
+        cbor.addInt(FIELD_GPS_MOTION);
+        cbor.addInt(gpsState.motion);
+        cbor.addInt(FIELD_GPS_TTFF_MS);
+        cbor.addInt(gpsState.ttffMs);
+        cbor.addInt(FIELD_GPS_START_AID);
+        cbor.addInt(gpsState.startAid);
+        cbor.addInt(FIELD_GPS_TIME_SINCE_UPDATE);
+        cbor.addInt(gpsState.timeSinceUpdate);
+        cbor.end();
+    }
+    
+    // WiFi fingerprint position, only in place of a GPS fix
+    const WiFiLocation& wifi = sample.wifiLocation;
+    if ((mask & REPORT_FIELD_LOCATION) && wifi.valid && !(gpsState.initialized && gpsState.locationValid)) {
+        cbor.addInt(FIELD_WIFI_LOCATION);
+        cbor.beginArray();
+        cbor.addInt(wifi.latitudeE7);
+        cbor.addInt(wifi.longitudeE7);
+        cbor.addInt(wifi.accuracyM);
+        cbor.addInt(wifi.neighbours);
+        cbor.end();
+    }
+    
+    // Geofence events as [fence, type, age ms, lat E7, lon E7, inside ms] tuples
+    if ((mask & REPORT_FIELD_GEOFENCE) && sample.geofenceEventCount > 0) {
+        cbor.addInt(FIELD_GEOFENCE);
+        cbor.beginArray();
+        for (int i = 0; i < sample.geofenceEventCount; i++) {
+            const GeofenceEvent& event = sample.geofenceEvents[i];
+            cbor.beginArray();
+            cbor.addInt(event.fenceId);
+            cbor.addInt(event.type);
+            cbor.addInt(sample.timestampMs - event.timestampMs);
+            cbor.addInt(event.latitudeE7);
+            cbor.addInt(event.longitudeE7);
+            cbor.addInt(event.insideMs);
+            cbor.end();
+        }
+        cbor.end();
+    }
+    
+    // Route as [polyline, points, fixes, start age ms, duration ms, tolerance cm]
+    const TrackSegment& track = sample.track;
+    if ((mask & REPORT_FIELD_TRACK) && track.pointCount > 0) {
+        char polyline[TRACK_POLYLINE_MAX];
+        trackEncodePolyline(track, polyline, sizeof(polyline));
+        cbor.addInt(FIELD_TRACK);
+        cbor.beginArray();
+        cbor.addText(polyline);
+        cbor.addInt(track.pointCount);
+        cbor.addInt(track.fixCount);
+        cbor.addInt(sample.timestampMs - track.startMs);
+        cbor.addInt(track.endMs - track.startMs);
+        cbor.addInt(track.toleranceCm);
+        cbor.end();
+    }
+    
+    // Networks as [bssid, rssi, channel, ssid] tuples (strength label is derived on the host)
+    if (withNetworks) {
+        const WiFiScanTable& table = wifiMgr->getScanTable();
+        cbor.addInt(FIELD_NETWORKS);
+        cbor.beginArray();
+        for (int i = 0; i < table.size() && i < MAX_WIFI_NETWORKS; i++) {
+            const WiFiNetworkEntry& entry = table.getEntry(i);
+            uint8_t bssid[6];
+            for (int b = 0; b < 6; b++) {
+                bssid[b] = (uint8_t)(entry.bssid >> (40 - 8 * b));
+            }
+            cbor.beginArray();
+            cbor.addBytes(bssid, sizeof(bssid));
+            cbor.addInt(entry.rssi);
+            cbor.addInt(entry.channel);
+            cbor.addText(entry.ssid);
+            cbor.end();
+        }
+        cbor.end();
+    }
+    
+    cbor.end();
+}
+
+uint32_t FirebaseClient::measureSample(const SensorSample& sample, WiFiManager* wifiMgr) {
+    captureContext(wifiMgr);
     
-    // Remove verbose GPS and power debug output - these are shown in main.cpp
+    // A copy, not an encoding - the JSON/compact comparison is made on demand
+    lastSample = sample;
+    lastSampleWifi = wifiMgr;
+    hasLastSample = true;
     
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
-    http.setTimeout(HTTP_TIMEOUT);
+    // Batch budget: only the newest sample of a batch carries the network list
+    CountingPrint counter;
+    if (encoding == PAYLOAD_ENCODING_COMPACT) {
+        Base64Print batchBase64(counter);
+        CborWriter batchCbor(batchBase64);
+        writeCompactSample(batchCbor, sample, sample.reportMask & ~REPORT_FIELD_NETWORKS, wifiMgr, false);
+        batchBase64.finish();
+    } else {
+        JsonWriter batchJson(counter);
+        writeSample(batchJson, nullptr, sample, sample.reportMask & ~REPORT_FIELD_NETWORKS, wifiMgr, false);
+    }
     
-    // Add Host header for proper Firebase routing
-    http.addHeader("Host", FIREBASE_HOST);
+    // Key, quotes, colon and separator around the sample
+    return counter.getCount() + 36;
+}
+
+void FirebaseClient::writeBody(Print& out) {
+    // One multi-location update: { "<key>": {sample}, "<key>": {sample}, ... }
+    JsonWriter json(out);
+    char key[40];
+    bool replayed = pendingBatch->isReplayed();
     
-    int httpResponseCode = http.POST(jsonPayload);
+    // The scan table goes out once, with the newest live sample, if any sample flagged a change
+    bool networks = false;
+    for (int i = 0; i < pendingBatch->size(); i++) {
+        networks |= (pendingBatch->getSample(i).reportMask & REPORT_FIELD_NETWORKS) != 0;
+    }
     
-    if (httpResponseCode > 0) {
-        String response = http.getString();
+    json.beginObject();
+    for (int i = 0; i < pendingBatch->size(); i++) {
+        const SensorSample& sample = pendingBatch->getSample(i);
+        bool newest = (i == pendingBatch->size() - 1);
+        uint8_t mask = sample.reportMask & ~REPORT_FIELD_NETWORKS;
+        if (newest && networks && !replayed) {
+            mask |= REPORT_FIELD_NETWORKS;
+        }
         
-        if (httpResponseCode == 200) {
-            // Success - no debug output needed
-            http.end();
-            return true;
+        formatSampleKey(sample, key, sizeof(key));
+        if (encoding == PAYLOAD_ENCODING_COMPACT) {
+            // "<key>": "<base64 CBOR>" - RTDB only stores JSON values
+            json.beginRawString(key);
+            Base64Print base64(out);
+            CborWriter cbor(base64);
+            writeCompactSample(cbor, sample, mask, pendingWifi, replayed);
+            base64.finish();
+            json.endRawString();
         } else {
-            // Only show debug info on errors
-            DEBUG_PRINTF("⚠️  Firebase unexpected response: %d\n", httpResponseCode);
-            DEBUG_PRINTF("Response: %s\n", response.c_str());
+            writeSample(json, key, sample, mask, pendingWifi, replayed);
         }
+    }
+    json.endObject();
+}
+
+bool FirebaseClient::sendBatch(const SampleBatch& batch, WiFiManager* wifiMgr) {
+    if (batch.size() == 0) {
+        return true;
+    }
+    
+    if (wifiMgr && !wifiMgr->isWiFiConnected()) {
+        DEBUG_PRINTLN("❌ Cannot send data - WiFi not connected");
+        return false;
+    }
+    
+    // Streamed straight into the socket - no payload String, no document buffer
+    captureContext(wifiMgr);
+    pendingBatch = &batch;
+    pendingWifi = wifiMgr;
+    const char* path = (encoding == PAYLOAD_ENCODING_COMPACT) ? FIREBASE_COMPACT_PATH : FIREBASE_DATA_PATH;
+    int httpResponseCode = connection.request("PATCH", path, "application/json", *this);
+    pendingBatch = nullptr;
+    pendingWifi = nullptr;
+    
+    if (httpResponseCode == 200) {
+        // Success - no debug output needed
+        batchesSent++;
+        lastBatchSamples = batch.size();
+        lastBatchBytes = connection.getLastTiming().bodyBytes;
+        if (!batch.isReplayed()) {
+            lastBatchLatency = batch.getAge();
+        }
+        return true;
+    } else if (httpResponseCode > 0) {
+        // Only show debug info on errors
+        DEBUG_PRINTF("⚠️  Firebase unexpected response: %d\n", httpResponseCode);
+        DEBUG_PRINTF("Response: %s\n", connection.getLastErrorBody());
     } else {
         DEBUG_PRINTF("❌ Firebase send failed: %d\n", httpResponseCode);
     }
     
-    http.end();
     return false;
 }
 
+void FirebaseClient::setEncoding(PayloadEncoding payloadEncoding) {
+    encoding = payloadEncoding;
+}
+
+PayloadEncoding FirebaseClient::getEncoding() {
+    return encoding;
+}
+
+void FirebaseClient::printStatus() {
+    Serial.printf("Firebase Batches: %lu | Last: %u samples, %lu bytes, %lu ms latency\n",
+                 (unsigned long)batchesSent, lastBatchSamples,
+                 (unsigned long)lastBatchBytes, (unsigned long)lastBatchLatency);
+    if (hasLastSample) {
+        // Latest sample with every group and the network list, in both encodings
+        captureContext(lastSampleWifi);
+        
+        CountingPrint jsonCounter;
+        JsonWriter json(jsonCounter);
+        writeSample(json, nullptr, lastSample, REPORT_FIELD_ALL, lastSampleWifi, false);
+        uint32_t jsonBytes = jsonCounter.getCount();
+        
+        CountingPrint compactCounter;
+        Base64Print base64(compactCounter);
+        CborWriter cbor(base64);
+        writeCompactSample(cbor, lastSample, REPORT_FIELD_ALL, lastSampleWifi, false);
+        base64.finish();
+        uint32_t compactBytes = compactCounter.getCount() + 2;
+        
+        Serial.printf("Payload: %s | Full sample: JSON %lu B, compact %lu B (%lu%%)\n",
+                     encoding == PAYLOAD_ENCODING_COMPACT ? "COMPACT" : "JSON",
+                     (unsigned long)jsonBytes, (unsigned long)compactBytes,
+                     (unsigned long)(jsonBytes > 0 ? compactBytes * 100 / jsonBytes : 0));
+    }
+    connection.printStatus();
+}
+
 void FirebaseClient::end() {
-    http.end();
+    connection.stop();
 }
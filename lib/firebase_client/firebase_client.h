@@ -2,26 +2,77 @@
 #define FIREBASE_CLIENT_H
 
 #include <Arduino.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
 #include "firebase-config.h"
 #include "config.h"
+#include "sensor_sample.h"
+#include "https_connection.h"
+#include "json_writer.h"
+#include "cbor_writer.h"
+#include "payload_schema.h"
+#include "sample_batch.h"
 
 // Forward declarations
 class WiFiManager;
-class GPSManager;
-class OptocouplerManager;
+class SampleJournal;
 
-class FirebaseClient {
+/**
+ * Upload-time values shared by every sample of a request. Captured once so the
+ * counting pass and the sending pass encode identical bytes.
+ */
+struct UploadContext {
+    uint32_t uptimeMs;
+    bool wifiConnected;
+    bool hasWifi;
+    uint32_t connectAttempts;
+    uint32_t disconnects;
+    uint32_t connectMs;
+    bool connectFast;
+    uint32_t firstConnectMs;
+    bool hasJournal;
+    uint32_t journalPending;
+    uint32_t journalDropped;
+    HttpsRequestTiming lastTiming;
+    uint32_t handshakes;
+};
+
+class FirebaseClient : public HttpsBodyWriter {
 private:
-    HTTPClient http;
-    String constructURL();
-    String createJSONPayload(int networkCount, WiFiManager* wifiMgr, GPSManager* gpsMgr, OptocouplerManager* optocouplerMgr);
+    HttpsConnection connection;
+    SampleJournal* journal;
+    
+    // Request being streamed (valid during sendBatch only)
+    UploadContext context;
+    const SampleBatch* pendingBatch;
+    WiFiManager* pendingWifi;
+    PayloadEncoding encoding;
     
+    // Most recent measured sample, encoded both ways only when printStatus() asks
+    SensorSample lastSample;
+    WiFiManager* lastSampleWifi;
+    bool hasLastSample;
+    char deviceId[13];            // Efuse MAC as hex, prefix of every sample key
+    
+    // Batch telemetry (previous batch, reported with the next one)
+    uint32_t batchesSent;
+    uint8_t lastBatchSamples;
+    uint32_t lastBatchBytes;
+    uint32_t lastBatchLatency;
+    
+    void captureContext(WiFiManager* wifiMgr);
+    void writeSample(JsonWriter& json, const char* key, const SensorSample& sample, uint8_t mask, WiFiManager* wifiMgr, bool replayed);
+    void writeCompactSample(CborWriter& cbor, const SensorSample& sample, uint8_t mask, WiFiManager* wifiMgr, bool replayed);
+    void formatSampleKey(const SensorSample& sample, char* buffer, size_t size);
+
 public:
     FirebaseClient();
     bool begin();
-    bool sendData(int networkCount, WiFiManager* wifiMgr, GPSManager* gpsMgr = nullptr, OptocouplerManager* optocouplerMgr = nullptr);
+    void attachJournal(SampleJournal* sampleJournal);
+    uint32_t measureSample(const SensorSample& sample, WiFiManager* wifiMgr);
+    bool sendBatch(const SampleBatch& batch, WiFiManager* wifiMgr);
+    void setEncoding(PayloadEncoding payloadEncoding);
+    PayloadEncoding getEncoding();
+    void writeBody(Print& out) override;
+    void printStatus();
     void end();
 };
 
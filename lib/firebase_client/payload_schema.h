@@ -0,0 +1,116 @@
+#ifndef PAYLOAD_SCHEMA_H
+#define PAYLOAD_SCHEMA_H
+
+/**
+ * Compact payload field dictionary
+ *
+ * Integer keys used by the CBOR encoding. Field IDs are scoped to their map
+ * and never reused: add new fields at the end and bump
+ * PAYLOAD_SCHEMA_VERSION when a meaning changes. tools/decode_compact.py
+ * carries the same table to expand samples back to the JSON shape.
+ *
+ * Dropped compared to JSON (restored by the decoder): derived strings
+ * (status, signal_strength, location.source), uptime_percentage, the
+ * constant datetime/config/source fields, and default coordinates
+ * (sent neither FIELD_GPS coordinates nor FIELD_WIFI_LOCATION).
+ * Enums travel as their integer value; coordinates as fixed-point.
+ *
+ * Version 2: FIELD_REPORT added. A group missing from the mask is omitted,
+ * so an absent power/GPS map no longer implies "not initialized".
+ */
+#define PAYLOAD_SCHEMA_VERSION 2
+
+// Wire encoding of a transport
+enum PayloadEncoding {
+    PAYLOAD_ENCODING_JSON,            // Readable JSON objects (dashboard format)
+    PAYLOAD_ENCODING_COMPACT          // Base64 CBOR with integer field IDs
+};
+
+// Top-level sample map
+enum PayloadField {
+    FIELD_SCHEMA = 0,
+    FIELD_TIMESTAMP = 1,
+    FIELD_POWER = 2,                  // Map, absent when the optocoupler is not initialized
+    FIELD_SYSTEM = 3,                 // Map
+    FIELD_GPS = 4,                    // Map, absent when GPS is not initialized
+    FIELD_NETWORKS = 5,               // Array of [bssid bytes, rssi, channel, ssid]
+    FIELD_REPORT = 6,                 // REPORT_FIELD_* mask; groups not in it are omitted (v2)
+    FIELD_VOLTAGE = 7,                // Array [rms mV, min cycle mV, max cycle mV, min raw, max raw,
+                                      //        sags, swells, last event ms, overruns]
+    FIELD_GEOFENCE = 8,               // Array per event of [fence id, GeofenceEventType, age ms,
+                                      //                     lat E7, lon E7, inside ms]
+    FIELD_TRACK = 9,                  // Array [polyline (1e-5 deg), points, fixes, start age ms,
+                                      //        duration ms, tolerance cm]
+    FIELD_WIFI_LOCATION = 10          // No GPS fix: [lat E7, lon E7, accuracy m, fingerprints]
+};
+
+// FIELD_POWER map
+enum PowerField {
+    FIELD_POWER_PRESENT = 1,
+    FIELD_POWER_STABILITY = 2,        // PowerStability value
+    FIELD_POWER_TIME_SINCE_CHANGE = 3,
+    FIELD_POWER_STATE_CHANGES = 4,
+    FIELD_POWER_TOTAL_ON = 5,
+    FIELD_POWER_TOTAL_OFF = 6,
+    FIELD_POWER_LAST_ON = 7,
+    FIELD_POWER_LAST_OFF = 8,
+    FIELD_POWER_OUTAGES = 9,          // Outages since boot
+    FIELD_POWER_OUTAGE_WINDOWS = 10,  // Array per OutageWindow of [count, total ms, longest ms, flickers]
+    FIELD_POWER_MAINS = 11            // AC mode only: [frequency mHz, sags, missing cycles, dropouts,
+                                      //                last dropout ms, longest dropout ms]
+};
+
+// FIELD_SYSTEM map
+enum SystemField {
+    FIELD_SYSTEM_UPTIME = 1,
+    FIELD_SYSTEM_FREE_HEAP = 2,
+    FIELD_SYSTEM_WIFI_CONNECTED = 3,
+    FIELD_SYSTEM_WIFI_ATTEMPTS = 4,
+    FIELD_SYSTEM_WIFI_DISCONNECTS = 5,
+    FIELD_SYSTEM_WIFI_CONNECT_MS = 6,
+    FIELD_SYSTEM_WIFI_CONNECT_FAST = 7,
+    FIELD_SYSTEM_WIFI_FIRST_CONNECT = 8,
+    FIELD_SYSTEM_SEQUENCE = 9,
+    FIELD_SYSTEM_BOOT_ID = 10,
+    FIELD_SYSTEM_BATCH_SAMPLES = 11,
+    FIELD_SYSTEM_BATCH_BYTES = 12,
+    FIELD_SYSTEM_BATCH_LATENCY = 13,
+    FIELD_SYSTEM_REPLAYED = 14,
+    FIELD_SYSTEM_JOURNAL_PENDING = 15,
+    FIELD_SYSTEM_JOURNAL_DROPPED = 16,
+    FIELD_SYSTEM_HTTP_CONNECT = 17,
+    FIELD_SYSTEM_HTTP_TTFB = 18,
+    FIELD_SYSTEM_HTTP_TOTAL = 19,
+    FIELD_SYSTEM_HTTP_REUSED = 20,
+    FIELD_SYSTEM_HTTP_HEAP = 21,
+    FIELD_SYSTEM_TLS_HANDSHAKES = 22,
+    FIELD_SYSTEM_NETWORKS_DETECTED = 23,
+    FIELD_SYSTEM_NETWORKS_APPEARED = 24,
+    FIELD_SYSTEM_NETWORKS_DISAPPEARED = 25,
+    FIELD_SYSTEM_RSSI_CHANGES = 26
+};
+
+// FIELD_GPS map
+enum GpsField {
+    FIELD_GPS_ACTIVE = 1,
+    FIELD_GPS_LOCATION_VALID = 2,
+    FIELD_GPS_TIME_VALID = 3,
+    FIELD_GPS_QUALITY = 4,            // GpsSignalQuality value
+    FIELD_GPS_SATELLITES = 5,
+    FIELD_GPS_LATITUDE_E7 = 6,        // Degrees * 1e7
+    FIELD_GPS_LONGITUDE_E7 = 7,       // Degrees * 1e7
+    FIELD_GPS_ALTITUDE_CM = 8,
+    FIELD_GPS_SPEED_CMH = 9,          // km/h * 100
+    FIELD_GPS_DATETIME = 10,          // Array [year, month, day, hour, minute, second]
+    FIELD_GPS_TIME_SINCE_UPDATE = 11,
+    FIELD_GPS_FILTERED_LATITUDE_E7 = 12,   // Position filter estimate, absent when not valid
+    FIELD_GPS_FILTERED_LONGITUDE_E7 = 13,
+    FIELD_GPS_FILTERED_ACCURACY_MM = 14,   // 1-sigma uncertainty
+    FIELD_GPS_VELOCITY_NORTH_MMS = 15,
+    FIELD_GPS_VELOCITY_EAST_MMS = 16,
+    FIELD_GPS_MOTION = 17,                 // MotionState value
+    FIELD_GPS_TTFF_MS = 18,                // Boot to first fix, 0 until then
+    FIELD_GPS_START_AID = 19               // GPS_AID_* mask sent to the receiver at boot
+};
+
+#endif // PAYLOAD_SCHEMA_H
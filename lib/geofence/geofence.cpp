@@ -0,0 +1,400 @@
+#include "geofence.h"
+#include "gps_fixed.h"
+#include <LittleFS.h>
+
+#define GEOFENCE_LINE_MAX 512           // Longest fence line (~30 polygon vertices)
+#define GEOFENCE_GRID_CELLS (GEOFENCE_GRID_SIZE * GEOFENCE_GRID_SIZE)
+
+static_assert(GEOFENCE_MAX_VERTICES <= 65535 && GEOFENCE_MAX_CELL_ENTRIES <= 65535, "Index entries are 16 bit");
+static_assert(GEOFENCE_EVENT_QUEUE <= 255 && GEOFENCE_MAX_TRACKED <= 255, "Queue counters are 8 bit");
+
+const char* geofenceEventToString(GeofenceEventType type) {
+    switch (type) {
+        case GEOFENCE_ENTER: return "ENTER";
+        case GEOFENCE_EXIT:  return "EXIT";
+        default:             return "DWELL";
+    }
+}
+
+GeofenceEngine::GeofenceEngine() {
+    fenceCount = 0;
+    vertexCount = 0;
+    gridMinLat = 0;
+    gridMinLon = 0;
+    cellHeight = 1;
+    cellWidth = 1;
+    memset(cellStart, 0, sizeof(cellStart));
+    trackedCount = 0;
+    eventHead = 0;
+    eventCount = 0;
+    fixesEvaluated = 0;
+    exactTests = 0;
+    eventsEmitted = 0;
+    eventsDropped = 0;
+}
+
+bool GeofenceEngine::begin() {
+    File file = LittleFS.open(GEOFENCE_FILE, "r");
+    if (!file) {
+        DEBUG_PRINTF("Geofences: %s not found - none loaded\n", GEOFENCE_FILE);
+        return false;
+    }
+    
+    // Line by line into a fixed buffer; bad lines are skipped, not fatal
+    char line[GEOFENCE_LINE_MAX];
+    int length = 0;
+    int lineNumber = 0;
+    bool done = false;
+    while (!done) {
+        int c = file.read();
+        done = c < 0;
+        if (!done && c != '\n') {
+            if (length < GEOFENCE_LINE_MAX - 1) {
+                line[length++] = (char)c;
+            }
+            continue;
+        }
+        line[length] = '\0';
+        lineNumber++;
+        if (length > 0 && !parseLine(line)) {
+            DEBUG_PRINTF("⚠️  Geofences: line %d skipped\n", lineNumber);
+        }
+        length = 0;
+    }
+    file.close();
+    
+    if (fenceCount == 0 || !buildIndex()) {
+        fenceCount = 0;
+        return false;
+    }
+    
+    DEBUG_PRINTF("📍 Geofences: %u fences, %u vertices, %u index entries\n",
+                 fenceCount, vertexCount, cellStart[GEOFENCE_GRID_CELLS]);
+    return true;
+}
+
+bool GeofenceEngine::parseDegrees(char*& cursor, int32_t& valueE7) {
+    char* end;
+    double degrees = strtod(cursor, &end);
+    if (end == cursor || degrees < -180.0 || degrees > 180.0) {
+        return false;
+    }
+    cursor = end;
+    valueE7 = gpsDegreesToE7(degrees);
+    return true;
+}
+
+bool GeofenceEngine::parseLine(char* line) {
+    char* cursor = line;
+    while (*cursor == ' ' || *cursor == '\t') {
+        cursor++;
+    }
+    if (*cursor == '\0' || *cursor == '\r' || *cursor == '#') {
+        return true;
+    }
+    
+    char kind = *cursor++;
+    if ((kind != 'C' && kind != 'P') || fenceCount >= GEOFENCE_MAX_FENCES) {
+        return false;
+    }
+    
+    char* end;
+    long id = strtol(cursor, &end, 10);
+    if (end == cursor || id < 0 || id > 0xFFFF) {
+        return false;
+    }
+    cursor = end;
+    long dwellS = strtol(cursor, &end, 10);
+    if (end == cursor || dwellS < 0) {
+        return false;
+    }
+    cursor = end;
+    
+    Fence& fence = fences[fenceCount];
+    memset(&fence, 0, sizeof(fence));
+    fence.id = (uint16_t)id;
+    fence.polygon = kind == 'P';
+    fence.dwellMs = (uint32_t)dwellS * 1000UL;
+    fence.firstVertex = vertexCount;
+    
+    // Vertices (a circle's centre is its only vertex)
+    uint16_t count = 0;
+    int32_t latE7;
+    int32_t lonE7;
+    while (parseDegrees(cursor, latE7)) {
+        if (!parseDegrees(cursor, lonE7) || vertexCount + count >= GEOFENCE_MAX_VERTICES) {
+            return false;
+        }
+        vertexLat[vertexCount + count] = latE7;
+        vertexLon[vertexCount + count] = lonE7;
+        count++;
+        if (!fence.polygon) {
+            break;
+        }
+    }
+    if (count == 0 || (fence.polygon && count < 3)) {
+        return false;
+    }
+    fence.vertexCount = count;
+    
+    if (fence.polygon) {
+        fence.minLat = fence.maxLat = vertexLat[vertexCount];
+        fence.minLon = fence.maxLon = vertexLon[vertexCount];
+        for (uint16_t i = vertexCount + 1; i < vertexCount + count; i++) {
+            expandBox(fence, vertexLat[i], vertexLat[i], vertexLon[i], vertexLon[i]);
+        }
+    } else {
+        long radiusM = strtol(cursor, &end, 10);
+        if (end == cursor || radiusM <= 0 || radiusM > 1000000) {
+            return false;
+        }
+        fence.radiusCm = (uint32_t)radiusM * 100UL;
+        
+        // Radius in E7: latitude directly, longitude widened by 1/cos(latitude)
+        int32_t latE7Radius = (int32_t)((uint64_t)fence.radiusCm * GPS_CM_PER_E7_DEN / GPS_CM_PER_E7_NUM) + 1;
+        float cosLat = cosf(vertexLat[vertexCount] * GPS_RAD_PER_E7);
+        int32_t lonE7Radius = cosLat > 0.01f ? (int32_t)(latE7Radius / cosLat) + 1 : 1800000000L;
+        int64_t west = (int64_t)vertexLon[vertexCount] - lonE7Radius;
+        int64_t east = (int64_t)vertexLon[vertexCount] + lonE7Radius;
+        fence.minLat = vertexLat[vertexCount] - latE7Radius;
+        fence.maxLat = vertexLat[vertexCount] + latE7Radius;
+        fence.minLon = west < -1800000000LL ? -1800000000L : (int32_t)west;
+        fence.maxLon = east > 1800000000LL ? 1800000000L : (int32_t)east;
+    }
+    
+    vertexCount += count;
+    fenceCount++;
+    return true;
+}
+
+void GeofenceEngine::expandBox(Fence& box, int32_t minLat, int32_t maxLat, int32_t minLon, int32_t maxLon) {
+    if (minLat < box.minLat) {
+        box.minLat = minLat;
+    }
+    if (maxLat > box.maxLat) {
+        box.maxLat = maxLat;
+    }
+    if (minLon < box.minLon) {
+        box.minLon = minLon;
+    }
+    if (maxLon > box.maxLon) {
+        box.maxLon = maxLon;
+    }
+}
+
+bool GeofenceEngine::buildIndex() {
+    Fence bounds = fences[0];
+    for (uint16_t i = 1; i < fenceCount; i++) {
+        expandBox(bounds, fences[i].minLat, fences[i].maxLat, fences[i].minLon, fences[i].maxLon);
+    }
+    gridMinLat = bounds.minLat;
+    gridMinLon = bounds.minLon;
+    cellHeight = (int32_t)(((int64_t)bounds.maxLat - bounds.minLat) / GEOFENCE_GRID_SIZE + 1);
+    cellWidth = (int32_t)(((int64_t)bounds.maxLon - bounds.minLon) / GEOFENCE_GRID_SIZE + 1);
+    
+    // Two passes: count the fences per cell, then fill the flat array
+    uint32_t counts[GEOFENCE_GRID_CELLS + 1] = {};
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint16_t i = 0; i < fenceCount; i++) {
+            const Fence& fence = fences[i];
+            int rowFirst = (int)(((int64_t)fence.minLat - gridMinLat) / cellHeight);
+            int rowLast = (int)(((int64_t)fence.maxLat - gridMinLat) / cellHeight);
+            int colFirst = (int)(((int64_t)fence.minLon - gridMinLon) / cellWidth);
+            int colLast = (int)(((int64_t)fence.maxLon - gridMinLon) / cellWidth);
+            for (int row = rowFirst; row <= rowLast; row++) {
+                for (int col = colFirst; col <= colLast; col++) {
+                    int cell = row * GEOFENCE_GRID_SIZE + col;
+                    if (pass == 0) {
+                        counts[cell + 1]++;
+                    } else {
+                        cellFences[counts[cell]++] = i;
+                    }
+                }
+            }
+        }
+        
+        if (pass == 0) {
+            for (int cell = 0; cell < GEOFENCE_GRID_CELLS; cell++) {
+                counts[cell + 1] += counts[cell];
+            }
+            if (counts[GEOFENCE_GRID_CELLS] > GEOFENCE_MAX_CELL_ENTRIES) {
+                DEBUG_PRINTF("❌ Geofences: index needs %lu entries (GEOFENCE_MAX_CELL_ENTRIES %d)\n",
+                             (unsigned long)counts[GEOFENCE_GRID_CELLS], GEOFENCE_MAX_CELL_ENTRIES);
+                return false;
+            }
+            for (int cell = 0; cell <= GEOFENCE_GRID_CELLS; cell++) {
+                cellStart[cell] = (uint16_t)counts[cell];
+            }
+        }
+    }
+    
+    return true;
+}
+
+int GeofenceEngine::cellIndex(int32_t latE7, int32_t lonE7) {
+    int64_t row = ((int64_t)latE7 - gridMinLat) / cellHeight;
+    int64_t col = ((int64_t)lonE7 - gridMinLon) / cellWidth;
+    if (latE7 < gridMinLat || lonE7 < gridMinLon || row >= GEOFENCE_GRID_SIZE || col >= GEOFENCE_GRID_SIZE) {
+        return -1;
+    }
+    return (int)(row * GEOFENCE_GRID_SIZE + col);
+}
+
+bool GeofenceEngine::insidePolygon(const Fence& fence, int32_t latE7, int32_t lonE7) {
+    // Crossing number; the edge intersection is compared without a division
+    bool inside = false;
+    uint16_t end = fence.firstVertex + fence.vertexCount;
+    for (uint16_t i = fence.firstVertex, j = end - 1; i < end; j = i++) {
+        int64_t yi = vertexLat[i];
+        int64_t yj = vertexLat[j];
+        if ((yi > latE7) == (yj > latE7)) {
+            continue;
+        }
+        int64_t xi = vertexLon[i];
+        int64_t xj = vertexLon[j];
+        int64_t lhs = (lonE7 - xi) * (yj - yi);
+        int64_t rhs = (xj - xi) * (latE7 - yi);
+        if (yj > yi ? lhs < rhs : lhs > rhs) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+bool GeofenceEngine::contains(const Fence& fence, int32_t latE7, int32_t lonE7) {
+    if (latE7 < fence.minLat || latE7 > fence.maxLat || lonE7 < fence.minLon || lonE7 > fence.maxLon) {
+        return false;
+    }
+    
+    exactTests++;
+    if (fence.polygon) {
+        return insidePolygon(fence, latE7, lonE7);
+    }
+    return gpsDistanceSqCm2(vertexLat[fence.firstVertex], vertexLon[fence.firstVertex], latE7, lonE7) <=
+           (uint64_t)fence.radiusCm * fence.radiusCm;
+}
+
+void GeofenceEngine::emit(const Fence& fence, GeofenceEventType type, int32_t latE7, int32_t lonE7, uint32_t nowMs) {
+    // A full queue keeps the older events, so the sequence stays consistent
+    if (eventCount >= GEOFENCE_EVENT_QUEUE) {
+        eventsDropped++;
+        return;
+    }
+    
+    GeofenceEvent& event = events[(eventHead + eventCount) % GEOFENCE_EVENT_QUEUE];
+    event.fenceId = fence.id;
+    event.type = type;
+    event.timestampMs = nowMs;
+    event.latitudeE7 = latE7;
+    event.longitudeE7 = lonE7;
+    event.insideMs = type == GEOFENCE_ENTER ? 0 : nowMs - fence.enteredMs;
+    eventCount++;
+    eventsEmitted++;
+    
+    DEBUG_PRINTF("📍 Geofence %u: %s\n", fence.id, geofenceEventToString(type));
+}
+
+bool GeofenceEngine::update(int32_t latE7, int32_t lonE7, uint32_t nowMs) {
+    if (fenceCount == 0) {
+        return false;
+    }
+    fixesEvaluated++;
+    
+    // Every fence containing the fix is listed in its cell
+    uint16_t containing[GEOFENCE_MAX_TRACKED];
+    uint8_t containingCount = 0;
+    int cell = cellIndex(latE7, lonE7);
+    if (cell >= 0) {
+        for (uint16_t i = cellStart[cell]; i < cellStart[cell + 1] && containingCount < GEOFENCE_MAX_TRACKED; i++) {
+            if (contains(fences[cellFences[i]], latE7, lonE7)) {
+                containing[containingCount++] = cellFences[i];
+            }
+        }
+    }
+    
+    // Inside: confirm entries, check dwell
+    for (uint8_t i = 0; i < containingCount; i++) {
+        Fence& fence = fences[containing[i]];
+        if (fence.inside) {
+            fence.confirm = 0;
+            if (fence.dwellMs > 0 && !fence.dwellReported && nowMs - fence.enteredMs >= fence.dwellMs) {
+                fence.dwellReported = true;
+                emit(fence, GEOFENCE_DWELL, latE7, lonE7, nowMs);
+            }
+            continue;
+        }
+        if (fence.confirm == 0) {
+            if (trackedCount >= GEOFENCE_MAX_TRACKED) {
+                continue;
+            }
+            tracked[trackedCount++] = containing[i];
+        }
+        if (++fence.confirm >= GEOFENCE_CONFIRM_FIXES) {
+            fence.inside = true;
+            fence.confirm = 0;
+            fence.dwellReported = false;
+            fence.enteredMs = nowMs;
+            emit(fence, GEOFENCE_ENTER, latE7, lonE7, nowMs);
+        }
+    }
+    
+    // Outside: confirm exits, drop entries that were not confirmed
+    for (uint8_t i = 0; i < trackedCount;) {
+        Fence& fence = fences[tracked[i]];
+        bool stillInside = false;
+        for (uint8_t j = 0; j < containingCount && !stillInside; j++) {
+            stillInside = containing[j] == tracked[i];
+        }
+        if (stillInside || (fence.inside && ++fence.confirm < GEOFENCE_CONFIRM_FIXES)) {
+            i++;
+            continue;
+        }
+        if (fence.inside) {
+            fence.inside = false;
+            emit(fence, GEOFENCE_EXIT, latE7, lonE7, nowMs);
+        }
+        fence.confirm = 0;
+        tracked[i] = tracked[--trackedCount];
+    }
+    
+    return eventCount > 0;
+}
+
+uint8_t GeofenceEngine::takeEvents(GeofenceEvent* out, uint8_t maxEvents) {
+    uint8_t taken = 0;
+    while (eventCount > 0 && taken < maxEvents) {
+        out[taken++] = events[eventHead];
+        eventHead = (eventHead + 1) % GEOFENCE_EVENT_QUEUE;
+        eventCount--;
+    }
+    return taken;
+}
+
+bool GeofenceEngine::hasEvents() const {
+    return eventCount > 0;
+}
+
+int GeofenceEngine::size() const {
+    return fenceCount;
+}
+
+void GeofenceEngine::printStatus() {
+    Serial.println("--- Geofences ---");
+    Serial.printf("Fences: %u (%u vertices), Index: %dx%d cells, %u entries\n",
+                 fenceCount, vertexCount, GEOFENCE_GRID_SIZE, GEOFENCE_GRID_SIZE,
+                 cellStart[GEOFENCE_GRID_CELLS]);
+    Serial.printf("Fixes: %lu, Exact Tests: %lu (%.2f per fix)\n",
+                 (unsigned long)fixesEvaluated, (unsigned long)exactTests,
+                 fixesEvaluated ? (double)exactTests / fixesEvaluated : 0.0);
+    Serial.printf("Events: %lu emitted, %lu dropped, %u waiting\n",
+                 (unsigned long)eventsEmitted, (unsigned long)eventsDropped, eventCount);
+    
+    for (uint8_t i = 0; i < trackedCount; i++) {
+        const Fence& fence = fences[tracked[i]];
+        if (fence.inside) {
+            Serial.printf("Inside fence %u for %lu s\n", fence.id,
+                         (unsigned long)((millis() - fence.enteredMs) / 1000));
+        }
+    }
+    Serial.println("---");
+}
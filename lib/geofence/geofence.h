@@ -0,0 +1,161 @@
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Geofence event types
+ */
+enum GeofenceEventType : uint8_t {
+    GEOFENCE_ENTER = 0,
+    GEOFENCE_EXIT,
+    GEOFENCE_DWELL              // Inside for the fence's dwell time (once per visit)
+};
+
+/**
+ * Get event type as string
+ * @param type event type
+ * @return "ENTER", "EXIT" or "DWELL"
+ */
+const char* geofenceEventToString(GeofenceEventType type);
+
+/**
+ * One enter/exit/dwell event, fixed-size so it can travel in a sample
+ */
+struct GeofenceEvent {
+    uint16_t fenceId;           // ID from the fence file
+    GeofenceEventType type;
+    uint32_t timestampMs;       // millis() of the confirming fix
+    int32_t latitudeE7;         // Position of the confirming fix
+    int32_t longitudeE7;
+    uint32_t insideMs;          // Time inside the fence (EXIT, DWELL)
+};
+
+/**
+ * GeofenceEngine Class
+ *
+ * Circle and polygon geofences loaded from GEOFENCE_FILE on LittleFS into
+ * fixed arrays. One fence per line, coordinates in decimal degrees:
+ *   C <id> <dwell s> <lat> <lon> <radius m>
+ *   P <id> <dwell s> <lat> <lon> <lat> <lon> <lat> <lon> ...
+ * Lines starting with '#' are comments. Fences must not cross the
+ * antimeridian.
+ *
+ * A uniform GEOFENCE_GRID_SIZE x GEOFENCE_GRID_SIZE grid over the fences'
+ * bounding box indexes them: each cell lists the fences whose bounding box
+ * overlaps it (stored as one flat array with per-cell offsets). A fix looks
+ * up its cell and runs exact tests only on those fences and on the few it
+ * is already inside, so the cost per fix does not grow with the number of
+ * fences.
+ *
+ * Enter and exit need GEOFENCE_CONFIRM_FIXES consecutive fixes, so
+ * position noise at a boundary does not produce event storms. Events are
+ * queued until the caller collects them.
+ */
+class GeofenceEngine {
+private:
+    struct Fence {
+        uint16_t id;
+        bool polygon;
+        bool inside;
+        bool dwellReported;
+        uint8_t confirm;            // Consecutive fixes disagreeing with inside
+        uint16_t firstVertex;       // Circle: the centre
+        uint16_t vertexCount;
+        uint32_t radiusCm;          // Circle only
+        uint32_t dwellMs;           // 0 = no dwell event
+        uint32_t enteredMs;
+        int32_t minLat;             // Bounding box (E7)
+        int32_t minLon;
+        int32_t maxLat;
+        int32_t maxLon;
+    };
+    
+    Fence fences[GEOFENCE_MAX_FENCES];
+    uint16_t fenceCount;
+    int32_t vertexLat[GEOFENCE_MAX_VERTICES];
+    int32_t vertexLon[GEOFENCE_MAX_VERTICES];
+    uint16_t vertexCount;
+    
+    // Grid index: fences of cell c are cellFences[cellStart[c] .. cellStart[c + 1])
+    int32_t gridMinLat;
+    int32_t gridMinLon;
+    int32_t cellHeight;             // E7 per cell
+    int32_t cellWidth;
+    uint16_t cellStart[GEOFENCE_GRID_SIZE * GEOFENCE_GRID_SIZE + 1];
+    uint16_t cellFences[GEOFENCE_MAX_CELL_ENTRIES];
+    
+    // Fences inside or with a pending enter
+    uint16_t tracked[GEOFENCE_MAX_TRACKED];
+    uint8_t trackedCount;
+    
+    // Pending events (ring)
+    GeofenceEvent events[GEOFENCE_EVENT_QUEUE];
+    uint8_t eventHead;
+    uint8_t eventCount;
+    
+    // Statistics
+    uint32_t fixesEvaluated;
+    uint32_t exactTests;
+    uint32_t eventsEmitted;
+    uint32_t eventsDropped;
+    
+    bool parseLine(char* line);
+    bool buildIndex();
+    bool contains(const Fence& fence, int32_t latE7, int32_t lonE7);
+    bool insidePolygon(const Fence& fence, int32_t latE7, int32_t lonE7);
+    int cellIndex(int32_t latE7, int32_t lonE7);
+    void emit(const Fence& fence, GeofenceEventType type, int32_t latE7, int32_t lonE7, uint32_t nowMs);
+    static bool parseDegrees(char*& cursor, int32_t& valueE7);
+    static void expandBox(Fence& box, int32_t minLat, int32_t maxLat, int32_t minLon, int32_t maxLon);
+
+public:
+    /**
+     * Constructor
+     */
+    GeofenceEngine();
+    
+    /**
+     * Load the fences from GEOFENCE_FILE and build the index
+     * (LittleFS must be mounted)
+     * @return true if at least one fence was loaded
+     */
+    bool begin();
+    
+    /**
+     * Evaluate one position fix
+     * @param latE7 latitude in 1e-7 degrees
+     * @param lonE7 longitude in 1e-7 degrees
+     * @param nowMs time of the fix (millis())
+     * @return true if events are waiting
+     */
+    bool update(int32_t latE7, int32_t lonE7, uint32_t nowMs);
+    
+    /**
+     * Move waiting events out of the queue (oldest first)
+     * @param out destination array
+     * @param maxEvents capacity of out
+     * @return number of events copied
+     */
+    uint8_t takeEvents(GeofenceEvent* out, uint8_t maxEvents);
+    
+    /**
+     * Check if events are waiting
+     * @return true if takeEvents() would return any
+     */
+    bool hasEvents() const;
+    
+    /**
+     * Get number of loaded fences
+     * @return fence count
+     */
+    int size() const;
+    
+    /**
+     * Print fences, index and event statistics to Serial
+     */
+    void printStatus();
+};
+
+#endif // GEOFENCE_H
@@ -0,0 +1,97 @@
+#ifndef GPS_FIXED_H
+#define GPS_FIXED_H
+
+#include <Arduino.h>
+
+/**
+ * Fixed-point GPS units used from parsing to serialization:
+ * coordinates in 1e-7 degrees (E7), altitude in mm, speed in mm/s.
+ * The ESP32 FPU is single precision only, so these keep double emulation
+ * out of the per-fix path; decimals are only produced when formatting.
+ */
+
+#define GPS_E7_PER_DEGREE 10000000L
+#define GPS_CM_PER_E7_NUM 111195      // 1e-7 deg on the mean earth radius = 1.11195 cm
+#define GPS_CM_PER_E7_DEN 100000
+#define GPS_RAD_PER_E7 1.7453292519943295e-9f
+
+/**
+ * Convert a decimal-degree constant (e.g. from config.h) at compile time
+ * @param degrees decimal degrees
+ * @return degrees in 1e-7 units
+ */
+constexpr int32_t gpsDegreesToE7(double degrees) {
+    return (int32_t)(degrees * 1e7 + (degrees < 0 ? -0.5 : 0.5));
+}
+
+/**
+ * Integer division rounding half away from zero
+ */
+inline int32_t gpsDivRound(int32_t value, int32_t divisor) {
+    return value >= 0 ? (value + divisor / 2) / divisor : (value - divisor / 2) / divisor;
+}
+
+/**
+ * Convert TinyGPS++ raw degrees (integer degrees + billionths) to E7
+ * @param degrees whole degrees
+ * @param billionths fraction in 1e-9 degrees
+ * @param negative south or west
+ * @return coordinate in 1e-7 degrees
+ */
+inline int32_t gpsRawToE7(uint16_t degrees, uint32_t billionths, bool negative) {
+    int32_t value = (int32_t)degrees * GPS_E7_PER_DEGREE + (int32_t)((billionths + 50) / 100);
+    return negative ? -value : value;
+}
+
+/**
+ * Convert NMEA speed (1/100 knot) to mm/s; 1 knot = 463/90 * 100 mm/s
+ */
+inline int32_t gpsKnotsHundredthsToMms(int32_t value) {
+    return gpsDivRound(value * 463, 90);
+}
+
+/**
+ * Squared equirectangular distance between two E7 positions - exact enough
+ * at deadband distances; compare against a squared threshold
+ * @return distance squared in cm^2
+ */
+inline uint64_t gpsDistanceSqCm2(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+    int64_t dLat = (int64_t)lat2 - lat1;
+    int64_t dLon = (int64_t)lon2 - lon1;
+    if (dLon > 180 * GPS_E7_PER_DEGREE) {
+        dLon -= 360 * GPS_E7_PER_DEGREE;
+    } else if (dLon < -180 * GPS_E7_PER_DEGREE) {
+        dLon += 360 * GPS_E7_PER_DEGREE;
+    }
+    
+    // Meridian convergence: one single-precision cosine, applied in Q15
+    int64_t midLat = ((int64_t)lat1 + lat2) / 2;
+    int32_t cosQ15 = (int32_t)(cosf(midLat * GPS_RAD_PER_E7) * 32768.0f);
+    
+    int64_t y = dLat * GPS_CM_PER_E7_NUM / GPS_CM_PER_E7_DEN;
+    int64_t x = ((dLon * GPS_CM_PER_E7_NUM / GPS_CM_PER_E7_DEN) * cosQ15) >> 15;
+    return (uint64_t)(x * x + y * y);
+}
+
+/**
+ * Format a scaled integer as a decimal string (value / 10^decimals)
+ * @param buffer destination
+ * @param size size of buffer
+ * @param value scaled value
+ * @param decimals digits after the decimal point (0-9)
+ * @return snprintf result
+ */
+inline int gpsFormatFixed(char* buffer, size_t size, int32_t value, uint8_t decimals) {
+    static const uint32_t powers[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    if (decimals == 0 || decimals > 9) {
+        return snprintf(buffer, size, "%ld", (long)value);
+    }
+    return snprintf(buffer, size, "%s%lu.%0*lu", value < 0 ? "-" : "",
+                    (unsigned long)(magnitude / powers[decimals]), decimals,
+                    (unsigned long)(magnitude % powers[decimals]));
+}
+
+#endif // GPS_FIXED_H
@@ -1,17 +1,48 @@
 #include "gps_manager.h"
 #include "config.h"
+#include <esp_timer.h>
+#include <LittleFS.h>
+
+#define GPS_UART_FIFO_LEN 128         // ESP32 UART hardware RX FIFO
+#define GPS_POWER_MODE_ATTEMPTS 3     // Immediate sends of one power mode before backing off
+#define GPS_POWER_MODE_RETRY_MAX_MS 60000  // Longest pause between later resends
+
+static_assert(GPS_NAV_RATE_HZ >= 1 && GPS_NAV_RATE_HZ <= 5, "GPS_NAV_RATE_HZ must be 1-5 (NEO-6M limit)");
+static_assert(GPS_PROTOCOL != GPS_PROTOCOL_UBX || GPS_UBX_CONFIG, "UBX output has to be enabled by GPS_UBX_CONFIG");
+static_assert(MOTION_PARKED_OUTPUT_DIVIDER >= 1 && MOTION_PARKED_OUTPUT_DIVIDER <= 255, "MOTION_PARKED_OUTPUT_DIVIDER must be 1-255");
+
+const char* gpsSignalQualityToString(GpsSignalQuality quality) {
+    switch (quality) {
+        case GPS_QUALITY_EXCELLENT: return "EXCELLENT";
+        case GPS_QUALITY_GOOD:      return "GOOD";
+        case GPS_QUALITY_FAIR:      return "FAIR";
+        case GPS_QUALITY_POOR:      return "POOR";
+        default:                    return "NO_SIGNAL";
+    }
+}
 
 GPSManager::GPSManager() {
     gpsSerial = nullptr;
+    readerTask = nullptr;
     gpsInitialized = false;
-    lastValidUpdate = 0;
+    receiverConfigured = false;
+    lastEpochTime = 0;
+    startAid = 0;
+    startTime = 0;
+    receiverMode = MOTION_MOVING;
+    modeAttempts = 0;
+    memset(ackIds, 0, sizeof(ackIds));
+    ackCount = 0;
+    acksPending = 0;
+    ackRejected = false;
+    ackDeadline = 0;
+    retryPending = false;
+    retryAt = 0;
     lastStatusCheck = 0;
-    latitude = 0.0;
-    longitude = 0.0;
-    altitude = 0.0;
-    speed = 0.0;
-    locationValid = false;
-    timeValid = false;
+    lock = portMUX_INITIALIZER_UNLOCKED;
+    memset(&fix, 0, sizeof(fix));
+    memset(&stats, 0, sizeof(stats));
+    pendingSentences = 0;
     gpsBaudRate = 9600;
     gpsTimeout = GPS_TIMEOUT_MS;
 }
@@ -25,185 +56,875 @@ bool GPSManager::begin(HardwareSerial* serial, int baudRate) {
     gpsSerial = serial;
     gpsBaudRate = baudRate;
     
-    // Initialize GPS serial communication
+    // Initialize GPS serial communication (the RX buffer size must be set first)
+    gpsSerial->setRxBufferSize(GPS_RX_BUFFER_SIZE);
     gpsSerial->begin(gpsBaudRate);
-    
-    DEBUG_PRINTLN("🛰️  GPS Manager initialized");
+    startTime = millis();
+
+#if GPS_UBX_CONFIG
+    // Runs before the reader starts, so the ACKs can be read directly
+    receiverConfigured = configureReceiver();
+#if GPS_WARM_START
+    if (receiverConfigured) {
+        startAid = sendAiding();
+    }
+#endif
+#endif
+
+    gpsSerial->onReceiveError([this](hardwareSerial_error_t error) { handleUartError(error); });
     
     gpsInitialized = true;
     lastStatusCheck = millis();
+
+#if GPS_READER_TASK
+    if (xTaskCreatePinnedToCore(readerEntry, "gps", GPS_TASK_STACK_SIZE, this,
+                                GPS_TASK_PRIORITY, &readerTask, SENSOR_TASK_CORE) == pdPASS) {
+        gpsSerial->onReceive([this]() { xTaskNotifyGive(readerTask); });
+    } else {
+        DEBUG_PRINTLN("⚠️  GPS: Reader task not created - polling from update()");
+        readerTask = nullptr;
+    }
+#endif
+
+    DEBUG_PRINTF("🛰️  GPS Manager initialized (%d baud, %d byte RX buffer, %s)\n",
+                 gpsBaudRate, GPS_RX_BUFFER_SIZE, readerTask ? "reader task" : "polled");
     
     return true;
 }
 
-bool GPSManager::update() {
-    if (!gpsInitialized || !gpsSerial) {
+void GPSManager::discardInput() {
+    while (gpsSerial->available() > 0) {
+        gpsSerial->read();
+    }
+}
+
+bool GPSManager::waitForAck(uint8_t msgClass, uint8_t msgId) {
+    UbxParser parser;
+    unsigned long start = millis();
+    
+    // NMEA keeps arriving meanwhile; the parser skips it
+    while (millis() - start < GPS_ACK_TIMEOUT_MS) {
+        while (gpsSerial->available() > 0) {
+            if (!parser.feed(gpsSerial->read())) {
+                continue;
+            }
+            const uint8_t* payload = parser.getPayload();
+            if (parser.getClass() == UBX_CLASS_ACK && parser.getLength() == 2 &&
+                payload[0] == msgClass && payload[1] == msgId) {
+                return parser.getId() == UBX_ACK_ACK;
+            }
+        }
+        delay(1);
+    }
+    
+    return false;
+}
+
+bool GPSManager::writeUbx(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length) {
+    uint8_t frame[UBX_FRAME_OVERHEAD + UBX_AID_INI_LEN];
+    size_t size = ubxBuildFrame(frame, sizeof(frame), msgClass, msgId, payload, length);
+    if (size == 0) {
+        return false;
+    }
+    
+    gpsSerial->write(frame, size);
+    return true;
+}
+
+bool GPSManager::sendUbx(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length) {
+    if (!writeUbx(msgClass, msgId, payload, length)) {
+        return false;
+    }
+    
+    gpsSerial->flush();
+    return waitForAck(msgClass, msgId);
+}
+
+bool GPSManager::configureReceiver() {
+    // CFG-RATE: measurement period, one solution per measurement, GPS time
+    uint8_t rate[6];
+    ubxPutU16(rate, 1000 / GPS_NAV_RATE_HZ);
+    ubxPutU16(rate + 2, 1);
+    ubxPutU16(rate + 4, 1);
+    
+    // Probe at the default baud, then at the target in case the receiver kept
+    // the configuration of an earlier boot
+    if (!sendUbx(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate))) {
+        gpsSerial->updateBaudRate(GPS_TARGET_BAUDRATE);
+        discardInput();
+        if (!sendUbx(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate))) {
+            gpsSerial->updateBaudRate(gpsBaudRate);
+            DEBUG_PRINTLN("⚠️  GPS: No UBX acknowledgement - receiver left at its defaults");
+            return false;
+        }
+        gpsBaudRate = GPS_TARGET_BAUDRATE;
+    }
+    
+    // CFG-PRT for UART1: 8N1 at the target baud, UBX+NMEA in, the selected
+    // protocol out (UBX stays on for the ACKs). A receiver changing baud
+    // switches right after it, so its ACK is not reliable - CFG-RATE is
+    // repeated to verify
+    uint8_t port[20] = {};
+    port[0] = 1;
+    ubxPutU32(port + 4, 0x000008D0);
+    ubxPutU32(port + 8, GPS_TARGET_BAUDRATE);
+    ubxPutU16(port + 12, 0x0003);
+    ubxPutU16(port + 14, GPS_PROTOCOL == GPS_PROTOCOL_UBX ? 0x0001 : 0x0003);
+    sendUbx(UBX_CLASS_CFG, UBX_CFG_PRT, port, sizeof(port));
+    
+    if (gpsBaudRate != GPS_TARGET_BAUDRATE) {
+        gpsSerial->updateBaudRate(GPS_TARGET_BAUDRATE);
+        discardInput();
+        if (sendUbx(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate))) {
+            gpsBaudRate = GPS_TARGET_BAUDRATE;
+        } else {
+            gpsSerial->updateBaudRate(gpsBaudRate);
+            discardInput();
+            DEBUG_PRINTF("⚠️  GPS: Baud change not confirmed - staying at %d\n", gpsBaudRate);
+        }
+    }
+
+#if GPS_PROTOCOL == GPS_PROTOCOL_UBX
+    // One NAV-PVT per solution replaces all NMEA output
+    static const uint8_t messageRates[][3] = {
+        {UBX_CLASS_NAV, UBX_NAV_PVT, 1}
+    };
+#else
+    // GGA (altitude, satellites) and RMC (speed, date) carry everything the
+    // parser reads; the rest is dropped
+    static const uint8_t messageRates[][3] = {
+        {UBX_CLASS_NMEA, UBX_NMEA_GGA, 1}, {UBX_CLASS_NMEA, UBX_NMEA_RMC, 1},
+        {UBX_CLASS_NMEA, UBX_NMEA_GLL, 0}, {UBX_CLASS_NMEA, UBX_NMEA_GSA, 0},
+        {UBX_CLASS_NMEA, UBX_NMEA_GSV, 0}, {UBX_CLASS_NMEA, UBX_NMEA_VTG, 0}
+    };
+#endif
+
+    // CFG-MSG on the current port
+    int rejected = 0;
+    for (const auto& entry : messageRates) {
+        if (!sendUbx(UBX_CLASS_CFG, UBX_CFG_MSG, entry, sizeof(entry))) {
+            rejected++;
+        }
+    }
+    
+    discardInput();
+    DEBUG_PRINTF("🛰️  GPS configured: %d baud, %d Hz, %s (%d message settings not acknowledged)\n",
+                 gpsBaudRate, GPS_NAV_RATE_HZ,
+                 GPS_PROTOCOL == GPS_PROTOCOL_UBX ? "NAV-PVT" : "GGA+RMC", rejected);
+    
+    return true;
+}
+
+uint8_t GPSManager::sendAiding() {
+    uint8_t aid = 0;
+    
+    // AID-INI is not acknowledged; a receiver that already has a fix ignores it
+    GpsWarmStartRecord saved;
+    if (warmStart.load(saved)) {
+        uint8_t ini[UBX_AID_INI_LEN];
+        aid = GpsWarmStart::buildAidIni(saved, GpsWarmStart::getClock(), ini);
+        writeUbx(UBX_CLASS_AID, UBX_AID_INI, ini, sizeof(ini));
+    }
+    if (sendAidFile()) {
+        aid |= GPS_AID_EPHEMERIS;
+    }
+    gpsSerial->flush();
+    
+    DEBUG_PRINTF("🛰️  GPS aiding: %s\n", gpsAidToString(aid));
+    return aid;
+}
+
+bool GPSManager::sendAidFile() {
+    // The file holds complete UBX frames; the receiver checks them and
+    // drops expired ephemeris itself. The journal formats the filesystem
+    // later if needed - never here
+    if (!LittleFS.begin(false) || !LittleFS.exists(GPS_AID_FILE)) {
+        return false;
+    }
+    File file = LittleFS.open(GPS_AID_FILE, "r");
+    if (!file) {
         return false;
     }
     
-    bool newData = false;
+    uint8_t chunk[128];
+    size_t total = 0;
+    size_t length;
+    while ((length = file.read(chunk, sizeof(chunk))) > 0) {
+        gpsSerial->write(chunk, length);
+        total += length;
+    }
+    file.close();
+    
+    DEBUG_PRINTF("🛰️  GPS: %u bytes of aiding data sent from %s\n", (unsigned)total, GPS_AID_FILE);
+    return total > 0;
+}
+
+void GPSManager::readerEntry(void* param) {
+    static_cast<GPSManager*>(param)->readerLoop();
+}
+
+void GPSManager::readerLoop() {
+    for (;;) {
+        // Woken by UART receive events; the timeout covers a missed notification
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GPS_READER_IDLE_MS));
+        ingest();
+    }
+}
+
+void GPSManager::handleUartError(hardwareSerial_error_t error) {
+    // Runs in the UART event task
+    portENTER_CRITICAL(&lock);
+    if (error == UART_FIFO_OVF_ERROR) {
+        // The driver resets the hardware FIFO, discarding its contents
+        stats.overflows++;
+        stats.bytesDropped += GPS_UART_FIFO_LEN;
+    } else if (error == UART_BUFFER_FULL_ERROR) {
+        stats.overflows++;
+    } else {
+        stats.rxErrors++;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void GPSManager::ingest() {
+    int64_t start = esp_timer_get_time();
+    uint32_t bytes = 0;
+    uint32_t sentences = 0;
+    uint32_t epochs = 0;
     
-    // Read available GPS data
     while (gpsSerial->available() > 0) {
-        if (gps.encode(gpsSerial->read())) {
-            newData = true;
-            
-            // Update location data if valid
-            if (gps.location.isValid()) {
-                latitude = gps.location.lat();
-                longitude = gps.location.lng();
-                locationValid = true;
-                lastValidUpdate = millis();
-                
-                // Remove verbose location update messages
+        uint8_t c = gpsSerial->read();
+        bytes++;
+#if GPS_PROTOCOL == GPS_PROTOCOL_UBX
+        UbxNavPvt pvt;
+        if (!ubx.feed(c)) {
+            continue;
+        }
+        if (ubxDecodeNavPvt(ubx, pvt)) {
+            // Every NAV-PVT is one complete solution
+            sentences++;
+            epochs++;
+            publishPvt(pvt);
+        } else if (acksPending > 0) {
+            noteAck(ubx);
+        }
+#else
+        // The ACK parser only runs while a mode change is unconfirmed
+        if (acksPending > 0 && ackParser.feed(c)) {
+            noteAck(ackParser);
+        }
+        if (gps.encode(c)) {
+            sentences++;
+            if (publishFix()) {
+                epochs++;
             }
-            
-            // Update altitude if valid
-            if (gps.altitude.isValid()) {
-                altitude = gps.altitude.meters();
+        }
+#endif
+    }
+
+#if MOTION_DUTY_CYCLE
+    // Also runs without input, so a lost ACK times out
+    updatePowerMode();
+#endif
+
+    if (bytes == 0) {
+        return;
+    }
+    
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+#if GPS_PROTOCOL == GPS_PROTOCOL_UBX
+    uint32_t failed = ubx.getChecksumErrors();
+#else
+    uint32_t failed = gps.failedChecksum();
+#endif
+
+    portENTER_CRITICAL(&lock);
+    stats.bytesReceived += bytes;
+    stats.sentencesParsed += sentences;
+    stats.epochs += epochs;
+    stats.failedChecksum = failed;
+    stats.parseTimeUs += elapsed;
+    pendingSentences += sentences;
+    portEXIT_CRITICAL(&lock);
+}
+
+#if GPS_PROTOCOL == GPS_PROTOCOL_UBX
+void GPSManager::publishPvt(const UbxNavPvt& pvt) {
+    GpsFix decoded;
+    readFix(decoded);
+    
+    // Integer fields straight from the frame; 2D and better count as a position
+    bool fixOk = (pvt.flags & UBX_PVT_GNSS_FIX_OK) &&
+                 pvt.fixType >= UBX_FIX_2D && pvt.fixType <= UBX_FIX_GNSS_DR;
+    if (fixOk) {
+        decoded.locationValid = true;
+        decoded.latitudeE7 = pvt.lat;
+        decoded.longitudeE7 = pvt.lon;
+        decoded.lastValidUpdate = millis();
+        decoded.speedValid = true;
+        decoded.speedMms = pvt.gSpeed;
+        decoded.accuracyMm = pvt.hAcc;
+        if (pvt.fixType != UBX_FIX_2D) {
+            decoded.altitudeValid = true;
+            decoded.altitudeMm = pvt.hMSL;
+        }
+    }
+    decoded.satellitesValid = true;
+    decoded.satellites = pvt.numSV;
+
+#if POSITION_FILTER_ENABLED
+    // NAV-PVT carries its own horizontal accuracy estimate
+    if (fixOk) {
+        positionFilter.update(pvt.lat, pvt.lon, pvt.hAcc, pvt.numSV, decoded.lastValidUpdate);
+        positionFilter.getEstimate(decoded.filtered);
+    }
+#endif
+    // Time before noteFix(), which sets the clock and saves the fix time from it
+    decoded.timeValid = (pvt.valid & (UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME)) ==
+                        (UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME);
+    if (decoded.timeValid) {
+        decoded.year = pvt.year;
+        decoded.month = pvt.month;
+        decoded.day = pvt.day;
+        decoded.hour = pvt.hour;
+        decoded.minute = pvt.min;
+        decoded.second = pvt.sec;
+    }
+    
+    if (fixOk) {
+        noteFix(decoded);
+        trackMotion(decoded);
+    }
+    
+    portENTER_CRITICAL(&lock);
+    fix = decoded;
+    portEXIT_CRITICAL(&lock);
+}
+#else
+bool GPSManager::publishFix() {
+    // Decode outside the lock, publish with a plain copy
+    GpsFix decoded;
+    readFix(decoded);
+    
+    // GGA and RMC of one solution share its time (hhmmsscc)
+    bool newEpoch = gps.time.isValid() && gps.time.value() != lastEpochTime;
+    if (newEpoch) {
+        lastEpochTime = gps.time.value();
+    }
+    bool locationUpdated = gps.location.isUpdated();
+    
+    if (gps.location.isValid()) {
+        decoded.locationValid = true;
+        // Raw degrees avoid TinyGPS++'s double conversion
+        const RawDegrees& lat = gps.location.rawLat();
+        const RawDegrees& lng = gps.location.rawLng();
+        decoded.latitudeE7 = gpsRawToE7(lat.deg, lat.billionths, lat.negative);
+        decoded.longitudeE7 = gpsRawToE7(lng.deg, lng.billionths, lng.negative);
+        decoded.lastValidUpdate = millis();
+    }
+    if (gps.altitude.isValid()) {
+        decoded.altitudeValid = true;
+        decoded.altitudeMm = gps.altitude.value() * 10;
+    }
+    if (gps.speed.isValid()) {
+        decoded.speedValid = true;
+        decoded.speedMms = gpsKnotsHundredthsToMms(gps.speed.value());
+    }
+    if (gps.satellites.isValid()) {
+        decoded.satellitesValid = true;
+        decoded.satellites = gps.satellites.value();
+    }
+    // NMEA has no accuracy estimate; sigma = HDOP x UERE
+    decoded.accuracyMm = gps.hdop.isValid() ? (uint32_t)(gps.hdop.value() * (POSITION_FILTER_UERE_M * 10.0f)) : 0;
+    
+    decoded.timeValid = gps.date.isValid() && gps.time.isValid();
+    if (decoded.timeValid) {
+        decoded.year = gps.date.year();
+        decoded.month = gps.date.month();
+        decoded.day = gps.date.day();
+        decoded.hour = gps.time.hour();
+        decoded.minute = gps.time.minute();
+        decoded.second = gps.time.second();
+    }
+
+#if POSITION_FILTER_ENABLED
+    // Once per solution, and only with a fresh position
+    if (newEpoch && locationUpdated && decoded.accuracyMm > 0 && decoded.satellitesValid) {
+        positionFilter.update(decoded.latitudeE7, decoded.longitudeE7, decoded.accuracyMm,
+                              decoded.satellites, decoded.lastValidUpdate);
+        positionFilter.getEstimate(decoded.filtered);
+    }
+#endif
+    if (newEpoch && locationUpdated && decoded.locationValid) {
+        noteFix(decoded);
+        trackMotion(decoded);
+    }
+    
+    portENTER_CRITICAL(&lock);
+    fix = decoded;
+    portEXIT_CRITICAL(&lock);
+    
+    return newEpoch;
+}
+#endif
+
+void GPSManager::noteFix(GpsFix& decoded) {
+    if (decoded.ttffMs == 0) {
+        // 0 is reserved for "no fix yet"
+        uint32_t elapsed = decoded.lastValidUpdate - startTime;
+        decoded.ttffMs = elapsed > 0 ? elapsed : 1;
+        DEBUG_PRINTF("🛰️  GPS: First fix after %lu ms (aiding: %s)\n",
+                     (unsigned long)decoded.ttffMs, gpsAidToString(startAid));
+    }
+
+#if GPS_WARM_START
+    uint32_t fixTime = 0;
+    if (decoded.timeValid) {
+        fixTime = GpsWarmStart::toUnixTime(decoded.year, decoded.month, decoded.day,
+                                           decoded.hour, decoded.minute, decoded.second);
+        warmStart.setClock(fixTime);
+    }
+    
+    GpsWarmStartRecord record = {};
+    record.latitudeE7 = decoded.filtered.valid ? decoded.filtered.latitudeE7 : decoded.latitudeE7;
+    record.longitudeE7 = decoded.filtered.valid ? decoded.filtered.longitudeE7 : decoded.longitudeE7;
+    record.altitudeMm = decoded.altitudeValid ? decoded.altitudeMm : 0;
+    record.fixTime = fixTime;
+    warmStart.store(record, decoded.lastValidUpdate);
+#endif
+}
+
+void GPSManager::trackMotion(GpsFix& decoded) {
+    // Filtered position and velocity when available - raw speed and
+    // position jitter at standstill
+    int32_t latE7 = decoded.latitudeE7;
+    int32_t lonE7 = decoded.longitudeE7;
+    uint32_t speedMms = (uint32_t)abs(decoded.speedMms);
+    if (decoded.filtered.valid) {
+        float north = (float)decoded.filtered.velocityNorthMms;
+        float east = (float)decoded.filtered.velocityEastMms;
+        latE7 = decoded.filtered.latitudeE7;
+        lonE7 = decoded.filtered.longitudeE7;
+        speedMms = (uint32_t)sqrtf(north * north + east * east);
+    }
+    
+    if (!motionDetector.update(latE7, lonE7, speedMms, decoded.lastValidUpdate)) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    stats.motionChanges++;
+    if (decoded.motion == MOTION_PARKED) {
+        stats.parkedMs += decoded.lastValidUpdate - decoded.motionSince;
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    decoded.motion = motionDetector.getState();
+    decoded.motionSince = decoded.lastValidUpdate;
+}
+
+void GPSManager::setPowerMode(MotionState mode) {
+    bool parked = mode == MOTION_PARKED;
+    
+    // CFG-RXM: power save (cyclic tracking, CFG-PM2 defaults) or continuous
+    uint8_t rxm[2] = {8, (uint8_t)(parked ? 1 : 0)};
+    
+    // CFG-RATE: power save runs one solution per second
+    uint8_t rate[6];
+    ubxPutU16(rate, parked ? 1000 : 1000 / GPS_NAV_RATE_HZ);
+    ubxPutU16(rate + 2, 1);
+    ubxPutU16(rate + 4, 1);
+    
+    // CFG-MSG: output only every n-th solution while parked
+    uint8_t divider = parked ? MOTION_PARKED_OUTPUT_DIVIDER : 1;
+#if GPS_PROTOCOL == GPS_PROTOCOL_UBX
+    uint8_t outputs[][3] = {
+        {UBX_CLASS_NAV, UBX_NAV_PVT, divider}
+    };
+#else
+    uint8_t outputs[][3] = {
+        {UBX_CLASS_NMEA, UBX_NMEA_GGA, divider}, {UBX_CLASS_NMEA, UBX_NMEA_RMC, divider}
+    };
+#endif
+
+    // Not waiting for the ACKs here keeps the fixes flowing; ingest() counts
+    // them as they arrive. Full rate is restored before leaving power save,
+    // power save is entered last
+    static_assert(2 + sizeof(outputs) / sizeof(outputs[0]) <= sizeof(ackIds), "ackIds holds every mode command");
+    ackCount = 0;
+    if (!parked) {
+        writeUbx(UBX_CLASS_CFG, UBX_CFG_RXM, rxm, sizeof(rxm));
+        ackIds[ackCount++] = UBX_CFG_RXM;
+    }
+    writeUbx(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+    ackIds[ackCount++] = UBX_CFG_RATE;
+    for (const auto& entry : outputs) {
+        writeUbx(UBX_CLASS_CFG, UBX_CFG_MSG, entry, sizeof(entry));
+        ackIds[ackCount++] = UBX_CFG_MSG;
+    }
+    if (parked) {
+        writeUbx(UBX_CLASS_CFG, UBX_CFG_RXM, rxm, sizeof(rxm));
+        ackIds[ackCount++] = UBX_CFG_RXM;
+    }
+    
+    acksPending = ackCount;
+    ackRejected = false;
+    ackDeadline = millis() + GPS_ACK_TIMEOUT_MS;
+#if GPS_PROTOCOL != GPS_PROTOCOL_UBX
+    ackParser.reset();
+#endif
+}
+
+void GPSManager::noteAck(const UbxParser& parser) {
+    const uint8_t* payload = parser.getPayload();
+    if (parser.getClass() != UBX_CLASS_ACK || parser.getLength() != 2 || payload[0] != UBX_CLASS_CFG) {
+        return;
+    }
+    
+    // The receiver answers in command order, so anything but the next
+    // command's id is a late reply to an earlier attempt. The two modes send
+    // their commands in a different order; late replies that still line up
+    // come from the same commands, which the receiver did apply
+    if (payload[1] != ackIds[ackCount - acksPending]) {
+        return;
+    }
+    
+    if (parser.getId() == UBX_ACK_ACK) {
+        acksPending--;
+    } else {
+        ackRejected = true;
+    }
+}
+
+void GPSManager::updatePowerMode() {
+    if (!receiverConfigured) {
+        return;
+    }
+    
+    MotionState wanted = motionDetector.getState() == MOTION_PARKED ? MOTION_PARKED : MOTION_MOVING;
+    
+    if (acksPending > 0) {
+        if (!ackRejected && (long)(millis() - ackDeadline) < 0) {
+            return;
+        }
+        // A receiver in its power save off time can miss the start of a
+        // command - resend the whole mode. Never give up: a receiver stuck
+        // in power save would stay at one output per divider while driving
+        acksPending = 0;
+        if (modeAttempts < 255) {
+            modeAttempts++;
+        }
+        unsigned long pause = 0;
+        if (modeAttempts >= GPS_POWER_MODE_ATTEMPTS) {
+            uint8_t doublings = modeAttempts - GPS_POWER_MODE_ATTEMPTS;
+            pause = doublings < 16 ? (unsigned long)GPS_ACK_TIMEOUT_MS << doublings : GPS_POWER_MODE_RETRY_MAX_MS;
+            if (pause > GPS_POWER_MODE_RETRY_MAX_MS) {
+                pause = GPS_POWER_MODE_RETRY_MAX_MS;
             }
-            
-            // Update speed if valid
-            if (gps.speed.isValid()) {
-                speed = gps.speed.kmph();
+            if (modeAttempts == GPS_POWER_MODE_ATTEMPTS) {
+                DEBUG_PRINTF("⚠️  GPS: %s mode not acknowledged - retrying with backoff\n",
+                             motionStateToString(receiverMode));
             }
-            
-            // Update time validity
-            timeValid = gps.date.isValid() && gps.time.isValid();
         }
+        retryPending = true;
+        retryAt = millis() + pause;
+    }
+    
+    if (receiverMode != wanted) {
+        receiverMode = wanted;
+        modeAttempts = 0;
+        retryPending = false;
+        setPowerMode(wanted);
+        portENTER_CRITICAL(&lock);
+        stats.powerModeSwitches++;
+        portEXIT_CRITICAL(&lock);
+        DEBUG_PRINTF("🛰️  GPS: %s - receiver %s\n", motionStateToString(wanted),
+                     wanted == MOTION_PARKED ? "power save, 1 Hz" : "continuous, full rate");
+    } else if (retryPending && (long)(millis() - retryAt) >= 0) {
+        retryPending = false;
+        portENTER_CRITICAL(&lock);
+        stats.powerModeRetries++;
+        portEXIT_CRITICAL(&lock);
+        setPowerMode(receiverMode);
+    }
+}
+
+void GPSManager::readFix(GpsFix& out) {
+    portENTER_CRITICAL(&lock);
+    out = fix;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool GPSManager::isFresh(const GpsFix& current) {
+    return current.locationValid && (millis() - current.lastValidUpdate <= gpsTimeout);
+}
+
+bool GPSManager::update() {
+    if (!gpsInitialized || !gpsSerial) {
+        return false;
+    }
+    
+    // Without a reader task the UART is drained here
+    if (!readerTask) {
+        ingest();
     }
     
+    portENTER_CRITICAL(&lock);
+    bool newData = pendingSentences > 0;
+    pendingSentences = 0;
+    uint32_t bytesReceived = stats.bytesReceived;
+    portEXIT_CRITICAL(&lock);
+    
     // Check for GPS timeout - only warn occasionally, not continuously
     if (millis() - lastStatusCheck > 30000) { // Check every 30 seconds instead of 5
         lastStatusCheck = millis();
         
-        if (millis() > 5000 && gps.charsProcessed() < 10) {
+        if (millis() > 5000 && bytesReceived < 10) {
             DEBUG_PRINTLN("⚠️  GPS: No data received - check wiring");
-            locationValid = false;
         }
     }
     
-    // Check if location data is stale
-    if (locationValid && (millis() - lastValidUpdate > gpsTimeout)) {
-        locationValid = false;
-        // Don't spam warnings about stale data
-    }
-    
+    // Stale locations are rejected by isLocationValid()
     return newData;
 }
 
 bool GPSManager::isLocationValid() {
-    return locationValid && gps.location.isValid();
+    GpsFix current;
+    readFix(current);
+    return isFresh(current);
 }
 
 bool GPSManager::isGPSActive() {
-    return gpsInitialized && (gps.charsProcessed() > 10);
+    portENTER_CRITICAL(&lock);
+    uint32_t bytesReceived = stats.bytesReceived;
+    portEXIT_CRITICAL(&lock);
+    return gpsInitialized && (bytesReceived > 10);
 }
 
-double GPSManager::getLatitude() {
-    return isLocationValid() ? latitude : 0.0;
+int32_t GPSManager::getLatitudeE7() {
+    GpsFix current;
+    readFix(current);
+    return isFresh(current) ? current.latitudeE7 : 0;
 }
 
-double GPSManager::getLongitude() {
-    return isLocationValid() ? longitude : 0.0;
+int32_t GPSManager::getLongitudeE7() {
+    GpsFix current;
+    readFix(current);
+    return isFresh(current) ? current.longitudeE7 : 0;
 }
 
-double GPSManager::getAltitude() {
-    return (gps.altitude.isValid()) ? altitude : 0.0;
+int32_t GPSManager::getAltitudeMm() {
+    GpsFix current;
+    readFix(current);
+    return current.altitudeValid ? current.altitudeMm : 0;
 }
 
-double GPSManager::getSpeed() {
-    return (gps.speed.isValid()) ? speed : 0.0;
+int32_t GPSManager::getSpeedMms() {
+    GpsFix current;
+    readFix(current);
+    return current.speedValid ? current.speedMms : 0;
 }
 
 int GPSManager::getSatelliteCount() {
-    return gps.satellites.isValid() ? gps.satellites.value() : 0;
+    GpsFix current;
+    readFix(current);
+    return current.satellitesValid ? current.satellites : 0;
 }
 
 String GPSManager::getFormattedDateTime() {
-    if (!isTimeValid()) {
+    GpsFix current;
+    readFix(current);
+    if (!current.timeValid) {
         return "INVALID";
     }
     
     char dateTime[32];
     snprintf(dateTime, sizeof(dateTime), "%04d-%02d-%02d %02d:%02d:%02d",
-             gps.date.year(), gps.date.month(), gps.date.day(),
-             gps.time.hour(), gps.time.minute(), gps.time.second());
+             current.year, current.month, current.day,
+             current.hour, current.minute, current.second);
     
     return String(dateTime);
 }
 
 unsigned long GPSManager::getTimeSinceLastUpdate() {
-    return millis() - lastValidUpdate;
+    GpsFix current;
+    readFix(current);
+    return millis() - current.lastValidUpdate;
 }
 
 void GPSManager::printGPSStatus() {
+    GpsFix current;
+    readFix(current);
+    char number[16];
+    
     Serial.println("--- GPS Status ---");
     Serial.printf("GPS Active: %s\n", isGPSActive() ? "YES" : "NO");
-    Serial.printf("Location Valid: %s\n", isLocationValid() ? "YES" : "NO");
-    Serial.printf("Time Valid: %s\n", isTimeValid() ? "YES" : "NO");
+    Serial.printf("Location Valid: %s\n", isFresh(current) ? "YES" : "NO");
+    Serial.printf("Time Valid: %s\n", current.timeValid ? "YES" : "NO");
     
-    if (isLocationValid()) {
-        Serial.printf("Latitude: %.6f°\n", getLatitude());
-        Serial.printf("Longitude: %.6f°\n", getLongitude());
+    if (isFresh(current)) {
+        gpsFormatFixed(number, sizeof(number), current.latitudeE7, 7);
+        Serial.printf("Latitude: %s°\n", number);
+        gpsFormatFixed(number, sizeof(number), current.longitudeE7, 7);
+        Serial.printf("Longitude: %s°\n", number);
     } else {
         Serial.println("Location: INVALID");
     }
     
-    if (gps.altitude.isValid()) {
-        Serial.printf("Altitude: %.2f m\n", getAltitude());
+    if (isFresh(current) && current.filtered.valid) {
+        const PositionEstimate& filtered = current.filtered;
+        char longitude[16];
+        gpsFormatFixed(number, sizeof(number), filtered.latitudeE7, 7);
+        gpsFormatFixed(longitude, sizeof(longitude), filtered.longitudeE7, 7);
+        Serial.printf("Filtered: %s°, %s° (±%lu mm)\n", number, longitude,
+                     (unsigned long)filtered.uncertaintyMm);
+        Serial.printf("Velocity: N %ld mm/s, E %ld mm/s | Fixes used %lu, rejected %lu\n",
+                     (long)filtered.velocityNorthMms, (long)filtered.velocityEastMms,
+                     (unsigned long)filtered.accepted, (unsigned long)filtered.rejected);
+    }
+    
+    if (current.altitudeValid) {
+        gpsFormatFixed(number, sizeof(number), gpsDivRound(current.altitudeMm, 10), 2);
+        Serial.printf("Altitude: %s m\n", number);
     } else {
         Serial.println("Altitude: INVALID");
     }
     
-    if (gps.speed.isValid()) {
-        Serial.printf("Speed: %.2f km/h\n", getSpeed());
+    if (current.speedValid) {
+        // mm/s * 0.36 = 1/100 km/h
+        gpsFormatFixed(number, sizeof(number), gpsDivRound(current.speedMms * 36, 100), 2);
+        Serial.printf("Speed: %s km/h\n", number);
     } else {
         Serial.println("Speed: INVALID");
     }
     
+    if (current.motion != MOTION_UNKNOWN) {
+        Serial.printf("Motion: %s for %lu s\n", motionStateToString(current.motion),
+                     (unsigned long)((millis() - current.motionSince) / 1000));
+    }
+    
     Serial.printf("Satellites: %d\n", getSatelliteCount());
     Serial.printf("Signal Quality: %s\n", getSignalQuality().c_str());
     Serial.printf("GPS Date&Time: %s\n", getFormattedDateTime().c_str());
-    Serial.printf("Time Since Last Update: %lu ms\n", getTimeSinceLastUpdate());
-    Serial.printf("Characters Processed: %lu\n", gps.charsProcessed());
+    Serial.printf("Time Since Last Update: %lu ms\n", millis() - current.lastValidUpdate);
     Serial.println("---");
 }
 
 void GPSManager::printDebugInfo() {
+    GpsUartStats current;
+    getUartStats(current);
+    
     Serial.println("--- GPS Debug Info ---");
     Serial.printf("GPS Initialized: %s\n", gpsInitialized ? "YES" : "NO");
     Serial.printf("Serial Port: %s\n", gpsSerial ? "Connected" : "NULL");
     Serial.printf("Baud Rate: %d\n", gpsBaudRate);
     Serial.printf("Timeout: %lu ms\n", gpsTimeout);
-    Serial.printf("Characters Processed: %lu\n", gps.charsProcessed());
-    Serial.printf("Sentences with Fix: %lu\n", gps.sentencesWithFix());
-    Serial.printf("Failed Checksum: %lu\n", gps.failedChecksum());
-    Serial.printf("Passed Checksum: %lu\n", gps.passedChecksum());
+    Serial.printf("Reader: %s, RX Buffer: %d bytes\n",
+                 readerTask ? "task" : "polled", GPS_RX_BUFFER_SIZE);
+    Serial.printf("Protocol: %s, Receiver Config: %s\n",
+                 GPS_PROTOCOL == GPS_PROTOCOL_UBX ? "UBX NAV-PVT" : "NMEA",
+                 receiverConfigured ? "UBX acknowledged" : "receiver defaults");
+    Serial.printf("Bytes Received: %lu\n", (unsigned long)current.bytesReceived);
+    Serial.printf("Bytes Dropped: %lu+ (%lu overflows, %lu line errors)\n",
+                 (unsigned long)current.bytesDropped, (unsigned long)current.overflows,
+                 (unsigned long)current.rxErrors);
+    Serial.printf("Sentences Parsed: %lu\n", (unsigned long)current.sentencesParsed);
+    Serial.printf("Failed Checksum: %lu\n", (unsigned long)current.failedChecksum);
+    Serial.printf("Parse CPU Time: %llu us (%.1f us/byte)\n",
+                 (unsigned long long)current.parseTimeUs,
+                 current.bytesReceived ? (double)current.parseTimeUs / current.bytesReceived : 0.0);
+    if (current.epochs > 0) {
+        Serial.printf("Per Fix: %lu epochs, %.0f bytes, %.0f us parse\n",
+                     (unsigned long)current.epochs,
+                     (double)current.bytesReceived / current.epochs,
+                     (double)current.parseTimeUs / current.epochs);
+    }
+    GpsFix latest;
+    readFix(latest);
+    if (latest.ttffMs > 0) {
+        Serial.printf("Start: %s aiding, first fix after %lu ms\n",
+                     gpsAidToString(startAid), (unsigned long)latest.ttffMs);
+    } else {
+        Serial.printf("Start: %s aiding, no fix yet (%lu ms)\n",
+                     gpsAidToString(startAid), (unsigned long)(millis() - startTime));
+    }
+    Serial.printf("Duty Cycle: %s | %lu motion changes | %lu s parked (completed stops)\n",
+                 MOTION_DUTY_CYCLE && receiverConfigured ? "receiver power save when parked" : "off",
+                 (unsigned long)current.motionChanges, (unsigned long)(current.parkedMs / 1000));
+    Serial.printf("Power Mode Changes: %lu (%lu resent)\n",
+                 (unsigned long)current.powerModeSwitches, (unsigned long)current.powerModeRetries);
     
     printGPSStatus();
 }
 
 bool GPSManager::isTimeValid() {
-    return timeValid;
+    GpsFix current;
+    readFix(current);
+    return current.timeValid;
 }
 
-String GPSManager::getSignalQuality() {
+GpsSignalQuality GPSManager::classifySignalQuality(int satellites) {
     if (!isGPSActive()) {
-        return "NO_SIGNAL";
+        return GPS_QUALITY_NO_SIGNAL;
     }
     
-    int satellites = getSatelliteCount();
-    
     if (satellites >= 8) {
-        return "EXCELLENT";
+        return GPS_QUALITY_EXCELLENT;
     } else if (satellites >= 6) {
-        return "GOOD";
+        return GPS_QUALITY_GOOD;
     } else if (satellites >= 4) {
-        return "FAIR";
+        return GPS_QUALITY_FAIR;
     } else if (satellites > 0) {
-        return "POOR";
+        return GPS_QUALITY_POOR;
+    } else {
+        return GPS_QUALITY_NO_SIGNAL;
+    }
+}
+
+String GPSManager::getSignalQuality() {
+    return gpsSignalQualityToString(classifySignalQuality(getSatelliteCount()));
+}
+
+void GPSManager::getSnapshot(GpsSnapshot& snapshot) {
+    // One copy of the published fix keeps the record self-consistent
+    GpsFix current;
+    readFix(current);
+    
+    snapshot.initialized = gpsInitialized;
+    snapshot.active = isGPSActive();
+    snapshot.locationValid = isFresh(current);
+    snapshot.timeValid = current.timeValid;
+    snapshot.satellites = current.satellitesValid ? current.satellites : 0;
+    snapshot.signalQuality = classifySignalQuality(snapshot.satellites);
+    snapshot.latitudeE7 = snapshot.locationValid ? current.latitudeE7 : 0;
+    snapshot.longitudeE7 = snapshot.locationValid ? current.longitudeE7 : 0;
+    snapshot.altitudeMm = current.altitudeValid ? current.altitudeMm : 0;
+    snapshot.speedMms = current.speedValid ? current.speedMms : 0;
+    snapshot.accuracyMm = snapshot.locationValid ? current.accuracyMm : 0;
+    snapshot.filtered = current.filtered;
+    snapshot.filtered.valid = snapshot.filtered.valid && snapshot.locationValid;
+    snapshot.motion = current.motion;
+    snapshot.ttffMs = current.ttffMs;
+    snapshot.startAid = startAid;
+    
+    if (snapshot.timeValid) {
+        snapshot.year = current.year;
+        snapshot.month = current.month;
+        snapshot.day = current.day;
+        snapshot.hour = current.hour;
+        snapshot.minute = current.minute;
+        snapshot.second = current.second;
     } else {
-        return "NO_SIGNAL";
+        snapshot.year = 0;
+        snapshot.month = snapshot.day = 0;
+        snapshot.hour = snapshot.minute = snapshot.second = 0;
     }
-}
\ No newline at end of file
+    
+    snapshot.timeSinceUpdate = millis() - current.lastValidUpdate;
+}
+
+void GPSManager::getUartStats(GpsUartStats& out) {
+    portENTER_CRITICAL(&lock);
+    out = stats;
+    portEXIT_CRITICAL(&lock);
+}
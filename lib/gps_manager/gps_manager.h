@@ -4,35 +4,201 @@
 #include <Arduino.h>
 #include <TinyGPS++.h>
 #include <HardwareSerial.h>
+#include "config.h"
+#include "ubx_protocol.h"
+#include "gps_fixed.h"
+#include "position_filter.h"
+#include "motion_detector.h"
+#include "gps_warm_start.h"
+
+/**
+ * GPS signal quality classification (based on satellite count)
+ */
+enum GpsSignalQuality : uint8_t {
+    GPS_QUALITY_NO_SIGNAL = 0,
+    GPS_QUALITY_POOR,
+    GPS_QUALITY_FAIR,
+    GPS_QUALITY_GOOD,
+    GPS_QUALITY_EXCELLENT
+};
+
+/**
+ * Get GPS signal quality as string
+ * @param quality quality classification
+ * @return "EXCELLENT", "GOOD", "FAIR", "POOR", or "NO_SIGNAL"
+ */
+const char* gpsSignalQualityToString(GpsSignalQuality quality);
+
+/**
+ * Fixed-size copy of the GPS state, safe to hand to another task
+ */
+struct GpsSnapshot {
+    bool initialized;
+    bool active;
+    bool locationValid;
+    bool timeValid;
+    GpsSignalQuality signalQuality;
+    uint8_t satellites;
+    int32_t latitudeE7;           // 1e-7 degrees
+    int32_t longitudeE7;          // 1e-7 degrees
+    int32_t altitudeMm;           // Above mean sea level
+    int32_t speedMms;             // Ground speed
+    uint32_t accuracyMm;          // Raw fix 1-sigma horizontal error (0 = unknown)
+    PositionEstimate filtered;    // Kalman estimate next to the raw fix
+    MotionState motion;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint32_t timeSinceUpdate;
+    uint32_t ttffMs;              // Boot to first fix, 0 until then
+    uint8_t startAid;             // GPS_AID_* sent to the receiver at boot
+};
+
+/**
+ * UART ingestion and duty-cycle counters
+ */
+struct GpsUartStats {
+    uint32_t bytesReceived;
+    uint32_t bytesDropped;        // Lower bound: one hardware FIFO per overflow
+    uint32_t overflows;           // RX buffer full / FIFO overflow events
+    uint32_t rxErrors;            // Framing, parity and break errors
+    uint32_t sentencesParsed;
+    uint32_t epochs;              // Navigation solutions (distinct fix times)
+    uint32_t failedChecksum;
+    uint64_t parseTimeUs;         // CPU time spent draining and parsing
+    uint32_t motionChanges;       // Parked/moving transitions
+    uint32_t parkedMs;            // Completed parked periods
+    uint32_t powerModeSwitches;   // Receiver power mode changes commanded
+    uint32_t powerModeRetries;    // Mode commands resent after a NAK or timeout
+};
 
 /**
  * GPS Manager Class
  * 
  * Manages GPS functionality using TinyGPS++ library
  * Provides location data, time synchronization, and GPS status monitoring
+ * 
+ * With GPS_UBX_CONFIG the receiver is first switched to GPS_TARGET_BAUDRATE,
+ * GPS_NAV_RATE_HZ and GGA/RMC only, each step verified by its UBX ACK.
+ * With GPS_WARM_START it is then aided with the last saved fix and the
+ * system clock (AID-INI) and the optional GPS_AID_FILE, and the time to
+ * first fix is measured.
+ * 
+ * GPS_PROTOCOL selects the decoder at build time: NMEA through TinyGPS++,
+ * or binary UBX NAV-PVT, where one checksummed frame carries the whole
+ * solution as integers and is decoded with a single copy.
+ * 
+ * With GPS_READER_TASK the UART is drained by a dedicated task woken by
+ * receive events, so NMEA keeps flowing into the parser while the other
+ * tasks are busy. Decoded fields are published under a lock; the getters
+ * only read that published copy.
+ * 
+ * Every solution also feeds a MotionDetector. With MOTION_DUTY_CYCLE a
+ * parked unit's receiver is switched to power save at 1 Hz with only every
+ * MOTION_PARKED_OUTPUT_DIVIDER-th fix output, and back to full rate on the
+ * first fix that shows movement.
  */
 class GPSManager {
 private:
-    TinyGPSPlus gps;
+    /**
+     * Decoded fields shared between the reader and the getters
+     */
+    struct GpsFix {
+        bool locationValid;
+        bool altitudeValid;
+        bool speedValid;
+        bool satellitesValid;
+        bool timeValid;
+        int32_t latitudeE7;
+        int32_t longitudeE7;
+        int32_t altitudeMm;
+        int32_t speedMms;
+        uint32_t accuracyMm;
+        PositionEstimate filtered;
+        MotionState motion;
+        unsigned long motionSince;
+        uint32_t ttffMs;
+        uint8_t satellites;
+        uint16_t year;
+        uint8_t month;
+        uint8_t day;
+        uint8_t hour;
+        uint8_t minute;
+        uint8_t second;
+        unsigned long lastValidUpdate;
+    };
+
+#if GPS_PROTOCOL == GPS_PROTOCOL_UBX
+    UbxParser ubx;                // Reader context only
+#else
+    TinyGPSPlus gps;              // Reader context only
+#endif
     HardwareSerial* gpsSerial;
+    TaskHandle_t readerTask;
     
     // GPS status tracking
     bool gpsInitialized;
-    unsigned long lastValidUpdate;
+    bool receiverConfigured;      // UBX configuration acknowledged
+    uint32_t lastEpochTime;       // NMEA epoch detection (reader context only)
+    PositionFilter positionFilter;  // Reader context only
+    MotionDetector motionDetector;  // Reader context only
+    GpsWarmStart warmStart;       // Reader context after begin()
+    uint8_t startAid;
+    unsigned long startTime;
+    
+    // Receiver power mode (reader context only)
+    MotionState receiverMode;     // Power mode last commanded
+    uint8_t modeAttempts;         // Failed sends of that mode
+    uint8_t ackIds[4];            // CFG ids of the mode commands, in send order
+    uint8_t ackCount;             // Mode commands sent
+    uint8_t acksPending;          // Mode commands not acknowledged yet
+    bool ackRejected;
+    unsigned long ackDeadline;
+    bool retryPending;            // Mode resend waiting for retryAt
+    unsigned long retryAt;
+#if GPS_PROTOCOL != GPS_PROTOCOL_UBX
+    UbxParser ackParser;          // Picks the ACKs out of the NMEA stream
+#endif
     unsigned long lastStatusCheck;
     
-    // GPS data
-    double latitude;
-    double longitude;
-    double altitude;
-    double speed;
-    bool locationValid;
-    bool timeValid;
+    // Published state (guarded by lock)
+    portMUX_TYPE lock;
+    GpsFix fix;
+    GpsUartStats stats;
+    uint32_t pendingSentences;    // Sentences since the last update()
     
     // Configuration
     int gpsBaudRate;
     unsigned long gpsTimeout;
     
+    static void readerEntry(void* param);
+    void readerLoop();
+    bool configureReceiver();
+    bool writeUbx(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length);
+    bool sendUbx(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t length);
+    bool waitForAck(uint8_t msgClass, uint8_t msgId);
+    uint8_t sendAiding();
+    bool sendAidFile();
+    void discardInput();
+    void ingest();
+#if GPS_PROTOCOL == GPS_PROTOCOL_UBX
+    void publishPvt(const UbxNavPvt& pvt);
+#else
+    bool publishFix();
+#endif
+    void noteFix(GpsFix& decoded);
+    void trackMotion(GpsFix& decoded);
+    void setPowerMode(MotionState mode);
+    void noteAck(const UbxParser& parser);
+    void updatePowerMode();
+    void handleUartError(hardwareSerial_error_t error);
+    void readFix(GpsFix& out);
+    bool isFresh(const GpsFix& current);
+    GpsSignalQuality classifySignalQuality(int satellites);
+
 public:
     /**
      * Constructor
@@ -48,8 +214,9 @@ public:
     bool begin(HardwareSerial* serial, int baudRate = 9600);
     
     /**
-     * Update GPS data (call frequently in main loop)
-     * @return true if new valid data was received
+     * Update GPS data (call frequently in main loop); drains the UART
+     * itself only when no reader task is running
+     * @return true if new sentences were parsed since the last call
      */
     bool update();
     
@@ -67,27 +234,27 @@ public:
     
     /**
      * Get current latitude
-     * @return latitude in decimal degrees (returns 0.0 if invalid)
+     * @return latitude in 1e-7 degrees (returns 0 if invalid)
      */
-    double getLatitude();
+    int32_t getLatitudeE7();
     
     /**
      * Get current longitude
-     * @return longitude in decimal degrees (returns 0.0 if invalid)
+     * @return longitude in 1e-7 degrees (returns 0 if invalid)
      */
-    double getLongitude();
+    int32_t getLongitudeE7();
     
     /**
      * Get current altitude
-     * @return altitude in meters (returns 0.0 if invalid)
+     * @return altitude in millimeters (returns 0 if invalid)
      */
-    double getAltitude();
+    int32_t getAltitudeMm();
     
     /**
      * Get current speed
-     * @return speed in km/h (returns 0.0 if invalid)
+     * @return speed in mm/s (returns 0 if invalid)
      */
-    double getSpeed();
+    int32_t getSpeedMms();
     
     /**
      * Get number of satellites in view
@@ -128,6 +295,18 @@ public:
      * @return "EXCELLENT", "GOOD", "FAIR", "POOR", or "NO_SIGNAL"
      */
     String getSignalQuality();
+    
+    /**
+     * Copy current GPS state into a snapshot record
+     * @param snapshot destination record
+     */
+    void getSnapshot(GpsSnapshot& snapshot);
+    
+    /**
+     * Copy the UART ingestion and duty-cycle counters
+     * @param out destination record
+     */
+    void getUartStats(GpsUartStats& out);
 };
 
 #endif // GPS_MANAGER_H
\ No newline at end of file
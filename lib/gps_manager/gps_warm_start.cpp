@@ -0,0 +1,143 @@
+#include "gps_warm_start.h"
+#include "ubx_protocol.h"
+#include <Preferences.h>
+#include <sys/time.h>
+#include <time.h>
+
+#define GPS_WARM_MAGIC 0x47505331       // "GPS1"
+#define GPS_WARM_NAMESPACE "gps_warm"
+#define GPS_WARM_KEY "record"
+#define GPS_EPOCH_UNIX 315964800UL      // 1980-01-06, GPS week 0
+#define GPS_LEAP_SECONDS 18             // GPS - UTC since 2017
+#define GPS_SECONDS_PER_WEEK 604800UL
+#define GPS_MIN_UNIX_TIME 1577836800UL  // 2020-01-01: older clocks were never set
+
+// Not initialized at boot, so it survives every reset except power-on
+static RTC_NOINIT_ATTR GpsWarmStartRecord rtcRecord;
+
+const char* gpsAidToString(uint8_t aid) {
+    static const char* const names[] = {
+        "none", "position", "time", "position+time",
+        "ephemeris", "position+ephemeris", "time+ephemeris", "position+time+ephemeris"
+    };
+    return names[aid & 0x07];
+}
+
+GpsWarmStart::GpsWarmStart() {
+    lastNvsSave = 0;
+    nvsSaved = false;
+    clockSet = false;
+}
+
+uint32_t GpsWarmStart::computeChecksum(const GpsWarmStartRecord& record) {
+    // FNV-1a over everything except the checksum itself
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(GpsWarmStartRecord, checksum); i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool GpsWarmStart::isValid(const GpsWarmStartRecord& record) {
+    return record.magic == GPS_WARM_MAGIC && record.checksum == computeChecksum(record);
+}
+
+bool GpsWarmStart::load(GpsWarmStartRecord& record) {
+    if (isValid(rtcRecord)) {
+        record = rtcRecord;
+        return true;
+    }
+    
+    GpsWarmStartRecord stored = {};
+    Preferences prefs;
+    if (prefs.begin(GPS_WARM_NAMESPACE, true)) {
+        if (prefs.getBytesLength(GPS_WARM_KEY) == sizeof(stored)) {
+            prefs.getBytes(GPS_WARM_KEY, &stored, sizeof(stored));
+        }
+        prefs.end();
+    }
+    
+    if (isValid(stored)) {
+        record = stored;
+        rtcRecord = stored;
+        return true;
+    }
+    
+    return false;
+}
+
+void GpsWarmStart::store(GpsWarmStartRecord& record, uint32_t nowMs) {
+    record.magic = GPS_WARM_MAGIC;
+    record.checksum = computeChecksum(record);
+    
+    rtcRecord = record;
+    
+    // Avoid flash wear - the RTC copy covers the soft resets in between
+    if (nvsSaved && nowMs - lastNvsSave < GPS_WARM_START_SAVE_MS) {
+        return;
+    }
+    
+    Preferences prefs;
+    if (prefs.begin(GPS_WARM_NAMESPACE, false)) {
+        prefs.putBytes(GPS_WARM_KEY, &record, sizeof(record));
+        prefs.end();
+        DEBUG_PRINTLN("💾 GPS warm start fix saved");
+    }
+    nvsSaved = true;
+    lastNvsSave = nowMs;
+}
+
+void GpsWarmStart::setClock(uint32_t unixTime) {
+    if (clockSet || unixTime < GPS_MIN_UNIX_TIME) {
+        return;
+    }
+    
+    struct timeval now = {};
+    now.tv_sec = unixTime;
+    settimeofday(&now, nullptr);
+    clockSet = true;
+}
+
+uint32_t GpsWarmStart::getClock() {
+    time_t now = time(nullptr);
+    return now >= (time_t)GPS_MIN_UNIX_TIME ? (uint32_t)now : 0;
+}
+
+uint32_t GpsWarmStart::toUnixTime(uint16_t year, uint8_t month, uint8_t day,
+                                  uint8_t hour, uint8_t minute, uint8_t second) {
+    // Days since 1970-01-01 in the proleptic Gregorian calendar, March-based year
+    int32_t y = year - (month <= 2 ? 1 : 0);
+    int32_t era = y / 400;
+    int32_t yearOfEra = y - era * 400;
+    int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int32_t days = era * 146097 + dayOfEra - 719468;
+    
+    return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+uint8_t GpsWarmStart::buildAidIni(const GpsWarmStartRecord& record, uint32_t unixTime, uint8_t* payload) {
+    memset(payload, 0, UBX_AID_INI_LEN);
+    
+    // Position as lat/lon/alt; centimetres for altitude and accuracy
+    uint32_t flags = UBX_AID_INI_POS_VALID | UBX_AID_INI_LLA;
+    ubxPutU32(payload, (uint32_t)record.latitudeE7);
+    ubxPutU32(payload + 4, (uint32_t)record.longitudeE7);
+    ubxPutU32(payload + 8, (uint32_t)(record.altitudeMm / 10));
+    ubxPutU32(payload + 12, GPS_AID_POSITION_ACC_M * 100UL);
+    uint8_t aid = GPS_AID_POSITION;
+    
+    // Time as GPS week and time of week
+    if (unixTime >= GPS_MIN_UNIX_TIME) {
+        uint32_t gpsSeconds = unixTime - GPS_EPOCH_UNIX + GPS_LEAP_SECONDS;
+        ubxPutU16(payload + 18, (uint16_t)(gpsSeconds / GPS_SECONDS_PER_WEEK));
+        ubxPutU32(payload + 20, (gpsSeconds % GPS_SECONDS_PER_WEEK) * 1000UL);
+        ubxPutU32(payload + 28, GPS_AID_TIME_ACC_MS);
+        flags |= UBX_AID_INI_TIME_VALID;
+        aid |= GPS_AID_TIME;
+    }
+    
+    ubxPutU32(payload + 44, flags);
+    return aid;
+}
@@ -0,0 +1,100 @@
+#ifndef GPS_WARM_START_H
+#define GPS_WARM_START_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Aiding sent to the receiver at boot (GpsSnapshot::startAid bits)
+#define GPS_AID_POSITION 0x01
+#define GPS_AID_TIME 0x02
+#define GPS_AID_EPHEMERIS 0x04
+
+/**
+ * Get the aiding mask as string
+ * @param aid GPS_AID_* bits
+ * @return e.g. "position+time", or "none" for a cold start
+ */
+const char* gpsAidToString(uint8_t aid);
+
+/**
+ * Last good fix, kept for the next boot
+ */
+struct GpsWarmStartRecord {
+    uint32_t magic;
+    int32_t latitudeE7;
+    int32_t longitudeE7;
+    int32_t altitudeMm;
+    uint32_t fixTime;        // Unix time of the fix, 0 if unknown
+    uint32_t checksum;
+};
+
+/**
+ * GpsWarmStart Class
+ * 
+ * Keeps the last good fix in RTC memory (survives soft resets, watchdog and
+ * brownout resets) and in NVS (survives power loss), like the WiFi connect
+ * cache. RTC memory is preferred on load and can be written on every fix;
+ * NVS is written at most every GPS_WARM_START_SAVE_MS.
+ * 
+ * The ESP32 keeps its system clock across soft resets, so once GPS time
+ * has set it, the next boot can aid the receiver with time as well.
+ */
+class GpsWarmStart {
+private:
+    uint32_t lastNvsSave;
+    bool nvsSaved;
+    bool clockSet;
+    
+    static uint32_t computeChecksum(const GpsWarmStartRecord& record);
+    static bool isValid(const GpsWarmStartRecord& record);
+
+public:
+    /**
+     * Constructor
+     */
+    GpsWarmStart();
+    
+    /**
+     * Load the saved fix
+     * @param record destination record
+     * @return true if a valid record exists
+     */
+    bool load(GpsWarmStartRecord& record);
+    
+    /**
+     * Store a fix (RTC always, NVS on the first call and then every GPS_WARM_START_SAVE_MS)
+     * @param record record to store (magic and checksum are filled in)
+     * @param nowMs millis() of the fix
+     */
+    void store(GpsWarmStartRecord& record, uint32_t nowMs);
+    
+    /**
+     * Set the system clock from GPS time (once per boot)
+     * @param unixTime UTC seconds since 1970
+     */
+    void setClock(uint32_t unixTime);
+    
+    /**
+     * Get the system clock if it has been set (this boot or before a soft reset)
+     * @return UTC seconds since 1970, 0 if the clock is not set
+     */
+    static uint32_t getClock();
+    
+    /**
+     * Convert a UTC calendar date to Unix time
+     * @return seconds since 1970-01-01
+     */
+    static uint32_t toUnixTime(uint16_t year, uint8_t month, uint8_t day,
+                               uint8_t hour, uint8_t minute, uint8_t second);
+    
+    /**
+     * Fill a UBX AID-INI payload with a saved position and the current time
+     * @param record saved fix
+     * @param unixTime current UTC time, 0 to aid with the position only
+     * @param payload UBX_AID_INI_LEN bytes
+     * @return GPS_AID_* bits set in the payload
+     */
+    static uint8_t buildAidIni(const GpsWarmStartRecord& record, uint32_t unixTime, uint8_t* payload);
+};
+
+#endif // GPS_WARM_START_H
@@ -0,0 +1,427 @@
+#include "https_connection.h"
+#include <WiFi.h>
+
+HttpsConnection::HttpsConnection() {
+    host = nullptr;
+    port = 443;
+    dnsResolvedAt = 0;
+    dnsValid = false;
+    connectionOpen = false;
+    lastActivity = 0;
+    requestCount = 0;
+    handshakeCount = 0;
+    reuseCount = 0;
+    dnsLookups = 0;
+    failureCount = 0;
+    memset(&lastTiming, 0, sizeof(lastTiming));
+    errorBody[0] = '\0';
+}
+
+bool HttpsConnection::begin(const char* hostName, uint16_t port) {
+    if (!hostName || !*hostName) {
+        DEBUG_PRINTLN("❌ HttpsConnection: Invalid host");
+        return false;
+    }
+    
+    host = hostName;
+    this->port = port;
+    
+    // Same trust model as the previous HTTPClient setup (no CA pinned)
+    client.setInsecure();
+    client.setHandshakeTimeout(HTTP_TIMEOUT / 1000);
+    
+    return true;
+}
+
+/**
+ * Print sink that forwards to the TLS client in HTTPS_WRITE_BUFFER_SIZE blocks
+ * and samples free heap at each block boundary.
+ */
+class SocketWriter : public Print {
+private:
+    WiFiClientSecure& client;
+    uint8_t buffer[HTTPS_WRITE_BUFFER_SIZE];
+    size_t used;
+    size_t written;
+    uint32_t lowestHeap;
+    bool failed;
+
+public:
+    SocketWriter(WiFiClientSecure& socket) : client(socket) {
+        used = 0;
+        written = 0;
+        lowestHeap = ESP.getFreeHeap();
+        failed = false;
+    }
+    
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    
+    size_t write(const uint8_t* data, size_t size) override {
+        size_t remaining = size;
+        while (remaining > 0 && !failed) {
+            size_t chunk = min(remaining, sizeof(buffer) - used);
+            memcpy(buffer + used, data, chunk);
+            used += chunk;
+            data += chunk;
+            remaining -= chunk;
+            if (used == sizeof(buffer)) {
+                flush();
+            }
+        }
+        return size;
+    }
+    
+    void flush() override {
+        if (used == 0 || failed) {
+            return;
+        }
+        if (client.write(buffer, used) != used) {
+            failed = true;
+        }
+        written += used;
+        used = 0;
+        lowestHeap = min(lowestHeap, (uint32_t)ESP.getFreeHeap());
+    }
+    
+    size_t getWritten() const { return written; }
+    uint32_t getLowestHeap() const { return lowestHeap; }
+    bool hasFailed() const { return failed; }
+};
+
+bool HttpsConnection::resolveHost(HttpsRequestTiming& timing) {
+    if (dnsValid && millis() - dnsResolvedAt < HTTPS_DNS_CACHE_TTL_MS) {
+        return true;
+    }
+    
+    unsigned long start = millis();
+    dnsLookups++;
+    
+    IPAddress address;
+    if (!WiFi.hostByName(host, address) || address == IPAddress(0, 0, 0, 0)) {
+        dnsValid = false;
+        DEBUG_PRINTF("❌ DNS lookup failed for %s\n", host);
+        return false;
+    }
+    
+    cachedAddress = address;
+    dnsResolvedAt = millis();
+    dnsValid = true;
+    timing.dnsMs = dnsResolvedAt - start;
+    
+    return true;
+}
+
+bool HttpsConnection::ensureConnected(HttpsRequestTiming& timing) {
+    // Reuse the open socket unless the server closed it or it sat idle too long
+    if (connectionOpen && client.connected() && millis() - lastActivity < HTTPS_KEEPALIVE_IDLE_MS) {
+        timing.reused = true;
+        reuseCount++;
+        return true;
+    }
+    
+    if (connectionOpen) {
+        stop();
+    }
+    
+    timing.reused = false;
+    
+    if (!resolveHost(timing)) {
+        timing.status = HTTPS_ERROR_DNS;
+        return false;
+    }
+    
+    unsigned long start = millis();
+    if (!client.connect(cachedAddress, port, host, nullptr, nullptr, nullptr)) {
+        // Cached address may be stale - resolve again next time
+        dnsValid = false;
+        timing.status = HTTPS_ERROR_CONNECT;
+        return false;
+    }
+    
+    timing.connectMs = millis() - start;
+    handshakeCount++;
+    connectionOpen = true;
+    lastActivity = millis();
+    
+    return true;
+}
+
+bool HttpsConnection::writeHeaders(const char* method, const char* path, const char* contentType, size_t contentLength) {
+    char headers[256];
+    int length = snprintf(headers, sizeof(headers),
+                          "%s %s HTTP/1.1\r\n"
+                          "Host: %s\r\n"
+                          "Connection: keep-alive\r\n"
+                          "Content-Type: %s\r\n"
+                          "Content-Length: %u\r\n"
+                          "\r\n",
+                          method, path, host, contentType, (unsigned)contentLength);
+    
+    if (length <= 0 || length >= (int)sizeof(headers)) {
+        return false;
+    }
+    
+    return client.write((const uint8_t*)headers, length) == (size_t)length;
+}
+
+bool HttpsConnection::waitForData(unsigned long deadline) {
+    while (!client.available()) {
+        if (!client.connected() || (long)(millis() - deadline) >= 0) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+int HttpsConnection::readLine(char* buffer, size_t size, unsigned long deadline) {
+    size_t length = 0;
+    
+    for (;;) {
+        if (!waitForData(deadline)) {
+            return -1;
+        }
+        
+        int c = client.read();
+        if (c < 0 || c == '\n') {
+            break;
+        }
+        // Over-long lines are truncated, never overflowed
+        if (c != '\r' && length < size - 1) {
+            buffer[length++] = (char)c;
+        }
+    }
+    
+    buffer[length] = '\0';
+    return length;
+}
+
+bool HttpsConnection::drainBody(long contentLength, bool chunked, unsigned long deadline, char* capture, size_t captureSize) {
+    uint8_t scratch[HTTPS_DRAIN_BUFFER_SIZE];
+    char line[32];
+    size_t captured = 0;
+    
+    for (;;) {
+        long remaining = contentLength;
+        
+        if (chunked) {
+            if (readLine(line, sizeof(line), deadline) < 0) {
+                return false;
+            }
+            remaining = strtol(line, nullptr, 16);
+            if (remaining == 0) {
+                // Skip trailers up to the terminating blank line
+                int length;
+                while ((length = readLine(line, sizeof(line), deadline)) > 0) {
+                }
+                return length == 0;
+            }
+        }
+        
+        while (remaining > 0) {
+            if (!waitForData(deadline)) {
+                return false;
+            }
+            size_t chunk = min((size_t)remaining, sizeof(scratch));
+            int received = client.read(scratch, chunk);
+            if (received <= 0) {
+                return false;
+            }
+            remaining -= received;
+            
+            // Keep a one-line prefix of the body
+            for (int i = 0; capture && i < received && captured + 1 < captureSize; i++) {
+                capture[captured++] = scratch[i] < ' ' ? ' ' : (char)scratch[i];
+            }
+            if (capture) {
+                capture[captured] = '\0';
+            }
+        }
+        
+        if (!chunked) {
+            return true;
+        }
+        
+        // CRLF after chunk data
+        if (readLine(line, sizeof(line), deadline) < 0) {
+            return false;
+        }
+    }
+}
+
+int HttpsConnection::readResponse(unsigned long requestStart, HttpsRequestTiming& timing) {
+    unsigned long deadline = requestStart + HTTP_TIMEOUT;
+    char line[128];
+    
+    if (!waitForData(deadline)) {
+        return client.connected() ? HTTPS_ERROR_TIMEOUT : HTTPS_ERROR_PROTOCOL;
+    }
+    timing.ttfbMs = millis() - requestStart;
+    
+    // Status line: "HTTP/1.1 200 OK"
+    if (readLine(line, sizeof(line), deadline) < 12 || strncmp(line, "HTTP/1.", 7) != 0) {
+        return HTTPS_ERROR_PROTOCOL;
+    }
+    int status = atoi(line + 9);
+    bool keepAlive = line[7] == '1';
+    
+    // Headers
+    long contentLength = -1;
+    bool chunked = false;
+    int length;
+    while ((length = readLine(line, sizeof(line), deadline)) > 0) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            contentLength = atol(line + 15);
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line + 18, "chunked")) {
+            chunked = true;
+        } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close")) {
+            keepAlive = false;
+        }
+    }
+    if (length < 0) {
+        return HTTPS_ERROR_TIMEOUT;
+    }
+    
+    // Without a length the body ends at connection close - cannot keep the socket
+    if (!chunked && contentLength < 0) {
+        keepAlive = false;
+        contentLength = 0;
+    }
+    
+    // RTDB explains a rejected request (auth, rules, bad path) in the body
+    errorBody[0] = '\0';
+    bool failed = status < 200 || status >= 300;
+    if (!drainBody(contentLength, chunked, deadline, failed ? errorBody : nullptr, sizeof(errorBody))) {
+        keepAlive = false;
+    }
+    
+    if (!keepAlive) {
+        stop();
+    }
+    
+    return status;
+}
+
+int HttpsConnection::request(const char* method, const char* path, const char* contentType, const uint8_t* body, size_t length) {
+    return send(method, path, contentType, body, length, nullptr);
+}
+
+int HttpsConnection::request(const char* method, const char* path, const char* contentType, HttpsBodyWriter& writer) {
+    // Measure first - the body is never held in memory as a whole
+    CountingPrint counter;
+    writer.writeBody(counter);
+    
+    return send(method, path, contentType, nullptr, counter.getCount(), &writer);
+}
+
+int HttpsConnection::send(const char* method, const char* path, const char* contentType,
+                          const uint8_t* body, size_t length, HttpsBodyWriter* writer) {
+    if (!host) {
+        return HTTPS_ERROR_CONNECT;
+    }
+    
+    unsigned long start = millis();
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t heapLowest = heapBefore;
+    HttpsRequestTiming timing;
+    memset(&timing, 0, sizeof(timing));
+    timing.bodyBytes = length;
+    requestCount++;
+    
+    // A reused socket may have been closed by the server while idle - retry once fresh
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!ensureConnected(timing)) {
+            break;
+        }
+        
+        unsigned long sent = millis();
+        bool written = writeHeaders(method, path, contentType, length);
+        if (written && writer) {
+            SocketWriter socket(client);
+            writer->writeBody(socket);
+            socket.flush();
+            // A body that changed between passes would desync the HTTP stream
+            written = !socket.hasFailed() && socket.getWritten() == length;
+            heapLowest = min(heapLowest, socket.getLowestHeap());
+        } else if (written) {
+            written = client.write(body, length) == length;
+        }
+        
+        if (!written) {
+            timing.status = HTTPS_ERROR_WRITE;
+        } else {
+            heapLowest = min(heapLowest, (uint32_t)ESP.getFreeHeap());
+            timing.status = readResponse(sent, timing);
+        }
+        
+        if (timing.status > 0) {
+            lastActivity = millis();
+            break;
+        }
+        
+        // Only a socket the server closed while idle is retried: the write
+        // failed, or it closed before any response byte. A timeout is a slow
+        // server - resending would block twice as long and send the body again
+        bool stale = timing.reused &&
+                     (timing.status == HTTPS_ERROR_WRITE ||
+                      (timing.status == HTTPS_ERROR_PROTOCOL && timing.ttfbMs == 0 && !client.connected()));
+        stop();
+        if (!stale) {
+            break;
+        }
+    }
+    
+    if (timing.status <= 0) {
+        failureCount++;
+    }
+    
+    timing.totalMs = millis() - start;
+    timing.heapUsed = heapBefore - heapLowest;
+    lastTiming = timing;
+    
+    return timing.status;
+}
+
+void HttpsConnection::stop() {
+    client.stop();
+    connectionOpen = false;
+}
+
+const HttpsRequestTiming& HttpsConnection::getLastTiming() {
+    return lastTiming;
+}
+
+const char* HttpsConnection::getLastErrorBody() {
+    return errorBody;
+}
+
+uint32_t HttpsConnection::getRequestCount() {
+    return requestCount;
+}
+
+uint32_t HttpsConnection::getHandshakeCount() {
+    return handshakeCount;
+}
+
+uint32_t HttpsConnection::getReuseCount() {
+    return reuseCount;
+}
+
+void HttpsConnection::printStatus() {
+    Serial.println("--- HTTPS Connection ---");
+    Serial.printf("Host: %s:%u (%s)\n", host ? host : "-", port, connectionOpen ? "open" : "closed");
+    Serial.printf("Requests: %lu | Handshakes: %lu | Reused: %lu | Failures: %lu\n",
+                 (unsigned long)requestCount, (unsigned long)handshakeCount,
+                 (unsigned long)reuseCount, (unsigned long)failureCount);
+    Serial.printf("DNS: %s (%lu lookups)\n",
+                 dnsValid ? cachedAddress.toString().c_str() : "not cached", (unsigned long)dnsLookups);
+    Serial.printf("Last Request: status %d, dns %lu ms, connect %lu ms, ttfb %lu ms, total %lu ms%s\n",
+                 lastTiming.status, (unsigned long)lastTiming.dnsMs, (unsigned long)lastTiming.connectMs,
+                 (unsigned long)lastTiming.ttfbMs, (unsigned long)lastTiming.totalMs,
+                 lastTiming.reused ? " (reused)" : "");
+    Serial.printf("Last Body: %lu bytes, peak heap use %lu bytes\n",
+                 (unsigned long)lastTiming.bodyBytes, (unsigned long)lastTiming.heapUsed);
+    Serial.println("---");
+}
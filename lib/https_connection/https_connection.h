@@ -0,0 +1,176 @@
+#ifndef HTTPS_CONNECTION_H
+#define HTTPS_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include "config.h"
+
+/**
+ * Timing breakdown of one HTTPS request
+ */
+struct HttpsRequestTiming {
+    uint32_t dnsMs;         // Host lookup (0 when served from cache)
+    uint32_t connectMs;     // TCP connect + TLS handshake (0 when the socket was reused)
+    uint32_t ttfbMs;        // Request sent -> first response byte
+    uint32_t totalMs;       // Whole request including response drain
+    bool reused;            // Keep-alive socket was reused
+    int status;             // HTTP status or negative error code
+    uint32_t bodyBytes;     // Request body size
+    uint32_t heapUsed;      // Free heap drop from request start to its lowest point
+};
+
+/**
+ * Producer of a streamed request body. writeBody() runs twice per attempt -
+ * once into a CountingPrint for Content-Length, once into the socket - and
+ * must emit identical bytes both times.
+ */
+class HttpsBodyWriter {
+public:
+    virtual ~HttpsBodyWriter() {}
+    virtual void writeBody(Print& out) = 0;
+};
+
+/**
+ * Print sink that discards data and counts bytes
+ */
+class CountingPrint : public Print {
+private:
+    size_t count;
+
+public:
+    CountingPrint() : count(0) {}
+    size_t write(uint8_t c) override { count++; return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { count += size; return size; }
+    size_t getCount() const { return count; }
+};
+
+// Negative request results
+#define HTTPS_ERROR_DNS        -1
+#define HTTPS_ERROR_CONNECT    -2
+#define HTTPS_ERROR_WRITE      -3
+#define HTTPS_ERROR_TIMEOUT    -4
+#define HTTPS_ERROR_PROTOCOL   -5
+
+/**
+ * HttpsConnection Class
+ * 
+ * Minimal HTTP/1.1 client over one persistent TLS socket. Keeps the connection
+ * alive between requests, caches the resolved host address for
+ * HTTPS_DNS_CACHE_TTL_MS, and drains responses into a fixed scratch buffer
+ * without heap allocation. Bodies can be streamed from an HttpsBodyWriter
+ * through a fixed HTTPS_WRITE_BUFFER_SIZE buffer, so upload size never
+ * depends on available heap.
+ */
+class HttpsConnection {
+private:
+    WiFiClientSecure client;
+    const char* host;
+    uint16_t port;
+    
+    // DNS cache
+    IPAddress cachedAddress;
+    unsigned long dnsResolvedAt;
+    bool dnsValid;
+    
+    // Connection state
+    bool connectionOpen;
+    unsigned long lastActivity;
+    
+    // Statistics
+    uint32_t requestCount;
+    uint32_t handshakeCount;
+    uint32_t reuseCount;
+    uint32_t dnsLookups;
+    uint32_t failureCount;
+    HttpsRequestTiming lastTiming;
+    char errorBody[HTTPS_ERROR_BODY_SIZE];  // Start of the last non-2xx response body
+    
+    // Internal methods
+    bool resolveHost(HttpsRequestTiming& timing);
+    bool ensureConnected(HttpsRequestTiming& timing);
+    bool waitForData(unsigned long deadline);
+    int readLine(char* buffer, size_t size, unsigned long deadline);
+    int readResponse(unsigned long requestStart, HttpsRequestTiming& timing);
+    bool drainBody(long contentLength, bool chunked, unsigned long deadline, char* capture, size_t captureSize);
+    bool writeHeaders(const char* method, const char* path, const char* contentType, size_t contentLength);
+    int send(const char* method, const char* path, const char* contentType,
+             const uint8_t* body, size_t length, HttpsBodyWriter* writer);
+
+public:
+    /**
+     * Constructor
+     */
+    HttpsConnection();
+    
+    /**
+     * Configure the target host (does not connect yet)
+     * @param hostName server host name (kept by pointer, must stay valid)
+     * @param port server port (default: 443)
+     * @return true if configuration is valid
+     */
+    bool begin(const char* hostName, uint16_t port = 443);
+    
+    /**
+     * Send one request and wait for the response
+     * @param method HTTP method ("POST", "PATCH", ...)
+     * @param path request path including query string
+     * @param contentType body content type
+     * @param body request body
+     * @param length body length in bytes
+     * @return HTTP status code, or a negative HTTPS_ERROR_* value
+     */
+    int request(const char* method, const char* path, const char* contentType, const uint8_t* body, size_t length);
+    
+    /**
+     * Send one request with a streamed body and wait for the response
+     * @param method HTTP method ("POST", "PATCH", ...)
+     * @param path request path including query string
+     * @param contentType body content type
+     * @param writer body producer (called once to measure, once to send)
+     * @return HTTP status code, or a negative HTTPS_ERROR_* value
+     */
+    int request(const char* method, const char* path, const char* contentType, HttpsBodyWriter& writer);
+    
+    /**
+     * Close the socket (the next request reconnects)
+     */
+    void stop();
+    
+    /**
+     * Get timing of the most recent request
+     * @return timing breakdown
+     */
+    const HttpsRequestTiming& getLastTiming();
+    
+    /**
+     * Get the start of the most recent response body, if its status was not 2xx
+     * (the server's reason; control characters replaced by spaces)
+     * @return body prefix, empty after a successful request
+     */
+    const char* getLastErrorBody();
+    
+    /**
+     * Get number of requests sent
+     * @return request count
+     */
+    uint32_t getRequestCount();
+    
+    /**
+     * Get number of TLS handshakes performed
+     * @return handshake count
+     */
+    uint32_t getHandshakeCount();
+    
+    /**
+     * Get number of requests that reused an open socket
+     * @return reuse count
+     */
+    uint32_t getReuseCount();
+    
+    /**
+     * Print connection statistics to Serial
+     */
+    void printStatus();
+};
+
+#endif // HTTPS_CONNECTION_H
@@ -0,0 +1,177 @@
+#include "json_writer.h"
+
+JsonWriter::JsonWriter(Print& output) : out(output) {
+    depth = 0;
+    hasMembers = 0;
+}
+
+void JsonWriter::writeRaw(const char* text, size_t length) {
+    out.write((const uint8_t*)text, length);
+}
+
+void JsonWriter::beginMember(const char* key) {
+    uint16_t bit = 1 << depth;
+    if (hasMembers & bit) {
+        out.write((uint8_t)',');
+    }
+    hasMembers |= bit;
+    
+    if (key) {
+        out.write((uint8_t)'"');
+        writeRaw(key, strlen(key));
+        writeRaw("\":", 2);
+    }
+}
+
+void JsonWriter::writeEscaped(const char* value) {
+    out.write((uint8_t)'"');
+    
+    // Copy runs of plain characters in one write, escape the rest
+    const char* run = value;
+    for (const char* p = value; *p; p++) {
+        uint8_t c = (uint8_t)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        
+        writeRaw(run, p - run);
+        run = p + 1;
+        
+        char escape[7];
+        switch (c) {
+            case '"':  writeRaw("\\\"", 2); break;
+            case '\\': writeRaw("\\\\", 2); break;
+            case '\n': writeRaw("\\n", 2); break;
+            case '\r': writeRaw("\\r", 2); break;
+            case '\t': writeRaw("\\t", 2); break;
+            default:
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                writeRaw(escape, 6);
+                break;
+        }
+    }
+    writeRaw(run, strlen(run));
+    
+    out.write((uint8_t)'"');
+}
+
+void JsonWriter::beginObject(const char* key) {
+    beginMember(key);
+    out.write((uint8_t)'{');
+    if (depth < JSON_WRITER_MAX_DEPTH - 1) {
+        depth++;
+    }
+    hasMembers &= ~(1 << depth);
+}
+
+void JsonWriter::endObject() {
+    if (depth > 0) {
+        depth--;
+    }
+    out.write((uint8_t)'}');
+}
+
+void JsonWriter::beginArray(const char* key) {
+    beginMember(key);
+    out.write((uint8_t)'[');
+    if (depth < JSON_WRITER_MAX_DEPTH - 1) {
+        depth++;
+    }
+    hasMembers &= ~(1 << depth);
+}
+
+void JsonWriter::endArray() {
+    if (depth > 0) {
+        depth--;
+    }
+    out.write((uint8_t)']');
+}
+
+void JsonWriter::add(const char* key, const char* value) {
+    beginMember(key);
+    if (value) {
+        writeEscaped(value);
+    } else {
+        writeRaw("null", 4);
+    }
+}
+
+void JsonWriter::add(const char* key, bool value) {
+    beginMember(key);
+    if (value) {
+        writeRaw("true", 4);
+    } else {
+        writeRaw("false", 5);
+    }
+}
+
+void JsonWriter::add(const char* key, int value) {
+    add(key, (long)value);
+}
+
+void JsonWriter::add(const char* key, unsigned int value) {
+    add(key, (unsigned long)value);
+}
+
+void JsonWriter::add(const char* key, long value) {
+    char number[12];
+    int length = snprintf(number, sizeof(number), "%ld", value);
+    beginMember(key);
+    writeRaw(number, length);
+}
+
+void JsonWriter::add(const char* key, unsigned long value) {
+    char number[12];
+    int length = snprintf(number, sizeof(number), "%lu", value);
+    beginMember(key);
+    writeRaw(number, length);
+}
+
+void JsonWriter::add(const char* key, double value, uint8_t decimals) {
+    beginMember(key);
+    if (isnan(value) || isinf(value)) {
+        writeRaw("null", 4);
+        return;
+    }
+    
+    char number[32];
+    int length = snprintf(number, sizeof(number), "%.*f", decimals, value);
+    if (length <= 0 || length >= (int)sizeof(number)) {
+        // Out of range for fixed notation - JSON has no representation we can rely on
+        writeRaw("null", 4);
+        return;
+    }
+    writeRaw(number, length);
+}
+
+void JsonWriter::addFixed(const char* key, int32_t value, uint8_t decimals) {
+    beginMember(key);
+    
+    // Digits from the right, inserting the decimal point after `decimals` of them
+    char number[16];
+    int position = sizeof(number);
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    for (int digit = 0; digit <= decimals || magnitude > 0; digit++) {
+        if (digit == decimals && decimals > 0) {
+            number[--position] = '.';
+        }
+        number[--position] = '0' + magnitude % 10;
+        magnitude /= 10;
+    }
+    if (value < 0) {
+        number[--position] = '-';
+    }
+    writeRaw(number + position, sizeof(number) - position);
+}
+
+void JsonWriter::beginRawString(const char* key) {
+    beginMember(key);
+    out.write((uint8_t)'"');
+}
+
+void JsonWriter::endRawString() {
+    out.write((uint8_t)'"');
+}
@@ -0,0 +1,97 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+// Maximum nesting of objects/arrays (one comma flag bit per level)
+#define JSON_WRITER_MAX_DEPTH 16
+
+/**
+ * JsonWriter Class
+ *
+ * Forward-only JSON encoder that writes straight to a Print sink. No document
+ * is built in memory, so output size is bounded only by the sink - nothing is
+ * ever truncated. Keys are expected to be string literals (not escaped);
+ * string values are escaped.
+ */
+class JsonWriter {
+private:
+    Print& out;
+    uint8_t depth;
+    uint16_t hasMembers;          // Bit per nesting level: a comma is due before the next member
+    
+    void beginMember(const char* key);
+    void writeEscaped(const char* value);
+    void writeRaw(const char* text, size_t length);
+
+public:
+    /**
+     * Constructor
+     * @param output sink receiving the encoded bytes
+     */
+    JsonWriter(Print& output);
+    
+    /**
+     * Open an object
+     * @param key member name, or nullptr at top level / inside an array
+     */
+    void beginObject(const char* key = nullptr);
+    
+    /**
+     * Close the innermost object
+     */
+    void endObject();
+    
+    /**
+     * Open an array
+     * @param key member name, or nullptr at top level / inside an array
+     */
+    void beginArray(const char* key = nullptr);
+    
+    /**
+     * Close the innermost array
+     */
+    void endArray();
+    
+    /**
+     * Write a member (key == nullptr writes an array element)
+     * @param key member name
+     * @param value value to encode
+     */
+    void add(const char* key, const char* value);
+    void add(const char* key, bool value);
+    void add(const char* key, int value);
+    void add(const char* key, unsigned int value);
+    void add(const char* key, long value);
+    void add(const char* key, unsigned long value);
+    
+    /**
+     * Write a floating point member (NaN/Inf are written as null)
+     * @param key member name
+     * @param value value to encode
+     * @param decimals digits after the decimal point
+     */
+    void add(const char* key, double value, uint8_t decimals);
+    
+    /**
+     * Write a fixed-point member without going through floating point
+     * @param key member name
+     * @param value scaled value (written as value / 10^decimals)
+     * @param decimals digits after the decimal point (0-9)
+     */
+    void addFixed(const char* key, int32_t value, uint8_t decimals);
+    
+    /**
+     * Open a string member whose content the caller writes to the sink directly
+     * (content must not need escaping, e.g. base64)
+     * @param key member name
+     */
+    void beginRawString(const char* key);
+    
+    /**
+     * Close a string opened with beginRawString()
+     */
+    void endRawString();
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,234 @@
+#include "mains_monitor.h"
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+
+#define MAINS_PCNT_UNIT PCNT_UNIT_0
+#define MAINS_PCNT_FILTER 1023        // APB cycles (~12.8 us), the hardware maximum
+
+MainsMonitor::MainsMonitor() {
+    pin = -1;
+    enabled = false;
+    wrapLock = portMUX_INITIALIZER_UNLOCKED;
+    wrapCount = 0;
+    lastWrapUs = 0;
+    previousWrapUs = 0;
+    lastTotal = 0;
+    lastPulseMs = 0;
+    powerPresent = false;
+    dropoutStartMs = 0;
+    windowStartMs = 0;
+    windowPulses = 0;
+    windowClean = false;
+    measuredWrapCount = 0;
+    frequencyMilliHz = 0;
+    resetStatistics();
+}
+
+bool MainsMonitor::begin(int pulsePin) {
+    if (pulsePin < 0) {
+        DEBUG_PRINTLN("❌ MainsMonitor: Invalid pin number");
+        return false;
+    }
+    
+    pin = pulsePin;
+    
+    // Count rising edges only; the control input is unused
+    pcnt_config_t config = {};
+    config.pulse_gpio_num = pin;
+    config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    config.lctrl_mode = PCNT_MODE_KEEP;
+    config.hctrl_mode = PCNT_MODE_KEEP;
+    config.pos_mode = PCNT_COUNT_INC;
+    config.neg_mode = PCNT_COUNT_DIS;
+    config.counter_h_lim = MAINS_PCNT_LIMIT;
+    config.counter_l_lim = 0;
+    config.unit = MAINS_PCNT_UNIT;
+    config.channel = PCNT_CHANNEL_0;
+    
+    if (pcnt_unit_config(&config) != ESP_OK) {
+        DEBUG_PRINTLN("❌ MainsMonitor: PCNT configuration failed");
+        return false;
+    }
+    
+    // Optocoupler edges are slow - the filter keeps ringing from double counting
+    pcnt_set_filter_value(MAINS_PCNT_UNIT, MAINS_PCNT_FILTER);
+    pcnt_filter_enable(MAINS_PCNT_UNIT);
+    
+    // The counter resets to 0 at the high limit; the interrupt timestamps each wrap
+    pcnt_event_enable(MAINS_PCNT_UNIT, PCNT_EVT_H_LIM);
+    pcnt_isr_service_install(0);
+    if (pcnt_isr_handler_add(MAINS_PCNT_UNIT, wrapIsr, this) != ESP_OK) {
+        DEBUG_PRINTLN("❌ MainsMonitor: PCNT interrupt not available");
+        return false;
+    }
+    
+    pcnt_counter_pause(MAINS_PCNT_UNIT);
+    pcnt_counter_clear(MAINS_PCNT_UNIT);
+    pcnt_counter_resume(MAINS_PCNT_UNIT);
+    
+    uint32_t now = millis();
+    windowStartMs = now;
+    dropoutStartMs = now;
+    enabled = true;
+    
+    DEBUG_PRINTF("🔌 MainsMonitor initialized (GPIO %d, %d Hz nominal)\n", pin, MAINS_NOMINAL_HZ);
+    
+    return true;
+}
+
+void IRAM_ATTR MainsMonitor::wrapIsr(void* arg) {
+    MainsMonitor* monitor = static_cast<MainsMonitor*>(arg);
+    int64_t now = esp_timer_get_time();
+    
+    portENTER_CRITICAL_ISR(&monitor->wrapLock);
+    monitor->wrapCount++;
+    monitor->previousWrapUs = monitor->lastWrapUs;
+    monitor->lastWrapUs = now;
+    portEXIT_CRITICAL_ISR(&monitor->wrapLock);
+}
+
+uint32_t MainsMonitor::readTotal() {
+    uint32_t wraps;
+    int16_t value;
+    
+    // Retry if a wrap lands between the two reads
+    do {
+        wraps = wrapCount;
+        pcnt_get_counter_value(MAINS_PCNT_UNIT, &value);
+    } while (wraps != wrapCount);
+    
+    return wraps * MAINS_PCNT_LIMIT + (uint32_t)value;
+}
+
+void MainsMonitor::updateFrequency() {
+    portENTER_CRITICAL(&wrapLock);
+    uint32_t wraps = wrapCount;
+    int64_t last = lastWrapUs;
+    int64_t previous = previousWrapUs;
+    portEXIT_CRITICAL(&wrapLock);
+    
+    if (wraps == measuredWrapCount || previous == 0) {
+        return;
+    }
+    measuredWrapCount = wraps;
+    
+    int64_t periodUs = last - previous;
+    if (periodUs <= 0) {
+        return;
+    }
+    
+    // Pulses per second -> cycles per second; a period that spans a dropout falls out of range
+    uint64_t milliHz = (uint64_t)MAINS_PCNT_LIMIT * 1000000000ULL / MAINS_PULSES_PER_CYCLE / periodUs;
+    if (milliHz >= MAINS_NOMINAL_HZ * 800UL && milliHz <= MAINS_NOMINAL_HZ * 1200UL) {
+        frequencyMilliHz = (uint32_t)milliHz;
+    }
+}
+
+void MainsMonitor::closeWindow(uint32_t now) {
+    uint32_t elapsed = now - windowStartMs;
+    
+    // Compare against the measured frequency once there is one
+    if (windowClean && powerPresent) {
+        uint32_t milliHz = frequencyMilliHz ? frequencyMilliHz : MAINS_NOMINAL_HZ * 1000UL;
+        uint32_t expectedCycles = (uint32_t)(((uint64_t)milliHz * elapsed + 500000) / 1000000);
+        uint32_t cycles = windowPulses / MAINS_PULSES_PER_CYCLE;
+        if (cycles + MAINS_SAG_MISSING_CYCLES <= expectedCycles) {
+            sagCount++;
+            missingCycles += expectedCycles - cycles;
+        }
+    }
+    
+    windowStartMs = now;
+    windowPulses = 0;
+    windowClean = true;
+}
+
+void MainsMonitor::update() {
+    if (!enabled) {
+        return;
+    }
+    
+    uint32_t now = millis();
+    uint32_t total = readTotal();
+    
+    // A wrap not yet seen by the interrupt reads as a smaller total - wait for it
+    if (total > lastTotal) {
+        windowPulses += total - lastTotal;
+        lastTotal = total;
+        lastPulseMs = now;
+        
+        if (!powerPresent) {
+            // Pulses are back - the dropout ran from the last pulse until now
+            powerPresent = true;
+            windowClean = false;
+            if (dropoutCount > 0) {
+                lastDropoutMs = now - dropoutStartMs;
+                if (lastDropoutMs > longestDropoutMs) {
+                    longestDropoutMs = lastDropoutMs;
+                }
+            }
+        }
+    } else if (powerPresent && now - lastPulseMs >= MAINS_DROPOUT_MS) {
+        powerPresent = false;
+        windowClean = false;
+        dropoutStartMs = lastPulseMs;
+        dropoutCount++;
+    }
+    
+    updateFrequency();
+    
+    if (now - windowStartMs >= MAINS_WINDOW_MS) {
+        closeWindow(now);
+    }
+}
+
+bool MainsMonitor::isPowerPresent() {
+    return powerPresent;
+}
+
+uint32_t MainsMonitor::getLastPulseTime() {
+    return lastPulseMs;
+}
+
+float MainsMonitor::getFrequency() {
+    return frequencyMilliHz / 1000.0f;
+}
+
+void MainsMonitor::getSnapshot(MainsSnapshot& snapshot) {
+    snapshot.enabled = enabled;
+    snapshot.frequencyMilliHz = frequencyMilliHz;
+    snapshot.sagCount = sagCount;
+    snapshot.missingCycles = missingCycles;
+    snapshot.dropoutCount = dropoutCount;
+    snapshot.lastDropoutMs = lastDropoutMs;
+    snapshot.longestDropoutMs = longestDropoutMs;
+}
+
+void MainsMonitor::printStatus() {
+    if (!enabled) {
+        Serial.println("Mains Monitor: disabled");
+        return;
+    }
+    
+    if (frequencyMilliHz > 0) {
+        Serial.printf("Mains Frequency: %.3f Hz\n", getFrequency());
+    } else {
+        Serial.println("Mains Frequency: measuring...");
+    }
+    Serial.printf("Mains Sags: %lu (%lu cycles missing)\n",
+                 (unsigned long)sagCount, (unsigned long)missingCycles);
+    Serial.printf("Mains Dropouts: %lu (last %lu ms, longest %lu ms)\n",
+                 (unsigned long)dropoutCount, (unsigned long)lastDropoutMs,
+                 (unsigned long)longestDropoutMs);
+    if (!powerPresent) {
+        Serial.printf("Current Dropout: %lu ms\n", (unsigned long)(millis() - dropoutStartMs));
+    }
+}
+
+void MainsMonitor::resetStatistics() {
+    sagCount = 0;
+    missingCycles = 0;
+    dropoutCount = 0;
+    lastDropoutMs = 0;
+    longestDropoutMs = 0;
+}
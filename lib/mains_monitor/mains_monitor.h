@@ -0,0 +1,121 @@
+#ifndef MAINS_MONITOR_H
+#define MAINS_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Fixed-size copy of the mains measurements, safe to hand to another task
+ */
+struct MainsSnapshot {
+    bool enabled;
+    uint32_t frequencyMilliHz;    // 0 until a clean measurement period completed
+    uint32_t sagCount;            // Windows missing MAINS_SAG_MISSING_CYCLES or more cycles
+    uint32_t missingCycles;       // Cycles missing across all sags
+    uint32_t dropoutCount;        // No pulses for MAINS_DROPOUT_MS or longer
+    uint32_t lastDropoutMs;
+    uint32_t longestDropoutMs;
+};
+
+/**
+ * MainsMonitor Class
+ *
+ * Pulse-train analysis for an optocoupler driven from AC mains. The PCNT
+ * peripheral counts the pulses in hardware (with its glitch filter on), so
+ * there is no per-edge CPU cost:
+ * - Frequency: the counter wraps every MAINS_PCNT_LIMIT pulses and the wrap
+ *   interrupt timestamps it; frequency = pulses / time between wraps
+ * - Sags: update() compares the pulses of each MAINS_WINDOW_MS window with
+ *   the cycles expected at the measured frequency
+ * - Dropouts: no pulse for MAINS_DROPOUT_MS means power is lost; the
+ *   dropout lasts from the last pulse to the first one after it
+ */
+class MainsMonitor {
+private:
+    int pin;
+    bool enabled;
+    
+    // Written by the wrap interrupt
+    portMUX_TYPE wrapLock;
+    volatile uint32_t wrapCount;
+    volatile int64_t lastWrapUs;
+    volatile int64_t previousWrapUs;
+    
+    // Pulse tracking (update() context)
+    uint32_t lastTotal;
+    uint32_t lastPulseMs;
+    bool powerPresent;
+    uint32_t dropoutStartMs;
+    uint32_t windowStartMs;
+    uint32_t windowPulses;
+    bool windowClean;             // No dropout or resume inside the window
+    uint32_t measuredWrapCount;
+    
+    // Measurements
+    uint32_t frequencyMilliHz;
+    uint32_t sagCount;
+    uint32_t missingCycles;
+    uint32_t dropoutCount;
+    uint32_t lastDropoutMs;
+    uint32_t longestDropoutMs;
+    
+    uint32_t readTotal();
+    void updateFrequency();
+    void closeWindow(uint32_t now);
+    static void IRAM_ATTR wrapIsr(void* arg);
+
+public:
+    /**
+     * Constructor
+     */
+    MainsMonitor();
+    
+    /**
+     * Start counting pulses on a pin
+     * @param pulsePin GPIO connected to the optocoupler output
+     * @return true if the pulse counter was configured
+     */
+    bool begin(int pulsePin);
+    
+    /**
+     * Read the counter and update dropout, sag and frequency state
+     * (call frequently, e.g. every sensor tick)
+     */
+    void update();
+    
+    /**
+     * Check if mains pulses are arriving
+     * @return true if a pulse was seen within MAINS_DROPOUT_MS
+     */
+    bool isPowerPresent();
+    
+    /**
+     * Get time of the last pulse (start of the current dropout when power is lost)
+     * @return millis() timestamp
+     */
+    uint32_t getLastPulseTime();
+    
+    /**
+     * Get measured line frequency
+     * @return frequency in Hz, 0 if not measured yet
+     */
+    float getFrequency();
+    
+    /**
+     * Copy measurements into a snapshot record
+     * @param snapshot destination record
+     */
+    void getSnapshot(MainsSnapshot& snapshot);
+    
+    /**
+     * Print mains measurements to Serial
+     */
+    void printStatus();
+    
+    /**
+     * Reset sag and dropout counters
+     */
+    void resetStatistics();
+};
+
+#endif // MAINS_MONITOR_H
@@ -0,0 +1,63 @@
+#include "motion_detector.h"
+#include "gps_fixed.h"
+
+const char* motionStateToString(MotionState state) {
+    switch (state) {
+        case MOTION_MOVING: return "MOVING";
+        case MOTION_PARKED: return "PARKED";
+        default:            return "UNKNOWN";
+    }
+}
+
+MotionDetector::MotionDetector() {
+    reset();
+}
+
+void MotionDetector::reset() {
+    state = MOTION_UNKNOWN;
+    anchored = false;
+    anchorLatE7 = 0;
+    anchorLonE7 = 0;
+    stillSinceMs = 0;
+}
+
+void MotionDetector::setAnchor(int32_t latE7, int32_t lonE7, uint32_t nowMs) {
+    anchorLatE7 = latE7;
+    anchorLonE7 = lonE7;
+    stillSinceMs = nowMs;
+    anchored = true;
+}
+
+bool MotionDetector::update(int32_t latE7, int32_t lonE7, uint32_t speedMms, uint32_t nowMs) {
+    const uint64_t radiusCm = MOTION_ANCHOR_RADIUS_M * 100ULL;
+    bool nearAnchor = anchored &&
+                      gpsDistanceSqCm2(anchorLatE7, anchorLonE7, latE7, lonE7) <= radiusCm * radiusCm;
+    MotionState previous = state;
+    
+    if (state == MOTION_PARKED) {
+        // One fix is enough to leave
+        if (speedMms > MOTION_MOVING_SPEED_MMS || !nearAnchor) {
+            state = MOTION_MOVING;
+            setAnchor(latE7, lonE7, nowMs);
+        }
+    } else if (speedMms < MOTION_PARKED_SPEED_MMS && nearAnchor) {
+        if (nowMs - stillSinceMs >= MOTION_PARKED_HOLD_MS) {
+            state = MOTION_PARKED;
+        }
+    } else {
+        // The parking candidate follows the unit until it settles
+        setAnchor(latE7, lonE7, nowMs);
+        state = MOTION_MOVING;
+    }
+    
+    // The first fix only places the anchor - not parked yet, so treated as moving
+    if (state == MOTION_UNKNOWN) {
+        state = MOTION_MOVING;
+    }
+    
+    return state != previous;
+}
+
+MotionState MotionDetector::getState() const {
+    return state;
+}
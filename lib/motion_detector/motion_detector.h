@@ -0,0 +1,74 @@
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Motion state derived from consecutive fixes
+ */
+enum MotionState : uint8_t {
+    MOTION_UNKNOWN = 0,           // No fix yet
+    MOTION_MOVING,
+    MOTION_PARKED
+};
+
+/**
+ * Get motion state as string
+ * @param state motion state
+ * @return "MOVING", "PARKED", or "UNKNOWN"
+ */
+const char* motionStateToString(MotionState state);
+
+/**
+ * MotionDetector Class
+ *
+ * Parked/moving classification from the GPS speed and the distance to an
+ * anchor position. While moving, the anchor follows the unit on every fix
+ * that is fast or outside MOTION_ANCHOR_RADIUS_M of it; a unit that stays
+ * slower than MOTION_PARKED_SPEED_MMS inside the radius for
+ * MOTION_PARKED_HOLD_MS is parked.
+ *
+ * Leaving is asymmetric on purpose: a single fix faster than
+ * MOTION_MOVING_SPEED_MMS or outside the radius ends parking, so the
+ * caller can return to full rate within one fix.
+ */
+class MotionDetector {
+private:
+    MotionState state;
+    bool anchored;
+    int32_t anchorLatE7;
+    int32_t anchorLonE7;
+    uint32_t stillSinceMs;        // First fix near the anchor
+    
+    void setAnchor(int32_t latE7, int32_t lonE7, uint32_t nowMs);
+
+public:
+    /**
+     * Constructor
+     */
+    MotionDetector();
+    
+    /**
+     * Feed one position fix
+     * @param latE7 latitude in 1e-7 degrees
+     * @param lonE7 longitude in 1e-7 degrees
+     * @param speedMms ground speed
+     * @param nowMs time of the fix (millis())
+     * @return true if the state changed
+     */
+    bool update(int32_t latE7, int32_t lonE7, uint32_t speedMms, uint32_t nowMs);
+    
+    /**
+     * Get the current state
+     * @return motion state
+     */
+    MotionState getState() const;
+    
+    /**
+     * Forget the anchor and state
+     */
+    void reset();
+};
+
+#endif // MOTION_DETECTOR_H
@@ -1,5 +1,14 @@
 #include "optocoupler_manager.h"
 #include "config.h"
+#include <esp_timer.h>
+
+const char* powerStabilityToString(PowerStability stability) {
+    switch (stability) {
+        case POWER_STABILITY_STABLE:   return "STABLE";
+        case POWER_STABILITY_SETTLING: return "SETTLING";
+        default:                       return "UNSTABLE";
+    }
+}
 
 OptocouplerManager::OptocouplerManager() {
     optocouplerPin = -1;
@@ -14,9 +23,23 @@ OptocouplerManager::OptocouplerManager() {
     lastPowerOnTimestamp = 0;
     lastPowerOffTimestamp = 0;
     stateChangeCount = 0;
+    edgeCapture = false;
+    acMains = false;
+    candidatePending = false;
+    candidateSinceUs = 0;
+    lastEdgeUs = 0;
+    lastDroppedEdges = 0;
+    lastPowerOnUs = 0;
+    lastPowerOffUs = 0;
+    edgeCount = 0;
+    glitchCount = 0;
+    bounceCount = 0;
+    overrunCount = 0;
+    memset(pulseHistogram, 0, sizeof(pulseHistogram));
 }
 
-bool OptocouplerManager::begin(int pin, bool activeLow, unsigned long debounceMs) {
+bool OptocouplerManager::begin(int pin, bool activeLow, unsigned long debounceMs, bool captureEdges,
+                               bool mainsPulses) {
     if (pin < 0) {
         DEBUG_PRINTLN("❌ OptocouplerManager: Invalid pin number");
         return false;
@@ -35,16 +58,51 @@ bool OptocouplerManager::begin(int pin, bool activeLow, unsigned long debounceMs
     previousPowerState = currentPowerState;
     lastStateChangeTime = millis();
     
-    DEBUG_PRINTLN("🔌 OptocouplerManager initialized");
+    // AC mains: the pulse counter replaces level reading; power is present while pulses arrive
+    acMains = mainsPulses;
+    if (acMains) {
+        if (!mains.begin(optocouplerPin)) {
+            return false;
+        }
+        currentPowerState = false;
+        previousPowerState = false;
+        captureEdges = false;
+    }
+    
+    // Edge capture: every transition is timestamped in the interrupt, filtered in update()
+    edgeCapture = captureEdges;
+    if (edgeCapture) {
+        attachInterruptArg(digitalPinToInterrupt(optocouplerPin), edgeIsr, this, CHANGE);
+    }
+    
+    DEBUG_PRINTF("🔌 OptocouplerManager initialized (%s)\n",
+                 acMains ? "AC mains" : (edgeCapture ? "edge capture" : "polling"));
     
     return true;
 }
 
+void IRAM_ATTR OptocouplerManager::edgeIsr(void* arg) {
+    OptocouplerManager* manager = static_cast<OptocouplerManager*>(arg);
+    
+    OptocouplerEdge edge;
+    edge.timestampUs = esp_timer_get_time();
+    edge.level = digitalRead(manager->optocouplerPin);
+    manager->edgeQueue.push(edge);
+}
+
 bool OptocouplerManager::update() {
     if (optocouplerPin < 0) {
         return false;
     }
     
+    if (acMains) {
+        return processMains();
+    }
+    
+    if (edgeCapture) {
+        return processEdges();
+    }
+    
     bool rawState = readRawState();
     bool stateChanged = false;
     
@@ -57,15 +115,7 @@ bool OptocouplerManager::update() {
     // Apply debouncing
     if ((millis() - lastStateChangeTime) >= debounceDelay) {
         if (rawState != currentPowerState) {
-            previousPowerState = currentPowerState;
-            currentPowerState = rawState;
-            stateChanged = true;
-            
-            // Update statistics
-            updateStatistics(currentPowerState);
-            
-            // Only log significant state changes, not debug noise
-            // This will be logged in main.cpp when update() returns true
+            stateChanged = applyState(rawState, millis());
         }
     }
     
@@ -83,8 +133,115 @@ bool OptocouplerManager::readRawState() {
     return activeLow ? !pinState : pinState;
 }
 
-void OptocouplerManager::updateStatistics(bool newState) {
-    unsigned long currentTime = millis();
+bool OptocouplerManager::processEdges() {
+    // Taken before draining, so an edge still in flight cannot be skipped over
+    int64_t now = esp_timer_get_time();
+    int64_t debounceUs = (int64_t)debounceDelay * 1000;
+    bool stateChanged = false;
+    
+    OptocouplerEdge edge;
+    while (edgeQueue.pop(edge)) {
+        bool level = activeLow ? !edge.level : edge.level;
+        edgeCount++;
+        if (lastEdgeUs != 0) {
+            recordPulse(edge.timestampUs - lastEdgeUs);
+        }
+        lastEdgeUs = edge.timestampUs;
+        lastStateChangeTime = (unsigned long)(edge.timestampUs / 1000);
+        lastRawState = level;
+        
+        // Candidate held for the debounce time before this edge - accept it at its own edge time
+        if (candidatePending && edge.timestampUs - candidateSinceUs >= debounceUs) {
+            candidatePending = false;
+            stateChanged |= applyState(!currentPowerState, (unsigned long)(candidateSinceUs / 1000));
+        }
+        
+        if (level != currentPowerState) {
+            if (!candidatePending) {
+                candidatePending = true;
+                candidateSinceUs = edge.timestampUs;
+            }
+        } else if (candidatePending) {
+            // Back to the debounced level too soon - the pulse is rejected
+            if (edge.timestampUs - candidateSinceUs < OPTOCOUPLER_GLITCH_US) {
+                glitchCount++;
+            } else {
+                bounceCount++;
+            }
+            candidatePending = false;
+        }
+    }
+    
+    // Edges were lost to a full ring - resynchronize from the pin
+    uint32_t dropped = edgeQueue.getDroppedCount();
+    if (dropped != lastDroppedEdges) {
+        lastDroppedEdges = dropped;
+        overrunCount++;
+        bool level = readRawState();
+        if (level == currentPowerState) {
+            candidatePending = false;
+        } else if (!candidatePending) {
+            candidatePending = true;
+            candidateSinceUs = now;
+        }
+    }
+    
+    // No edge since the candidate and the debounce time has passed
+    if (candidatePending && now - candidateSinceUs >= debounceUs) {
+        candidatePending = false;
+        stateChanged |= applyState(!currentPowerState, (unsigned long)(candidateSinceUs / 1000));
+    }
+    
+    return stateChanged;
+}
+
+bool OptocouplerManager::processMains() {
+    mains.update();
+    
+    bool present = mains.isPowerPresent();
+    if (present == currentPowerState) {
+        return false;
+    }
+    
+    // A dropout starts at the last pulse; power returns with the first new one
+    unsigned long changeTime = present ? millis() : mains.getLastPulseTime();
+    lastStateChangeTime = changeTime;
+    lastRawState = present;
+    return applyState(present, changeTime);
+}
+
+void OptocouplerManager::recordPulse(int64_t widthUs) {
+    // Decade buckets: <100us, <1ms, <10ms, <100ms, <1s, <10s, >=10s
+    int bucket = 0;
+    int64_t limit = 100;
+    while (bucket < OPTOCOUPLER_PULSE_BUCKETS - 1 && widthUs >= limit) {
+        bucket++;
+        limit *= 10;
+    }
+    pulseHistogram[bucket]++;
+}
+
+bool OptocouplerManager::applyState(bool newState, unsigned long changeTime) {
+    previousPowerState = currentPowerState;
+    currentPowerState = newState;
+    
+    // In capture mode the accepted change is dated by the edge that started it
+    if (edgeCapture) {
+        if (newState) {
+            lastPowerOnUs = candidateSinceUs;
+        } else {
+            lastPowerOffUs = candidateSinceUs;
+        }
+    }
+    
+    // Update statistics
+    updateStatistics(newState, changeTime);
+    
+    return true;
+}
+
+void OptocouplerManager::updateStatistics(bool newState, unsigned long changeTime) {
+    unsigned long currentTime = changeTime;
     stateChangeCount++;
     
     if (newState) {
@@ -94,6 +251,7 @@ void OptocouplerManager::updateStatistics(bool newState) {
             // Calculate time power was off
             if (lastPowerOffTimestamp > 0) {
                 powerOffTime += (currentTime - lastPowerOffTimestamp);
+                outageLog.record(lastPowerOffTimestamp, currentTime);
             }
         }
     } else {
@@ -158,18 +316,51 @@ unsigned long OptocouplerManager::getLastPowerOffTime() {
     return lastPowerOffTimestamp;
 }
 
-String OptocouplerManager::getPowerStability() {
+int64_t OptocouplerManager::getLastPowerOnMicros() {
+    return lastPowerOnUs;
+}
+
+int64_t OptocouplerManager::getLastPowerOffMicros() {
+    return lastPowerOffUs;
+}
+
+uint32_t OptocouplerManager::getGlitchCount() {
+    return glitchCount;
+}
+
+PowerStability OptocouplerManager::classifyStability() {
     unsigned long timeSinceChange = getTimeSinceLastChange();
     
     if (timeSinceChange > OPTOCOUPLER_STABLE_TIME) {
-        return "STABLE";
+        return POWER_STABILITY_STABLE;
     } else if (timeSinceChange > debounceDelay * 2) {
-        return "SETTLING";
+        return POWER_STABILITY_SETTLING;
     } else {
-        return "UNSTABLE";
+        return POWER_STABILITY_UNSTABLE;
     }
 }
 
+String OptocouplerManager::getPowerStability() {
+    return powerStabilityToString(classifyStability());
+}
+
+void OptocouplerManager::getSnapshot(PowerSnapshot& snapshot) {
+    snapshot.initialized = optocouplerPin >= 0;
+    snapshot.powerPresent = currentPowerState;
+    snapshot.stability = classifyStability();
+    snapshot.activeLow = activeLow;
+    snapshot.pin = optocouplerPin;
+    snapshot.debounceMs = debounceDelay;
+    snapshot.timeSinceChange = getTimeSinceLastChange();
+    snapshot.stateChanges = stateChangeCount;
+    snapshot.totalOnTime = getTotalPowerOnTime();
+    snapshot.totalOffTime = getTotalPowerOffTime();
+    snapshot.lastPowerOn = lastPowerOnTimestamp;
+    snapshot.lastPowerOff = lastPowerOffTimestamp;
+    outageLog.getSnapshot(snapshot.outages, millis());
+    mains.getSnapshot(snapshot.mains);
+}
+
 void OptocouplerManager::printStatus() {
     Serial.println("--- Optocoupler Status ---");
     Serial.printf("External Power: %s\n", getPowerStatusString().c_str());
@@ -194,6 +385,12 @@ void OptocouplerManager::printStatus() {
         Serial.printf("Power Uptime: %.1f%%\n", uptime);
     }
     
+    if (acMains) {
+        mains.printStatus();
+    }
+    
+    outageLog.printStatus();
+    
     Serial.println("---");
 }
 
@@ -211,6 +408,25 @@ void OptocouplerManager::printDebugInfo() {
     Serial.printf("Last Power ON: %lu ms\n", lastPowerOnTimestamp);
     Serial.printf("Last Power OFF: %lu ms\n", lastPowerOffTimestamp);
     
+    if (edgeCapture) {
+        Serial.printf("Edge Capture: %lu edges, %lu glitches (<%d us), %lu bounces, %lu overruns\n",
+                     (unsigned long)edgeCount, (unsigned long)glitchCount, OPTOCOUPLER_GLITCH_US,
+                     (unsigned long)bounceCount, (unsigned long)overrunCount);
+        Serial.printf("Edge Ring: peak %lu/%u, dropped %lu\n",
+                     (unsigned long)edgeQueue.getHighWaterMark(), (unsigned)edgeQueue.capacity(),
+                     (unsigned long)edgeQueue.getDroppedCount());
+        Serial.printf("Last Power ON/OFF: %lld / %lld us\n", lastPowerOnUs, lastPowerOffUs);
+        Serial.printf("Pulse Widths: <100us %lu | <1ms %lu | <10ms %lu | <100ms %lu | <1s %lu | <10s %lu | >=10s %lu\n",
+                     (unsigned long)pulseHistogram[0], (unsigned long)pulseHistogram[1],
+                     (unsigned long)pulseHistogram[2], (unsigned long)pulseHistogram[3],
+                     (unsigned long)pulseHistogram[4], (unsigned long)pulseHistogram[5],
+                     (unsigned long)pulseHistogram[6]);
+    } else if (acMains) {
+        Serial.println("Edge Capture: disabled (AC mains pulse counting)");
+    } else {
+        Serial.println("Edge Capture: disabled (polling)");
+    }
+    
     printStatus();
 }
 
@@ -220,6 +436,13 @@ void OptocouplerManager::resetStatistics() {
     stateChangeCount = 0;
     lastPowerOnTimestamp = currentPowerState ? millis() : 0;
     lastPowerOffTimestamp = !currentPowerState ? millis() : 0;
+    edgeCount = 0;
+    glitchCount = 0;
+    bounceCount = 0;
+    overrunCount = 0;
+    memset(pulseHistogram, 0, sizeof(pulseHistogram));
+    outageLog.reset();
+    mains.resetStatistics();
 }
 
 bool OptocouplerManager::getRawState() {
@@ -3,12 +3,75 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "spsc_queue.h"
+#include "outage_log.h"
+#include "mains_monitor.h"
+
+/**
+ * Power stability classification
+ */
+enum PowerStability : uint8_t {
+    POWER_STABILITY_STABLE = 0,
+    POWER_STABILITY_SETTLING,
+    POWER_STABILITY_UNSTABLE
+};
+
+/**
+ * Get power stability as string
+ * @param stability stability classification
+ * @return "STABLE", "SETTLING" or "UNSTABLE"
+ */
+const char* powerStabilityToString(PowerStability stability);
+
+/**
+ * Fixed-size copy of the optocoupler state, safe to hand to another task
+ */
+struct PowerSnapshot {
+    bool initialized;
+    bool powerPresent;
+    PowerStability stability;
+    bool activeLow;
+    int8_t pin;
+    uint32_t debounceMs;
+    uint32_t timeSinceChange;
+    uint32_t stateChanges;
+    uint32_t totalOnTime;
+    uint32_t totalOffTime;
+    uint32_t lastPowerOn;
+    uint32_t lastPowerOff;
+    OutageSnapshot outages;
+    MainsSnapshot mains;
+};
+
+/**
+ * Raw pin edge captured by the GPIO interrupt
+ */
+struct OptocouplerEdge {
+    int64_t timestampUs;    // esp_timer time of the edge
+    bool level;             // Pin level read in the interrupt
+};
+
+// Pulse width histogram buckets (decades from 100 us up to >= 10 s)
+#define OPTOCOUPLER_PULSE_BUCKETS 7
 
 /**
  * OptocouplerManager Class
  * 
  * Manages external power detection using an optocoupler
  * Provides debounced power state detection and status monitoring
+ * 
+ * With OPTOCOUPLER_EDGE_CAPTURE every pin edge is timestamped in a GPIO
+ * interrupt and pushed into a lock-free ring. update() replays the edges in
+ * order: pulses shorter than the debounce time are discarded (and counted as
+ * glitches or bounces), accepted changes are dated by their edge timestamp, so
+ * outage start/end are exact however late update() runs.
+ * 
+ * With OPTOCOUPLER_AC_MAINS the optocoupler carries the mains pulse train
+ * instead of a DC level: a MainsMonitor counts it with PCNT and the power
+ * state follows its dropout detection (no debounce needed).
+ * 
+ * Every completed outage goes into an OutageLog, which keeps the recent
+ * intervals and rolling minute/hour/day reliability aggregates.
  */
 class OptocouplerManager {
 private:
@@ -25,17 +88,45 @@ private:
     unsigned long lastStateChangeTime;
     unsigned long debounceDelay;
     
+    // Edge capture (ISR -> update())
+    bool edgeCapture;
+    SPSCQueue<OptocouplerEdge, OPTOCOUPLER_EDGE_QUEUE_SIZE> edgeQueue;
+    bool candidatePending;        // Raw level differs from the debounced state
+    int64_t candidateSinceUs;
+    int64_t lastEdgeUs;
+    uint32_t lastDroppedEdges;
+    int64_t lastPowerOnUs;
+    int64_t lastPowerOffUs;
+    
+    // Edge statistics
+    uint32_t edgeCount;
+    uint32_t glitchCount;
+    uint32_t bounceCount;
+    uint32_t overrunCount;
+    uint32_t pulseHistogram[OPTOCOUPLER_PULSE_BUCKETS];
+    
     // Statistics
     unsigned long powerOnTime;
     unsigned long powerOffTime;
     unsigned long lastPowerOnTimestamp;
     unsigned long lastPowerOffTimestamp;
     unsigned long stateChangeCount;
+    OutageLog outageLog;
+    
+    // AC mains mode (PCNT pulse counting)
+    bool acMains;
+    MainsMonitor mains;
     
     // Internal methods
     bool readRawState();
-    void updateStatistics(bool newState);
-    
+    void updateStatistics(bool newState, unsigned long changeTime);
+    bool applyState(bool newState, unsigned long changeTime);
+    bool processEdges();
+    bool processMains();
+    void recordPulse(int64_t widthUs);
+    static void IRAM_ATTR edgeIsr(void* arg);
+    PowerStability classifyStability();
+
 public:
     /**
      * Constructor
@@ -47,9 +138,12 @@ public:
      * @param pin GPIO pin connected to optocoupler output
      * @param activeLow true if optocoupler output is active low (default: true)
      * @param debounceMs debounce time in milliseconds (default: 50ms)
+     * @param captureEdges timestamp edges in a GPIO interrupt instead of polling the pin
+     * @param mainsPulses the input is an AC mains pulse train (counted with PCNT, overrides captureEdges)
      * @return true if initialization successful
      */
-    bool begin(int pin, bool activeLow = true, unsigned long debounceMs = 50);
+    bool begin(int pin, bool activeLow = true, unsigned long debounceMs = 50,
+               bool captureEdges = OPTOCOUPLER_EDGE_CAPTURE, bool mainsPulses = OPTOCOUPLER_AC_MAINS);
     
     /**
      * Update optocoupler state (call frequently in main loop)
@@ -111,12 +205,36 @@ public:
      */
     unsigned long getLastPowerOffTime();
     
+    /**
+     * Get exact time of the last power ON edge (edge capture mode)
+     * @return esp_timer microseconds, 0 if unknown
+     */
+    int64_t getLastPowerOnMicros();
+    
+    /**
+     * Get exact time of the last power OFF edge (edge capture mode)
+     * @return esp_timer microseconds, 0 if unknown
+     */
+    int64_t getLastPowerOffMicros();
+    
+    /**
+     * Get number of pulses rejected as glitches (shorter than OPTOCOUPLER_GLITCH_US)
+     * @return glitch count
+     */
+    uint32_t getGlitchCount();
+    
     /**
      * Get power stability indicator
      * @return "STABLE", "UNSTABLE", or "UNKNOWN"
      */
     String getPowerStability();
     
+    /**
+     * Copy current state and statistics into a snapshot record
+     * @param snapshot destination record
+     */
+    void getSnapshot(PowerSnapshot& snapshot);
+    
     /**
      * Print optocoupler status to Serial
      */
@@ -0,0 +1,163 @@
+#include "outage_log.h"
+
+// Window spans, indexed by OutageWindow
+static const uint32_t WINDOW_SPAN_MS[OUTAGE_WINDOW_COUNT] = {
+    60UL * 1000,
+    60UL * 60 * 1000,
+    24UL * 60 * 60 * 1000
+};
+
+const char* outageWindowToString(OutageWindow window) {
+    switch (window) {
+        case OUTAGE_WINDOW_MINUTE: return "minute";
+        case OUTAGE_WINDOW_HOUR:   return "hour";
+        default:                   return "day";
+    }
+}
+
+OutageLog::OutageLog() {
+    for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+        windows[i].bucketMs = WINDOW_SPAN_MS[i] / OUTAGE_WINDOW_BUCKETS;
+    }
+    reset();
+}
+
+void OutageLog::reset() {
+    memset(events, 0, sizeof(events));
+    head = 0;
+    count = 0;
+    totalOutages = 0;
+    
+    for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+        resetWindow(windows[i], millis() / windows[i].bucketMs);
+    }
+}
+
+void OutageLog::resetWindow(Window& window, uint32_t epoch) {
+    memset(window.buckets, 0, sizeof(window.buckets));
+    memset(&window.sum, 0, sizeof(window.sum));
+    window.currentEpoch = epoch;
+}
+
+void OutageLog::advanceWindow(Window& window, uint32_t now) {
+    uint32_t epoch = now / window.bucketMs;
+    
+    if (epoch < window.currentEpoch) {
+        // A late timestamp stays in the current bucket; a large jump back is a millis() wrap
+        if (window.currentEpoch - epoch > OUTAGE_WINDOW_BUCKETS) {
+            resetWindow(window, epoch);
+        }
+        return;
+    }
+    
+    if (epoch - window.currentEpoch >= OUTAGE_WINDOW_BUCKETS) {
+        // Idle for a whole window - everything expired
+        resetWindow(window, epoch);
+        return;
+    }
+    
+    // Expire the buckets between the old and the new epoch (at most OUTAGE_WINDOW_BUCKETS)
+    while (window.currentEpoch < epoch) {
+        window.currentEpoch++;
+        OutageWindowStats& bucket = window.buckets[window.currentEpoch % OUTAGE_WINDOW_BUCKETS];
+        window.sum.count -= bucket.count;
+        window.sum.flickers -= bucket.flickers;
+        window.sum.totalMs -= bucket.totalMs;
+        memset(&bucket, 0, sizeof(bucket));
+    }
+}
+
+uint32_t OutageLog::windowLongest(const Window& window) {
+    uint32_t longest = 0;
+    for (int i = 0; i < OUTAGE_WINDOW_BUCKETS; i++) {
+        if (window.buckets[i].longestMs > longest) {
+            longest = window.buckets[i].longestMs;
+        }
+    }
+    return longest;
+}
+
+void OutageLog::record(uint32_t startMs, uint32_t endMs) {
+    uint32_t durationMs = endMs - startMs;
+    bool flicker = durationMs < OUTAGE_FLICKER_MAX_MS;
+    
+    events[head].startMs = startMs;
+    events[head].durationMs = durationMs;
+    head = (head + 1) % OUTAGE_LOG_SIZE;
+    if (count < OUTAGE_LOG_SIZE) {
+        count++;
+    }
+    totalOutages++;
+    
+    // Attribute the outage to the bucket of its end time
+    for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+        Window& window = windows[i];
+        advanceWindow(window, endMs);
+        
+        OutageWindowStats& stats = window.buckets[window.currentEpoch % OUTAGE_WINDOW_BUCKETS];
+        stats.count++;
+        stats.totalMs += durationMs;
+        if (durationMs > stats.longestMs) {
+            stats.longestMs = durationMs;
+        }
+        window.sum.count++;
+        window.sum.totalMs += durationMs;
+        if (flicker) {
+            stats.flickers++;
+            window.sum.flickers++;
+        }
+    }
+}
+
+void OutageLog::advance(uint32_t now) {
+    for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+        advanceWindow(windows[i], now);
+    }
+}
+
+int OutageLog::size() const {
+    return count;
+}
+
+bool OutageLog::getEvent(int index, OutageEvent& event) const {
+    if (index < 0 || index >= count) {
+        return false;
+    }
+    
+    event = events[(head + OUTAGE_LOG_SIZE - 1 - index) % OUTAGE_LOG_SIZE];
+    return true;
+}
+
+void OutageLog::getSnapshot(OutageSnapshot& snapshot, uint32_t now) {
+    advance(now);
+    
+    snapshot.totalOutages = totalOutages;
+    for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+        snapshot.windows[i] = windows[i].sum;
+        snapshot.windows[i].longestMs = windowLongest(windows[i]);
+    }
+}
+
+void OutageLog::printStatus() {
+    OutageSnapshot snapshot;
+    getSnapshot(snapshot, millis());
+    
+    Serial.printf("Outages Since Boot: %lu\n", (unsigned long)snapshot.totalOutages);
+    for (int i = 0; i < OUTAGE_WINDOW_COUNT; i++) {
+        const OutageWindowStats& stats = snapshot.windows[i];
+        Serial.printf("Last %-6s: %lu outages, %lu ms total, longest %lu ms, mean %lu ms, %lu flickers\n",
+                     outageWindowToString((OutageWindow)i), (unsigned long)stats.count,
+                     (unsigned long)stats.totalMs, (unsigned long)stats.longestMs,
+                     stats.count > 0 ? (unsigned long)(stats.totalMs / stats.count) : 0UL,
+                     (unsigned long)stats.flickers);
+    }
+    
+    int shown = count < OUTAGE_LOG_PRINT_COUNT ? count : OUTAGE_LOG_PRINT_COUNT;
+    for (int i = 0; i < shown; i++) {
+        OutageEvent event;
+        getEvent(i, event);
+        Serial.printf("  ⚡ Outage at %lu ms, lasted %lu ms%s\n",
+                     (unsigned long)event.startMs, (unsigned long)event.durationMs,
+                     event.durationMs < OUTAGE_FLICKER_MAX_MS ? " (flicker)" : "");
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef OUTAGE_LOG_H
+#define OUTAGE_LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * One completed outage (power OFF -> ON)
+ */
+struct OutageEvent {
+    uint32_t startMs;       // millis() when power went off
+    uint32_t durationMs;    // Time until power returned
+};
+
+/**
+ * Rolling window spans
+ */
+enum OutageWindow : uint8_t {
+    OUTAGE_WINDOW_MINUTE = 0,
+    OUTAGE_WINDOW_HOUR,
+    OUTAGE_WINDOW_DAY,
+    OUTAGE_WINDOW_COUNT
+};
+
+/**
+ * Get window name as string
+ * @param window window index
+ * @return "minute", "hour" or "day"
+ */
+const char* outageWindowToString(OutageWindow window);
+
+/**
+ * Aggregates of the outages that ended inside one rolling window
+ */
+struct OutageWindowStats {
+    uint32_t count;         // Outages
+    uint32_t flickers;      // Outages shorter than OUTAGE_FLICKER_MAX_MS
+    uint32_t totalMs;       // Summed duration
+    uint32_t longestMs;     // Longest single outage
+};
+
+/**
+ * Fixed-size copy of the outage metrics, safe to hand to another task
+ */
+struct OutageSnapshot {
+    uint32_t totalOutages;  // Since boot
+    OutageWindowStats windows[OUTAGE_WINDOW_COUNT];
+};
+
+/**
+ * OutageLog Class
+ *
+ * Fixed-capacity ring of the last OUTAGE_LOG_SIZE outage intervals plus
+ * rolling minute/hour/day aggregates. Each window is split into
+ * OUTAGE_WINDOW_BUCKETS time buckets: recording an outage adds to the
+ * current bucket and the window sums, advancing time subtracts the buckets
+ * that fell out. Both are O(1) per call (bounded by the bucket count), so
+ * reports never scan the event ring. A window covers its span to within
+ * one bucket width.
+ */
+class OutageLog {
+private:
+    struct Window {
+        uint32_t bucketMs;
+        uint32_t currentEpoch;      // Bucket number (time / bucketMs) of the newest bucket
+        OutageWindowStats buckets[OUTAGE_WINDOW_BUCKETS];
+        OutageWindowStats sum;  // Running totals over all live buckets (longest unused)
+    };
+    
+    OutageEvent events[OUTAGE_LOG_SIZE];
+    uint16_t head;              // Next slot to write
+    uint16_t count;
+    uint32_t totalOutages;
+    Window windows[OUTAGE_WINDOW_COUNT];
+    
+    void resetWindow(Window& window, uint32_t epoch);
+    void advanceWindow(Window& window, uint32_t now);
+    uint32_t windowLongest(const Window& window);
+
+public:
+    /**
+     * Constructor
+     */
+    OutageLog();
+    
+    /**
+     * Record a completed outage
+     * @param startMs millis() when power went off
+     * @param endMs millis() when power returned
+     */
+    void record(uint32_t startMs, uint32_t endMs);
+    
+    /**
+     * Expire buckets that left their window (called by getSnapshot())
+     * @param now current millis()
+     */
+    void advance(uint32_t now);
+    
+    /**
+     * Get number of events held in the ring
+     * @return event count (at most OUTAGE_LOG_SIZE)
+     */
+    int size() const;
+    
+    /**
+     * Get an event from the ring
+     * @param index 0 = most recent
+     * @param event destination record
+     * @return true if the index is valid
+     */
+    bool getEvent(int index, OutageEvent& event) const;
+    
+    /**
+     * Copy the window aggregates into a snapshot record
+     * @param snapshot destination record
+     * @param now current millis()
+     */
+    void getSnapshot(OutageSnapshot& snapshot, uint32_t now);
+    
+    /**
+     * Clear events and aggregates
+     */
+    void reset();
+    
+    /**
+     * Print window metrics and the most recent outages to Serial
+     */
+    void printStatus();
+};
+
+#endif // OUTAGE_LOG_H
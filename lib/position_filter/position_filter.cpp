@@ -0,0 +1,153 @@
+#include "position_filter.h"
+
+#define POSITION_FILTER_M_PER_E7 0.0111195f          // Mean earth radius
+#define POSITION_FILTER_RAD_PER_E7 1.7453292519943295e-9f
+#define POSITION_FILTER_RECENTER_M 10000.0f          // Keep float offsets small
+#define POSITION_FILTER_INITIAL_VEL_VAR 25.0f        // (5 m/s)^2 until velocity is observed
+
+PositionFilter::PositionFilter() {
+    reset();
+}
+
+void PositionFilter::reset() {
+    initialized = false;
+    originLatE7 = 0;
+    originLonE7 = 0;
+    eastMetersPerE7 = POSITION_FILTER_M_PER_E7;
+    north = 0.0f;
+    east = 0.0f;
+    velocityNorth = 0.0f;
+    velocityEast = 0.0f;
+    varPos = 0.0f;
+    covPosVel = 0.0f;
+    varVel = 0.0f;
+    lastFixMs = 0;
+    consecutiveRejects = 0;
+    accepted = 0;
+    rejected = 0;
+}
+
+int32_t PositionFilter::wrapLongitude(int64_t lonE7) {
+    if (lonE7 > 1800000000LL) {
+        lonE7 -= 3600000000LL;
+    } else if (lonE7 < -1800000000LL) {
+        lonE7 += 3600000000LL;
+    }
+    return (int32_t)lonE7;
+}
+
+void PositionFilter::setOrigin(int32_t latE7, int32_t lonE7) {
+    originLatE7 = latE7;
+    originLonE7 = lonE7;
+    eastMetersPerE7 = POSITION_FILTER_M_PER_E7 * cosf(latE7 * POSITION_FILTER_RAD_PER_E7);
+}
+
+void PositionFilter::restart(int32_t latE7, int32_t lonE7, float variance, uint32_t nowMs) {
+    setOrigin(latE7, lonE7);
+    north = 0.0f;
+    east = 0.0f;
+    velocityNorth = 0.0f;
+    velocityEast = 0.0f;
+    varPos = variance;
+    covPosVel = 0.0f;
+    varVel = POSITION_FILTER_INITIAL_VEL_VAR;
+    lastFixMs = nowMs;
+    consecutiveRejects = 0;
+    initialized = true;
+}
+
+bool PositionFilter::update(int32_t latE7, int32_t lonE7, uint32_t sigmaMm, uint8_t satellites, uint32_t nowMs) {
+    if (satellites < POSITION_FILTER_MIN_SATS) {
+        rejected++;
+        return false;
+    }
+    
+    // Measurement noise from the receiver's error estimate, weaker with few satellites
+    float sigma = sigmaMm / 1000.0f;
+    if (satellites < POSITION_FILTER_REF_SATS) {
+        sigma *= (float)POSITION_FILTER_REF_SATS / satellites;
+    }
+    float r = sigma * sigma;
+    
+    if (!initialized || nowMs - lastFixMs > POSITION_FILTER_RESET_MS) {
+        restart(latE7, lonE7, r, nowMs);
+        accepted++;
+        return true;
+    }
+    
+    // Predict: constant velocity, white acceleration noise q
+    float dt = (nowMs - lastFixMs) / 1000.0f;
+    const float q = POSITION_FILTER_ACCEL_MS2 * POSITION_FILTER_ACCEL_MS2;
+    float dt2 = dt * dt;
+    float predNorth = north + velocityNorth * dt;
+    float predEast = east + velocityEast * dt;
+    float pPos = varPos + 2.0f * dt * covPosVel + dt2 * varVel + q * dt2 * dt2 / 4.0f;
+    float pCross = covPosVel + dt * varVel + q * dt2 * dt / 2.0f;
+    float pVel = varVel + q * dt2;
+    
+    // Innovation in the local plane (integer differences keep full precision)
+    float zNorth = (int32_t)(latE7 - originLatE7) * POSITION_FILTER_M_PER_E7;
+    float zEast = wrapLongitude((int64_t)lonE7 - originLonE7) * eastMetersPerE7;
+    float innovNorth = zNorth - predNorth;
+    float innovEast = zEast - predEast;
+    float s = pPos + r;
+    
+    // Chi-square gate on both axes together
+    if ((innovNorth * innovNorth + innovEast * innovEast) / s > POSITION_FILTER_GATE) {
+        if (++consecutiveRejects < POSITION_FILTER_MAX_REJECTS) {
+            rejected++;
+            return false;
+        }
+        
+        // Persistent disagreement is a real jump, not an outlier
+        restart(latE7, lonE7, r, nowMs);
+        accepted++;
+        return true;
+    }
+    
+    // Update with the shared gain
+    float gainPos = pPos / s;
+    float gainVel = pCross / s;
+    north = predNorth + gainPos * innovNorth;
+    east = predEast + gainPos * innovEast;
+    velocityNorth += gainVel * innovNorth;
+    velocityEast += gainVel * innovEast;
+    varPos = pPos * r / s;
+    covPosVel = pCross * r / s;
+    varVel = pVel - pCross * gainVel;
+    
+    lastFixMs = nowMs;
+    consecutiveRejects = 0;
+    accepted++;
+    
+    // Move the origin along so offsets stay well inside float precision
+    if (fabsf(north) > POSITION_FILTER_RECENTER_M || fabsf(east) > POSITION_FILTER_RECENTER_M) {
+        int32_t latNow = originLatE7 + (int32_t)lroundf(north / POSITION_FILTER_M_PER_E7);
+        int32_t lonNow = wrapLongitude((int64_t)originLonE7 + lroundf(east / eastMetersPerE7));
+        setOrigin(latNow, lonNow);
+        north = 0.0f;
+        east = 0.0f;
+    }
+    
+    return true;
+}
+
+void PositionFilter::getEstimate(PositionEstimate& estimate) const {
+    estimate.valid = initialized;
+    estimate.accepted = accepted;
+    estimate.rejected = rejected;
+    if (!initialized) {
+        estimate.latitudeE7 = 0;
+        estimate.longitudeE7 = 0;
+        estimate.velocityNorthMms = 0;
+        estimate.velocityEastMms = 0;
+        estimate.uncertaintyMm = 0;
+        return;
+    }
+    
+    estimate.latitudeE7 = originLatE7 + (int32_t)lroundf(north / POSITION_FILTER_M_PER_E7);
+    estimate.longitudeE7 = wrapLongitude((int64_t)originLonE7 + lroundf(east / eastMetersPerE7));
+    estimate.velocityNorthMms = (int32_t)lroundf(velocityNorth * 1000.0f);
+    estimate.velocityEastMms = (int32_t)lroundf(velocityEast * 1000.0f);
+    estimate.uncertaintyMm = (uint32_t)(sqrtf(varPos) * 1000.0f);
+}
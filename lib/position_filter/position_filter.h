@@ -0,0 +1,91 @@
+#ifndef POSITION_FILTER_H
+#define POSITION_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Filtered position, fixed-point like the raw GPS fields
+ */
+struct PositionEstimate {
+    bool valid;
+    int32_t latitudeE7;           // 1e-7 degrees
+    int32_t longitudeE7;          // 1e-7 degrees
+    int32_t velocityNorthMms;
+    int32_t velocityEastMms;
+    uint32_t uncertaintyMm;       // 1-sigma position uncertainty per axis
+    uint32_t accepted;            // Fixes used
+    uint32_t rejected;            // Fixes gated out (outliers or too few satellites)
+};
+
+/**
+ * PositionFilter Class
+ *
+ * Constant-velocity Kalman filter for GPS fixes in single-precision float
+ * (hardware on the ESP32). Fixes are projected onto a local north/east
+ * plane around an origin near the receiver. North and east share the same
+ * process and measurement noise, so both axes use one 2x2 covariance and
+ * every step is a fixed handful of float operations.
+ *
+ * Measurement noise comes from the fix quality: the caller passes a
+ * 1-sigma error (HDOP x UERE for NMEA, hAcc for UBX), inflated when fewer
+ * than POSITION_FILTER_REF_SATS satellites are used. Fixes whose
+ * innovation fails the chi-square gate are rejected; after
+ * POSITION_FILTER_MAX_REJECTS in a row the filter restarts on the fix, so
+ * a real jump is followed.
+ */
+class PositionFilter {
+private:
+    bool initialized;
+    int32_t originLatE7;
+    int32_t originLonE7;
+    float eastMetersPerE7;        // Shrinks with cos(latitude)
+    
+    // State (m, m/s) and the shared covariance [[pos, cross], [cross, vel]]
+    float north;
+    float east;
+    float velocityNorth;
+    float velocityEast;
+    float varPos;
+    float covPosVel;
+    float varVel;
+    
+    uint32_t lastFixMs;
+    uint8_t consecutiveRejects;
+    uint32_t accepted;
+    uint32_t rejected;
+    
+    void restart(int32_t latE7, int32_t lonE7, float variance, uint32_t nowMs);
+    void setOrigin(int32_t latE7, int32_t lonE7);
+    static int32_t wrapLongitude(int64_t lonE7);
+
+public:
+    /**
+     * Constructor
+     */
+    PositionFilter();
+    
+    /**
+     * Feed one position fix
+     * @param latE7 latitude in 1e-7 degrees
+     * @param lonE7 longitude in 1e-7 degrees
+     * @param sigmaMm 1-sigma horizontal error reported by the receiver
+     * @param satellites satellites used in the fix
+     * @param nowMs time of the fix (millis())
+     * @return true if the fix was used, false if it was gated out
+     */
+    bool update(int32_t latE7, int32_t lonE7, uint32_t sigmaMm, uint8_t satellites, uint32_t nowMs);
+    
+    /**
+     * Copy the current estimate
+     * @param estimate destination record
+     */
+    void getEstimate(PositionEstimate& estimate) const;
+    
+    /**
+     * Forget the state and counters
+     */
+    void reset();
+};
+
+#endif // POSITION_FILTER_H
@@ -0,0 +1,194 @@
+#include "power_channels.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+
+PowerChannels::PowerChannels() {
+    channelCount = 0;
+    memset(pins, -1, sizeof(pins));
+    memset(gpioChannel, -1, sizeof(gpioChannel));
+    pinMask = 0;
+    invertMask = 0;
+    debounced = 0;
+    count0 = ~0ULL;
+    count1 = ~0ULL;
+    lastToggled = 0;
+    tickCount = 0;
+    resetStatistics();
+}
+
+bool PowerChannels::begin(const int8_t* channelPins, uint8_t count, bool activeLow) {
+    if (count == 0 || count > POWER_CHANNEL_MAX) {
+        DEBUG_PRINTF("❌ PowerChannels: Invalid channel count %u\n", count);
+        return false;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        int8_t pin = channelPins[i];
+        if (pin < 0 || pin > 39 || gpioChannel[pin] >= 0) {
+            DEBUG_PRINTF("❌ PowerChannels: Invalid or duplicate pin %d\n", pin);
+            return false;
+        }
+        
+        // GPIO 34-39 are input only and have no internal pullup
+        pinMode(pin, pin >= 34 ? INPUT : INPUT_PULLUP);
+        pins[i] = pin;
+        gpioChannel[pin] = i;
+        pinMask |= 1ULL << pin;
+    }
+    
+    channelCount = count;
+    invertMask = activeLow ? pinMask : 0;
+    
+    // Start from the current levels with all counters idle
+    debounced = (readInputs() ^ invertMask) & pinMask;
+    count0 = ~0ULL;
+    count1 = ~0ULL;
+    
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < channelCount; i++) {
+        lastChangeMs[i] = now;
+    }
+    
+    DEBUG_PRINTF("🔌 PowerChannels initialized (%u channels)\n", channelCount);
+    
+    return true;
+}
+
+uint64_t PowerChannels::readInputs() {
+    // GPIO 0-31 in the first register, GPIO 32-39 in the low byte of the second
+    uint32_t low = REG_READ(GPIO_IN_REG);
+    uint32_t high = REG_READ(GPIO_IN1_REG) & 0xFF;
+    return ((uint64_t)high << 32) | low;
+}
+
+bool PowerChannels::tick() {
+    if (channelCount == 0) {
+        return false;
+    }
+    
+    uint64_t sample = (readInputs() ^ invertMask) & pinMask;
+    tickCount++;
+    
+    // Vertical counter: bits that differ from the accepted level count down
+    // from 3, bits that match reload to 3; a bit toggles when its counter wraps
+    uint64_t delta = sample ^ debounced;
+    count0 = ~(count0 & delta);
+    count1 = count0 ^ (count1 & delta);
+    uint64_t toggled = delta & count0 & count1;
+    debounced ^= toggled;
+    lastToggled = toggled;
+    
+    if (!toggled) {
+        return false;
+    }
+    
+    // Statistics for the toggled channels only
+    uint32_t now = millis();
+    while (toggled) {
+        int gpio = __builtin_ctzll(toggled);
+        toggled &= toggled - 1;
+        recordChange(gpioChannel[gpio], (debounced >> gpio) & 1, now);
+    }
+    
+    return true;
+}
+
+void PowerChannels::recordChange(int channel, bool present, uint32_t now) {
+    uint32_t elapsed = now - lastChangeMs[channel];
+    
+    if (present) {
+        offTimeMs[channel] += elapsed;
+        
+        // An outage needs an observed OFF edge, not just an OFF level at boot
+        if (stateChanges[channel] > 0) {
+            outageCount[channel]++;
+            if (elapsed > longestOutageMs[channel]) {
+                longestOutageMs[channel] = elapsed;
+            }
+        }
+    } else {
+        onTimeMs[channel] += elapsed;
+    }
+    
+    stateChanges[channel]++;
+    lastChangeMs[channel] = now;
+}
+
+int PowerChannels::size() const {
+    return channelCount;
+}
+
+uint32_t PowerChannels::getPresentMask() {
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < channelCount; i++) {
+        if ((debounced >> pins[i]) & 1) {
+            mask |= 1UL << i;
+        }
+    }
+    return mask;
+}
+
+uint32_t PowerChannels::getChangedMask() {
+    uint32_t mask = 0;
+    uint64_t toggled = lastToggled;
+    while (toggled) {
+        int gpio = __builtin_ctzll(toggled);
+        toggled &= toggled - 1;
+        mask |= 1UL << gpioChannel[gpio];
+    }
+    return mask;
+}
+
+bool PowerChannels::isPowerPresent(int channel) {
+    if (channel < 0 || channel >= channelCount) {
+        return false;
+    }
+    return (debounced >> pins[channel]) & 1;
+}
+
+uint32_t PowerChannels::getStateChangeCount(int channel) {
+    if (channel < 0 || channel >= channelCount) {
+        return 0;
+    }
+    return stateChanges[channel];
+}
+
+uint32_t PowerChannels::getOutageCount(int channel) {
+    if (channel < 0 || channel >= channelCount) {
+        return 0;
+    }
+    return outageCount[channel];
+}
+
+void PowerChannels::printStatus() {
+    Serial.println("--- Power Channels ---");
+    Serial.printf("Channels: %u, Ticks: %lu, Debounce: %d ticks\n",
+                 channelCount, (unsigned long)tickCount, POWER_CHANNEL_DEBOUNCE_TICKS);
+    
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < channelCount; i++) {
+        bool present = isPowerPresent(i);
+        uint32_t session = now - lastChangeMs[i];
+        Serial.printf("CH%-2u GPIO%-2d %-3s | %lu changes | %lu outages (longest %lu ms) | on %lu ms | off %lu ms\n",
+                     i, pins[i], present ? "ON" : "OFF",
+                     (unsigned long)stateChanges[i], (unsigned long)outageCount[i],
+                     (unsigned long)longestOutageMs[i],
+                     (unsigned long)(onTimeMs[i] + (present ? session : 0)),
+                     (unsigned long)(offTimeMs[i] + (present ? 0 : session)));
+    }
+    
+    Serial.println("---");
+}
+
+void PowerChannels::resetStatistics() {
+    memset(stateChanges, 0, sizeof(stateChanges));
+    memset(onTimeMs, 0, sizeof(onTimeMs));
+    memset(offTimeMs, 0, sizeof(offTimeMs));
+    memset(outageCount, 0, sizeof(outageCount));
+    memset(longestOutageMs, 0, sizeof(longestOutageMs));
+    
+    uint32_t now = millis();
+    for (int i = 0; i < POWER_CHANNEL_MAX; i++) {
+        lastChangeMs[i] = now;
+    }
+}
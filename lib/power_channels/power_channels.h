@@ -0,0 +1,120 @@
+#ifndef POWER_CHANNELS_H
+#define POWER_CHANNELS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Consecutive identical ticks needed to accept a change (2-bit vertical counter)
+#define POWER_CHANNEL_DEBOUNCE_TICKS 4
+
+/**
+ * PowerChannels Class
+ *
+ * Multi-circuit power detector. All monitored inputs are read with the two
+ * GPIO input registers and debounced together: each GPIO bit owns a 2-bit
+ * vertical counter spread over two 64-bit words, so one tick is a handful of
+ * bitwise operations whatever the number of channels. A channel changes state
+ * after POWER_CHANNEL_DEBOUNCE_TICKS consecutive ticks at the new level.
+ *
+ * Per-channel statistics are kept as parallel arrays indexed by channel and
+ * only touched for the bits that actually toggled.
+ */
+class PowerChannels {
+private:
+    // Configuration
+    uint8_t channelCount;
+    int8_t pins[POWER_CHANNEL_MAX];
+    int8_t gpioChannel[40];       // GPIO number -> channel index (-1 = not monitored)
+    uint64_t pinMask;             // Monitored GPIO bits
+    uint64_t invertMask;          // Active-low GPIO bits
+    
+    // Debounce state (GPIO bit space)
+    uint64_t debounced;           // Accepted level, 1 = power present
+    uint64_t count0;              // Vertical counter, low bit
+    uint64_t count1;              // Vertical counter, high bit
+    uint64_t lastToggled;
+    uint32_t tickCount;
+    
+    // Per-channel statistics (struct of arrays)
+    uint32_t stateChanges[POWER_CHANNEL_MAX];
+    uint32_t lastChangeMs[POWER_CHANNEL_MAX];
+    uint32_t onTimeMs[POWER_CHANNEL_MAX];
+    uint32_t offTimeMs[POWER_CHANNEL_MAX];
+    uint32_t outageCount[POWER_CHANNEL_MAX];
+    uint32_t longestOutageMs[POWER_CHANNEL_MAX];
+    
+    uint64_t readInputs();
+    void recordChange(int channel, bool present, uint32_t now);
+
+public:
+    /**
+     * Constructor
+     */
+    PowerChannels();
+    
+    /**
+     * Initialize the monitored inputs
+     * @param channelPins GPIO numbers, one per channel (0-39)
+     * @param count number of channels (at most POWER_CHANNEL_MAX)
+     * @param activeLow true if the inputs are active low
+     * @return true if initialization successful
+     */
+    bool begin(const int8_t* channelPins, uint8_t count, bool activeLow = true);
+    
+    /**
+     * Sample all channels once (call at a fixed period, e.g. every sensor tick)
+     * @return true if any channel changed state
+     */
+    bool tick();
+    
+    /**
+     * Get number of configured channels
+     * @return channel count
+     */
+    int size() const;
+    
+    /**
+     * Get debounced power state of all channels
+     * @return bit n set if channel n has power
+     */
+    uint32_t getPresentMask();
+    
+    /**
+     * Get channels that changed state on the last tick
+     * @return bit n set if channel n toggled
+     */
+    uint32_t getChangedMask();
+    
+    /**
+     * Get debounced power state of one channel
+     * @param channel channel index
+     * @return true if power is present
+     */
+    bool isPowerPresent(int channel);
+    
+    /**
+     * Get number of state changes of one channel since startup
+     * @param channel channel index
+     * @return number of state changes
+     */
+    uint32_t getStateChangeCount(int channel);
+    
+    /**
+     * Get number of completed outages of one channel since startup
+     * @param channel channel index
+     * @return outage count
+     */
+    uint32_t getOutageCount(int channel);
+    
+    /**
+     * Print per-channel status to Serial
+     */
+    void printStatus();
+    
+    /**
+     * Reset statistics counters
+     */
+    void resetStatistics();
+};
+
+#endif // POWER_CHANNELS_H
@@ -0,0 +1,228 @@
+#include "report_filter.h"
+
+ReportFilter::ReportFilter() {
+    enabled = true;
+    hasBaseline = false;
+    lastHeartbeat = 0;
+    lastPowerInitialized = false;
+    lastPowerPresent = false;
+    lastStability = POWER_STABILITY_STABLE;
+    lastStateChanges = 0;
+    lastMainsSags = 0;
+    lastVoltageEvents = 0;
+    lastGpsInitialized = false;
+    lastGpsActive = false;
+    lastLocationValid = false;
+    lastSignalQuality = GPS_QUALITY_NO_SIGNAL;
+    lastLocationSource = LOCATION_NONE;
+    lastLatitudeE7 = 0;
+    lastLongitudeE7 = 0;
+    lastMotion = MOTION_UNKNOWN;
+    lastLocationReport = 0;
+    lastScanCycle = 0;
+    networksChanged = false;
+    samplesEvaluated = 0;
+    samplesReported = 0;
+    heartbeatCount = 0;
+    memset(groupReports, 0, sizeof(groupReports));
+}
+
+void ReportFilter::begin(bool reportByException) {
+    enabled = reportByException;
+    hasBaseline = false;
+    
+    DEBUG_PRINTF("Report filter: %s (heartbeat %lu s, location deadband %d m)\n",
+                 enabled ? "by exception" : "every sample",
+                 (unsigned long)(REPORT_HEARTBEAT_MS / 1000), REPORT_LOCATION_DEADBAND_M);
+}
+
+void ReportFilter::observeScan(const WiFiScanTable& table) {
+    if (table.getCycleCount() == lastScanCycle) {
+        return;
+    }
+    lastScanCycle = table.getCycleCount();
+    
+    const WiFiScanDiff& diff = table.getLastDiff();
+    if (diff.appeared > 0 || diff.disappeared > 0 || diff.rssiChanged > 0) {
+        networksChanged = true;
+    }
+}
+
+bool ReportFilter::powerChanged(const PowerSnapshot& power) {
+    // State only - timers advance every sample and are not a reason to report.
+    // The change counter catches pulses shorter than the sample interval,
+    // the sag counter mains sags that never became a dropout.
+    return power.initialized != lastPowerInitialized ||
+           power.powerPresent != lastPowerPresent ||
+           power.stability != lastStability ||
+           power.stateChanges != lastStateChanges ||
+           power.mains.sagCount != lastMainsSags;
+}
+
+bool ReportFilter::gpsStatusChanged(const GpsSnapshot& gps) {
+    return gps.initialized != lastGpsInitialized ||
+           gps.active != lastGpsActive ||
+           gps.locationValid != lastLocationValid ||
+           gps.signalQuality != lastSignalQuality ||
+           gps.motion != lastMotion;
+}
+
+ReportFilter::LocationSource ReportFilter::reportedPosition(const SensorSample& sample, int32_t& latE7, int32_t& lonE7) {
+    // Same precedence as the payload: GPS (filtered when possible), then the WiFi estimate
+    const GpsSnapshot& gps = sample.gps;
+    if (gps.locationValid) {
+        latE7 = gps.filtered.valid ? gps.filtered.latitudeE7 : gps.latitudeE7;
+        lonE7 = gps.filtered.valid ? gps.filtered.longitudeE7 : gps.longitudeE7;
+        return LOCATION_GPS;
+    }
+    if (sample.wifiLocation.valid) {
+        latE7 = sample.wifiLocation.latitudeE7;
+        lonE7 = sample.wifiLocation.longitudeE7;
+        return LOCATION_WIFI;
+    }
+    latE7 = 0;
+    lonE7 = 0;
+    return LOCATION_NONE;
+}
+
+bool ReportFilter::locationChanged(const SensorSample& sample) {
+    int32_t latE7;
+    int32_t lonE7;
+    LocationSource source = reportedPosition(sample, latE7, lonE7);
+    if (source != lastLocationSource) {
+        return true;
+    }
+    if (source == LOCATION_NONE) {
+        return false;
+    }
+    
+    // Squared distances in cm^2 - no square root needed. The filtered
+    // position keeps stationary jitter from crossing the deadband; a WiFi
+    // estimate jumps between neighbours, so it must leave its accuracy radius
+    uint64_t deadbandCm = REPORT_LOCATION_DEADBAND_M * 100ULL;
+    if (source == LOCATION_WIFI && sample.wifiLocation.accuracyM > REPORT_LOCATION_DEADBAND_M) {
+        deadbandCm = sample.wifiLocation.accuracyM * 100ULL;
+    }
+    return gpsDistanceSqCm2(lastLatitudeE7, lastLongitudeE7, latE7, lonE7) >= deadbandCm * deadbandCm;
+}
+
+void ReportFilter::remember(const SensorSample& sample, uint8_t mask) {
+    // Only reported groups move their baseline; unreported drift keeps accumulating
+    if (mask & REPORT_FIELD_POWER) {
+        lastPowerInitialized = sample.power.initialized;
+        lastPowerPresent = sample.power.powerPresent;
+        lastStability = sample.power.stability;
+        lastStateChanges = sample.power.stateChanges;
+        lastMainsSags = sample.power.mains.sagCount;
+        lastVoltageEvents = sample.voltage.sagCount + sample.voltage.swellCount;
+        groupReports[0]++;
+    }
+    if (mask & REPORT_FIELD_LOCATION) {
+        lastLocationSource = reportedPosition(sample, lastLatitudeE7, lastLongitudeE7);
+        lastLocationReport = sample.timestampMs;
+        groupReports[1]++;
+    }
+    if (mask & REPORT_FIELD_GPS) {
+        lastGpsInitialized = sample.gps.initialized;
+        lastGpsActive = sample.gps.active;
+        lastLocationValid = sample.gps.locationValid;
+        lastSignalQuality = sample.gps.signalQuality;
+        lastMotion = sample.gps.motion;
+        groupReports[2]++;
+    }
+    if (mask & REPORT_FIELD_NETWORKS) {
+        groupReports[3]++;
+    }
+    if ((mask & REPORT_FIELD_GEOFENCE) && sample.geofenceEventCount > 0) {
+        groupReports[4]++;
+    }
+    if ((mask & REPORT_FIELD_TRACK) && sample.track.pointCount > 0) {
+        groupReports[5]++;
+    }
+}
+
+uint8_t ReportFilter::evaluate(const SensorSample& sample, bool online) {
+    samplesEvaluated++;
+    
+    if (!enabled) {
+        uint8_t mask = REPORT_FIELD_ALL;
+#if MOTION_DUTY_CYCLE
+        // A parked unit does not move - its location follows the parked cadence
+        if (sample.gps.motion == MOTION_PARKED && lastMotion == MOTION_PARKED &&
+            sample.timestampMs - lastLocationReport < MOTION_PARKED_REPORT_MS) {
+            mask &= ~REPORT_FIELD_LOCATION;
+        }
+#endif
+        remember(sample, mask);
+        samplesReported++;
+        return mask;
+    }
+    
+    uint8_t mask = 0;
+    if (!hasBaseline || sample.timestampMs - lastHeartbeat >= REPORT_HEARTBEAT_MS) {
+        mask = REPORT_FIELD_ALL | REPORT_HEARTBEAT;
+        lastHeartbeat = sample.timestampMs;
+        hasBaseline = true;
+        heartbeatCount++;
+    } else {
+        if (powerChanged(sample.power) ||
+            sample.voltage.sagCount + sample.voltage.swellCount != lastVoltageEvents) {
+            mask |= REPORT_FIELD_POWER;
+        }
+        // Starting and stopping are reported with the position they happened at
+        if (locationChanged(sample) || sample.gps.motion != lastMotion) {
+            mask |= REPORT_FIELD_LOCATION | REPORT_FIELD_GPS;
+        }
+        if (gpsStatusChanged(sample.gps)) {
+            mask |= REPORT_FIELD_GPS;
+        }
+        if (online && networksChanged) {
+            mask |= REPORT_FIELD_NETWORKS;
+        }
+        if (sample.geofenceEventCount > 0) {
+            mask |= REPORT_FIELD_GEOFENCE;
+        }
+        if (sample.track.pointCount > 0) {
+            mask |= REPORT_FIELD_TRACK;
+        }
+    }
+    
+    // Scan data only travels with live uploads; keep the change pending while offline
+    if (!online) {
+        mask &= ~REPORT_FIELD_NETWORKS;
+    } else if (mask & REPORT_FIELD_NETWORKS) {
+        networksChanged = false;
+    }
+    
+    remember(sample, mask);
+    if (mask != 0) {
+        samplesReported++;
+    }
+    
+    return mask;
+}
+
+bool ReportFilter::isEnabled() {
+    return enabled;
+}
+
+uint32_t ReportFilter::getReportedCount() {
+    return samplesReported;
+}
+
+uint32_t ReportFilter::getSuppressedCount() {
+    return samplesEvaluated - samplesReported;
+}
+
+void ReportFilter::printStatus() {
+    Serial.printf("Reports: %s | %lu of %lu samples sent, %lu heartbeats\n",
+                 enabled ? "by exception" : "every sample",
+                 (unsigned long)samplesReported, (unsigned long)samplesEvaluated,
+                 (unsigned long)heartbeatCount);
+    if (enabled) {
+        Serial.printf("Changes: power %lu, location %lu, GPS %lu, networks %lu, geofence %lu, track %lu\n",
+                     (unsigned long)groupReports[0], (unsigned long)groupReports[1],
+                     (unsigned long)groupReports[2], (unsigned long)groupReports[3],
+                     (unsigned long)groupReports[4], (unsigned long)groupReports[5]);
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensor_sample.h"
+#include "wifi_scan_table.h"
+
+/**
+ * ReportFilter Class
+ * 
+ * Report-by-exception engine for the upload path. Keeps the last reported
+ * value of each field group and marks a sample's groups for upload only when
+ * they moved past their deadband:
+ * - Power: any state, stability, state-change-count, mains sag or line
+ *   voltage sag/swell count difference
+ * - GPS status: fix, activity, signal quality or motion state change
+ * - Location: movement beyond REPORT_LOCATION_DEADBAND_M (of the filtered
+ *   position when there is one), a motion state change, or a change of
+ *   source (GPS, WiFi fingerprint estimate, none). WiFi estimates also have
+ *   to move past their own accuracy radius
+ * - Networks: any scan diff since the last report (RSSI deadband is
+ *   WIFI_RSSI_CHANGE_THRESHOLD, applied by the scan table)
+ * - Geofence: always, whenever the sample carries events
+ * - Track: always, whenever the sample carries a route (movement beyond
+ *   TRACK_TOLERANCE_M)
+ * Every REPORT_HEARTBEAT_MS a full sample is reported regardless.
+ * Samples with an empty mask are not uploaded at all.
+ * 
+ * When every sample is reported, a parked unit's location is still only
+ * sent every MOTION_PARKED_REPORT_MS (with MOTION_DUTY_CYCLE).
+ */
+class ReportFilter {
+private:
+    enum LocationSource : uint8_t {
+        LOCATION_NONE,
+        LOCATION_GPS,
+        LOCATION_WIFI
+    };
+    
+    bool enabled;
+    bool hasBaseline;
+    uint32_t lastHeartbeat;
+    
+    // Last reported values
+    bool lastPowerInitialized;
+    bool lastPowerPresent;
+    PowerStability lastStability;
+    uint32_t lastStateChanges;
+    uint32_t lastMainsSags;
+    uint32_t lastVoltageEvents;   // Line voltage sags + swells
+    bool lastGpsInitialized;
+    bool lastGpsActive;
+    bool lastLocationValid;
+    GpsSignalQuality lastSignalQuality;
+    LocationSource lastLocationSource;
+    int32_t lastLatitudeE7;
+    int32_t lastLongitudeE7;
+    MotionState lastMotion;
+    uint32_t lastLocationReport;
+    
+    // Scan diffs accumulated since networks were last reported
+    uint32_t lastScanCycle;
+    bool networksChanged;
+    
+    // Statistics
+    uint32_t samplesEvaluated;
+    uint32_t samplesReported;
+    uint32_t heartbeatCount;
+    uint32_t groupReports[6];     // Per group: power, location, GPS status, networks, geofence, track
+    
+    bool powerChanged(const PowerSnapshot& power);
+    bool gpsStatusChanged(const GpsSnapshot& gps);
+    bool locationChanged(const SensorSample& sample);
+    static LocationSource reportedPosition(const SensorSample& sample, int32_t& latE7, int32_t& lonE7);
+    void remember(const SensorSample& sample, uint8_t mask);
+
+public:
+    /**
+     * Constructor
+     */
+    ReportFilter();
+    
+    /**
+     * Initialize the filter
+     * @param reportByException true for change-driven reports, false to report every field of every sample
+     */
+    void begin(bool reportByException = REPORT_BY_EXCEPTION);
+    
+    /**
+     * Record the latest scan cycle (call after every scan update so no cycle is missed)
+     * @param table scan table owned by the calling task
+     */
+    void observeScan(const WiFiScanTable& table);
+    
+    /**
+     * Decide which field groups of a sample are reported, and update the baseline
+     * @param sample sample to evaluate
+     * @param online true if scan data can be sent with this sample
+     * @return REPORT_FIELD_* mask (0 = nothing to report)
+     */
+    uint8_t evaluate(const SensorSample& sample, bool online);
+    
+    /**
+     * Check if report-by-exception is active
+     * @return true if samples are filtered
+     */
+    bool isEnabled();
+    
+    /**
+     * Get number of samples that produced a report
+     * @return reported sample count
+     */
+    uint32_t getReportedCount();
+    
+    /**
+     * Get number of samples suppressed (nothing changed)
+     * @return suppressed sample count
+     */
+    uint32_t getSuppressedCount();
+    
+    /**
+     * Print filter statistics to Serial
+     */
+    void printStatus();
+};
+
+#endif // REPORT_FILTER_H
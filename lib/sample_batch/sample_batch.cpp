@@ -0,0 +1,63 @@
+#include "sample_batch.h"
+
+SampleBatch::SampleBatch() {
+    count = 0;
+    encodedBytes = 0;
+    openedAt = 0;
+    replayed = false;
+    urgent = false;
+}
+
+bool SampleBatch::add(const SensorSample& sample, uint32_t sizeBytes) {
+    if (count >= UPLOAD_BATCH_MAX_SAMPLES) {
+        return false;
+    }
+    
+    if (count == 0) {
+        openedAt = millis();
+    }
+    
+    samples[count++] = sample;
+    encodedBytes += sizeBytes;
+    if ((sample.reportMask & REPORT_FIELD_GEOFENCE) && sample.geofenceEventCount > 0) {
+        urgent = true;
+    }
+    
+    return true;
+}
+
+void SampleBatch::clear(bool fromJournal) {
+    count = 0;
+    encodedBytes = 0;
+    openedAt = 0;
+    replayed = fromJournal;
+    urgent = false;
+}
+
+bool SampleBatch::shouldFlush() {
+    return count > 0 && (urgent || isFull() || millis() - openedAt >= UPLOAD_BATCH_MAX_AGE_MS);
+}
+
+bool SampleBatch::isFull() {
+    return count >= UPLOAD_BATCH_MAX_SAMPLES || encodedBytes >= UPLOAD_BATCH_MAX_BYTES;
+}
+
+int SampleBatch::size() const {
+    return count;
+}
+
+const SensorSample& SampleBatch::getSample(int index) const {
+    return samples[index];
+}
+
+uint32_t SampleBatch::getEncodedBytes() const {
+    return encodedBytes;
+}
+
+unsigned long SampleBatch::getAge() const {
+    return count > 0 ? millis() - openedAt : 0;
+}
+
+bool SampleBatch::isReplayed() const {
+    return replayed;
+}
@@ -0,0 +1,90 @@
+#ifndef SAMPLE_BATCH_H
+#define SAMPLE_BATCH_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensor_sample.h"
+
+/**
+ * SampleBatch Class
+ * 
+ * Fixed-capacity group of samples committed to Firebase in one multi-location
+ * write. A batch is due for flushing when it holds UPLOAD_BATCH_MAX_SAMPLES
+ * samples, its encoded size reaches UPLOAD_BATCH_MAX_BYTES, or its oldest
+ * sample has waited UPLOAD_BATCH_MAX_AGE_MS. A sample carrying geofence
+ * events makes the batch due at once.
+ */
+class SampleBatch {
+private:
+    SensorSample samples[UPLOAD_BATCH_MAX_SAMPLES];
+    uint8_t count;
+    uint32_t encodedBytes;
+    unsigned long openedAt;
+    bool replayed;
+    bool urgent;                  // Holds geofence events
+
+public:
+    /**
+     * Constructor
+     */
+    SampleBatch();
+    
+    /**
+     * Add a sample to the batch
+     * @param sample record to copy
+     * @param sizeBytes encoded size of the sample (for the byte budget)
+     * @return true if added, false if the batch is full
+     */
+    bool add(const SensorSample& sample, uint32_t sizeBytes);
+    
+    /**
+     * Empty the batch
+     * @param fromJournal true if the next samples are journal replays
+     */
+    void clear(bool fromJournal = false);
+    
+    /**
+     * Check if any flush trigger (count, bytes, age, geofence event) has fired
+     * @return true if the batch should be sent now
+     */
+    bool shouldFlush();
+    
+    /**
+     * Check if the batch cannot take more samples
+     * @return true if full by count or byte budget
+     */
+    bool isFull();
+    
+    /**
+     * Get number of samples in the batch
+     * @return sample count
+     */
+    int size() const;
+    
+    /**
+     * Get sample by position (oldest first)
+     * @param index 0..size()-1
+     * @return sample reference
+     */
+    const SensorSample& getSample(int index) const;
+    
+    /**
+     * Get estimated encoded size of all samples
+     * @return bytes
+     */
+    uint32_t getEncodedBytes() const;
+    
+    /**
+     * Get age of the batch (time since its first sample was added)
+     * @return milliseconds (0 if empty)
+     */
+    unsigned long getAge() const;
+    
+    /**
+     * Check if the batch holds journal replays
+     * @return true for replayed samples
+     */
+    bool isReplayed() const;
+};
+
+#endif // SAMPLE_BATCH_H
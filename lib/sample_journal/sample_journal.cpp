@@ -0,0 +1,406 @@
+#include "sample_journal.h"
+#include <esp_rom_crc.h>
+
+#define JOURNAL_RECORD_MAGIC 0x4A524E4C  // "JRNL"
+#define JOURNAL_RECORD_VERSION 14
+#define JOURNAL_CURSOR_MAGIC 0x4A435552  // "JCUR"
+
+struct JournalRecordHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc;
+};
+
+struct JournalCursor {
+    uint32_t magic;
+    uint32_t segment;
+    uint32_t index;
+    uint32_t crc;
+};
+
+static const size_t JOURNAL_RECORD_SIZE = sizeof(JournalRecordHeader) + sizeof(SensorSample);
+
+SampleJournal::SampleJournal() {
+    mounted = false;
+    headSegment = 0;
+    tailSegment = 0;
+    tailRecords = 0;
+    tailSealed = false;
+    readIndex = 0;
+    peekedCount = 0;
+    acksSinceCursor = 0;
+    pendingCount = 0;
+    appendedCount = 0;
+    replayedCount = 0;
+    droppedCount = 0;
+    corruptCount = 0;
+    bytesWritten = 0;
+    flashWrites = 0;
+    drainTimeMs = 0;
+}
+
+void SampleJournal::segmentPath(uint32_t segment, char* buffer, size_t size) {
+    snprintf(buffer, size, SAMPLE_JOURNAL_DIR "/seg_%08lu.bin", (unsigned long)segment);
+}
+
+bool SampleJournal::begin() {
+    // Format on first use (or if the partition is unreadable)
+    if (!LittleFS.begin(true)) {
+        DEBUG_PRINTLN("❌ SampleJournal: LittleFS mount failed");
+        return false;
+    }
+    
+    if (!LittleFS.exists(SAMPLE_JOURNAL_DIR)) {
+        LittleFS.mkdir(SAMPLE_JOURNAL_DIR);
+    }
+    
+    // Find the segment window on flash
+    bool found = false;
+    uint32_t minSegment = 0;
+    uint32_t maxSegment = 0;
+    
+    File dir = LittleFS.open(SAMPLE_JOURNAL_DIR);
+    if (dir && dir.isDirectory()) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            const char* name = strrchr(entry.name(), '/');
+            name = name ? name + 1 : entry.name();
+            unsigned long segment;
+            if (sscanf(name, "seg_%lu.bin", &segment) == 1) {
+                if (!found || segment < minSegment) minSegment = segment;
+                if (!found || segment > maxSegment) maxSegment = segment;
+                found = true;
+            }
+            entry.close();
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+    
+    headSegment = minSegment;
+    tailSegment = maxSegment;
+    mounted = true;
+    
+    loadCursor();
+    
+    // Count what is still pending; a damaged tail is sealed
+    pendingCount = 0;
+    if (found) {
+        for (uint32_t segment = headSegment; segment <= tailSegment; segment++) {
+            bool damaged = false;
+            uint16_t records = countValidRecords(segment, damaged);
+            uint16_t delivered = (segment == headSegment) ? min(readIndex, records) : 0;
+            pendingCount += records - delivered;
+            
+            if (damaged) {
+                corruptCount++;
+            }
+            if (segment == tailSegment) {
+                tailRecords = records;
+                tailSealed = damaged || records >= SAMPLE_JOURNAL_SEGMENT_RECORDS;
+            }
+        }
+    }
+    
+    Serial.printf("💾 Sample journal: %lu pending in %lu segment(s)\n",
+                 (unsigned long)pendingCount, found ? (unsigned long)(tailSegment - headSegment + 1) : 0UL);
+    
+    return true;
+}
+
+bool SampleJournal::readRecord(File& file, SensorSample& sample) {
+    JournalRecordHeader header;
+    
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    
+    if (header.magic != JOURNAL_RECORD_MAGIC || header.version != JOURNAL_RECORD_VERSION ||
+        header.length != sizeof(SensorSample)) {
+        return false;
+    }
+    
+    if (file.read((uint8_t*)&sample, sizeof(sample)) != sizeof(sample)) {
+        return false;
+    }
+    
+    return header.crc == esp_rom_crc32_le(0, (const uint8_t*)&sample, sizeof(sample));
+}
+
+uint16_t SampleJournal::countValidRecords(uint32_t segment, bool& damaged) {
+    char path[48];
+    segmentPath(segment, path, sizeof(path));
+    
+    damaged = false;
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) {
+        return 0;
+    }
+    
+    SensorSample sample;
+    uint16_t records = 0;
+    while (records < SAMPLE_JOURNAL_SEGMENT_RECORDS && readRecord(file, sample)) {
+        records++;
+    }
+    
+    // Anything after the last valid record is a torn or corrupt write
+    damaged = file.size() > (size_t)records * JOURNAL_RECORD_SIZE;
+    file.close();
+    
+    return records;
+}
+
+bool SampleJournal::openTailSegment() {
+    char path[48];
+    segmentPath(tailSegment, path, sizeof(path));
+    
+    appendFile = LittleFS.open(path, FILE_APPEND);
+    if (!appendFile) {
+        DEBUG_PRINTLN("❌ SampleJournal: Cannot open segment");
+        return false;
+    }
+    
+    return true;
+}
+
+bool SampleJournal::append(const SensorSample& sample) {
+    if (!mounted) {
+        return false;
+    }
+    
+    // Rotate to a fresh segment when the tail is full or sealed
+    if (tailSealed || tailRecords >= SAMPLE_JOURNAL_SEGMENT_RECORDS) {
+        if (appendFile) {
+            appendFile.close();
+        }
+        tailSegment++;
+        tailRecords = 0;
+        tailSealed = false;
+    }
+    
+    // Bounded size - drop the oldest segment
+    while (tailSegment - headSegment + 1 > SAMPLE_JOURNAL_MAX_SEGMENTS) {
+        removeHeadSegment();
+    }
+    
+    // The reader's handle of this segment predates the new record - peek()
+    // reopens it at the same position
+    if (headSegment == tailSegment && readFile) {
+        readFile.close();
+    }
+    
+    if (!appendFile && !openTailSegment()) {
+        return false;
+    }
+    
+    JournalRecordHeader header;
+    header.magic = JOURNAL_RECORD_MAGIC;
+    header.version = JOURNAL_RECORD_VERSION;
+    header.length = sizeof(SensorSample);
+    header.crc = esp_rom_crc32_le(0, (const uint8_t*)&sample, sizeof(sample));
+    
+    size_t written = appendFile.write((const uint8_t*)&header, sizeof(header));
+    written += appendFile.write((const uint8_t*)&sample, sizeof(sample));
+    
+    // Commit before reporting success
+    appendFile.flush();
+    flashWrites++;
+    bytesWritten += written;
+    
+    if (written != JOURNAL_RECORD_SIZE) {
+        // Partial record - seal this segment so nothing follows the damage
+        tailSealed = true;
+        appendFile.close();
+        return false;
+    }
+    
+    tailRecords++;
+    pendingCount++;
+    appendedCount++;
+    
+    return true;
+}
+
+void SampleJournal::closeReadSegment() {
+    if (readFile) {
+        readFile.close();
+    }
+    peekedCount = 0;
+}
+
+void SampleJournal::removeHeadSegment() {
+    char path[48];
+    segmentPath(headSegment, path, sizeof(path));
+    
+    bool damaged;
+    uint16_t records = countValidRecords(headSegment, damaged);
+    uint16_t undelivered = records - min(readIndex, records);
+    
+    closeReadSegment();
+    if (headSegment == tailSegment && appendFile) {
+        appendFile.close();
+    }
+    LittleFS.remove(path);
+    flashWrites++;
+    
+    if (undelivered > 0) {
+        droppedCount += undelivered;
+        pendingCount -= min((uint32_t)undelivered, pendingCount);
+        DEBUG_PRINTF("⚠️  SampleJournal full - dropped %u samples\n", undelivered);
+    }
+    
+    headSegment++;
+    readIndex = 0;
+    
+    if (headSegment > tailSegment) {
+        tailSegment = headSegment;
+        tailRecords = 0;
+        tailSealed = false;
+    }
+}
+
+bool SampleJournal::peek(SensorSample& sample) {
+    if (!mounted || peekedCount >= pendingCount) {
+        return false;
+    }
+    
+    for (;;) {
+        // Never read a segment that is still open for appending; the next
+        // append() reopens it, so a link that flaps mid-drain does not
+        // leave a trail of nearly empty segments
+        if (headSegment == tailSegment && appendFile) {
+            appendFile.close();
+        }
+        
+        if (!readFile) {
+            char path[48];
+            segmentPath(headSegment, path, sizeof(path));
+            readFile = LittleFS.open(path, FILE_READ);
+            if (readFile) {
+                readFile.seek((readIndex + peekedCount) * JOURNAL_RECORD_SIZE);
+            }
+        }
+        
+        if (readFile && readIndex + peekedCount < SAMPLE_JOURNAL_SEGMENT_RECORDS && readRecord(readFile, sample)) {
+            peekedCount++;
+            return true;
+        }
+        
+        // Unacknowledged records still live in this segment - end the batch here
+        if (peekedCount > 0) {
+            return false;
+        }
+        
+        // Segment exhausted (or damaged past this point)
+        if (readFile && readFile.available() > 0) {
+            corruptCount++;
+        }
+        
+        bool wasTail = headSegment == tailSegment;
+        removeHeadSegment();
+        
+        if (wasTail) {
+            // Everything readable has been delivered
+            pendingCount = 0;
+            return false;
+        }
+    }
+}
+
+void SampleJournal::ack() {
+    if (peekedCount == 0) {
+        return;
+    }
+    
+    readIndex += peekedCount;
+    replayedCount += peekedCount;
+    pendingCount -= min((uint32_t)peekedCount, pendingCount);
+    acksSinceCursor += peekedCount;
+    peekedCount = 0;
+    
+    // Persist the read position now and then, not on every record
+    if (acksSinceCursor >= SAMPLE_JOURNAL_CURSOR_INTERVAL || pendingCount == 0) {
+        saveCursor();
+    }
+}
+
+void SampleJournal::rewind() {
+    // Reopen at the first unacknowledged record on the next peek()
+    closeReadSegment();
+}
+
+void SampleJournal::loadCursor() {
+    readIndex = 0;
+    
+    File file = LittleFS.open(SAMPLE_JOURNAL_DIR "/cursor", FILE_READ);
+    if (!file) {
+        return;
+    }
+    
+    JournalCursor cursor;
+    if (file.read((uint8_t*)&cursor, sizeof(cursor)) == sizeof(cursor) &&
+        cursor.magic == JOURNAL_CURSOR_MAGIC &&
+        cursor.crc == esp_rom_crc32_le(0, (const uint8_t*)&cursor, offsetof(JournalCursor, crc)) &&
+        cursor.segment == headSegment) {
+        readIndex = cursor.index;
+    }
+    
+    file.close();
+}
+
+void SampleJournal::saveCursor() {
+    JournalCursor cursor;
+    cursor.magic = JOURNAL_CURSOR_MAGIC;
+    cursor.segment = headSegment;
+    cursor.index = readIndex;
+    cursor.crc = esp_rom_crc32_le(0, (const uint8_t*)&cursor, offsetof(JournalCursor, crc));
+    
+    File file = LittleFS.open(SAMPLE_JOURNAL_DIR "/cursor", FILE_WRITE);
+    if (file) {
+        file.write((const uint8_t*)&cursor, sizeof(cursor));
+        file.close();
+        flashWrites++;
+    }
+    
+    acksSinceCursor = 0;
+}
+
+void SampleJournal::recordDrainTime(uint32_t elapsedMs) {
+    drainTimeMs += elapsedMs;
+}
+
+uint32_t SampleJournal::getPendingCount() {
+    return pendingCount;
+}
+
+uint32_t SampleJournal::getDroppedCount() {
+    return droppedCount;
+}
+
+uint32_t SampleJournal::getReplayedCount() {
+    return replayedCount;
+}
+
+bool SampleJournal::isReady() {
+    return mounted;
+}
+
+void SampleJournal::printStatus() {
+    Serial.println("--- Sample Journal ---");
+    Serial.printf("Mounted: %s | Flash: %u/%u KB used\n", mounted ? "YES" : "NO",
+                 mounted ? (unsigned)(LittleFS.usedBytes() / 1024) : 0,
+                 mounted ? (unsigned)(LittleFS.totalBytes() / 1024) : 0);
+    Serial.printf("Pending: %lu samples | Segments: %lu..%lu (max %d x %d records)\n",
+                 (unsigned long)pendingCount, (unsigned long)headSegment, (unsigned long)tailSegment,
+                 SAMPLE_JOURNAL_MAX_SEGMENTS, SAMPLE_JOURNAL_SEGMENT_RECORDS);
+    Serial.printf("Appended: %lu | Replayed: %lu | Dropped: %lu | Corrupt: %lu\n",
+                 (unsigned long)appendedCount, (unsigned long)replayedCount,
+                 (unsigned long)droppedCount, (unsigned long)corruptCount);
+    Serial.printf("Flash Writes: %lu | Bytes Written: %lu (%u bytes/record)\n",
+                 (unsigned long)flashWrites, (unsigned long)bytesWritten, (unsigned)JOURNAL_RECORD_SIZE);
+    if (drainTimeMs > 0) {
+        Serial.printf("Drain Throughput: %.2f samples/s\n", replayedCount * 1000.0f / drainTimeMs);
+    }
+    Serial.println("---");
+}
@@ -0,0 +1,138 @@
+#ifndef SAMPLE_JOURNAL_H
+#define SAMPLE_JOURNAL_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "config.h"
+#include "sensor_sample.h"
+
+/**
+ * SampleJournal Class
+ * 
+ * Crash-safe, append-only store-and-forward queue of SensorSample records on LittleFS.
+ * 
+ * Records are appended to numbered segment files under SAMPLE_JOURNAL_DIR, each holding
+ * up to SAMPLE_JOURNAL_SEGMENT_RECORDS records with a magic/length/CRC header. A torn
+ * tail after a crash fails its CRC and is skipped on recovery; the damaged segment is
+ * sealed and appends continue in a fresh one. Fully drained segments are deleted, so
+ * writes move across the flash instead of rewriting one file. When
+ * SAMPLE_JOURNAL_MAX_SEGMENTS is reached the oldest segment is dropped.
+ * 
+ * Reading is peek()/ack(): records are only consumed after they were delivered. Several
+ * records can be peeked (within one segment) and acknowledged together, or rewound after
+ * a failed upload. The read position is persisted every SAMPLE_JOURNAL_CURSOR_INTERVAL
+ * acks, so a reset replays at most that many records twice.
+ */
+class SampleJournal {
+private:
+    bool mounted;
+    
+    // Segment window [headSegment, tailSegment]
+    uint32_t headSegment;
+    uint32_t tailSegment;
+    uint16_t tailRecords;       // Records in the tail segment
+    bool tailSealed;            // Tail must not be appended to (damaged)
+    File appendFile;
+    
+    // Read side
+    File readFile;
+    uint32_t readSegment;
+    uint16_t readIndex;         // Next unacknowledged record index in the head segment
+    uint16_t peekedCount;       // Records peeked past readIndex, not yet acknowledged
+    uint16_t acksSinceCursor;
+    
+    // Statistics
+    uint32_t pendingCount;
+    uint32_t appendedCount;
+    uint32_t replayedCount;
+    uint32_t droppedCount;
+    uint32_t corruptCount;
+    uint32_t bytesWritten;
+    uint32_t flashWrites;
+    uint32_t drainTimeMs;
+    
+    // Internal methods
+    void segmentPath(uint32_t segment, char* buffer, size_t size);
+    uint16_t countValidRecords(uint32_t segment, bool& damaged);
+    bool readRecord(File& file, SensorSample& sample);
+    bool openTailSegment();
+    void closeReadSegment();
+    void removeHeadSegment();
+    void loadCursor();
+    void saveCursor();
+
+public:
+    /**
+     * Constructor
+     */
+    SampleJournal();
+    
+    /**
+     * Mount LittleFS and recover journal state
+     * @return true if the journal is usable
+     */
+    bool begin();
+    
+    /**
+     * Append a sample (flushed to flash before returning)
+     * @param sample record to store
+     * @return true if stored
+     */
+    bool append(const SensorSample& sample);
+    
+    /**
+     * Get the next undelivered sample without consuming it. Repeated calls return
+     * successive samples until ack() or rewind(); a multi-sample peek stops at the
+     * end of a segment.
+     * @param sample destination record
+     * @return true if a sample is available
+     */
+    bool peek(SensorSample& sample);
+    
+    /**
+     * Consume all samples returned by peek() since the last ack()/rewind()
+     */
+    void ack();
+    
+    /**
+     * Forget peeked samples so the next peek() returns them again
+     */
+    void rewind();
+    
+    /**
+     * Record time spent draining (for throughput statistics)
+     * @param elapsedMs milliseconds spent in one drain pass
+     */
+    void recordDrainTime(uint32_t elapsedMs);
+    
+    /**
+     * Get number of stored, undelivered samples
+     * @return pending sample count
+     */
+    uint32_t getPendingCount();
+    
+    /**
+     * Get number of samples lost because the journal was full
+     * @return dropped sample count
+     */
+    uint32_t getDroppedCount();
+    
+    /**
+     * Get number of samples delivered from the journal
+     * @return replayed sample count
+     */
+    uint32_t getReplayedCount();
+    
+    /**
+     * Check if the journal is mounted and usable
+     * @return true if ready
+     */
+    bool isReady();
+    
+    /**
+     * Print journal statistics to Serial
+     */
+    void printStatus();
+};
+
+#endif // SAMPLE_JOURNAL_H
@@ -0,0 +1,45 @@
+#ifndef SENSOR_SAMPLE_H
+#define SENSOR_SAMPLE_H
+
+#include <Arduino.h>
+#include "gps_manager.h"
+#include "optocoupler_manager.h"
+#include "voltage_monitor.h"
+#include "geofence.h"
+#include "track_recorder.h"
+#include "wifi_fingerprint.h"
+
+// Field groups carried by a sample upload (report-by-exception mask)
+#define REPORT_FIELD_POWER      0x01    // external_power
+#define REPORT_FIELD_LOCATION   0x02    // location
+#define REPORT_FIELD_GPS        0x04    // gps_info
+#define REPORT_FIELD_NETWORKS   0x08    // wifi_networks (live uploads only)
+#define REPORT_FIELD_SYSTEM     0x10    // system telemetry
+#define REPORT_FIELD_GEOFENCE   0x20    // geofence_events
+#define REPORT_FIELD_TRACK      0x40    // track
+#define REPORT_FIELD_ALL        0x7F
+#define REPORT_HEARTBEAT        0x80    // Full report forced by the heartbeat interval
+
+/**
+ * SensorSample Record
+ * 
+ * Fixed-size record produced by the sensor task and consumed by the network task.
+ * Holds everything the upload path needs, so the network side never touches
+ * the sensor managers directly.
+ */
+struct SensorSample {
+    uint32_t bootId;        // Boot counter from NVS (with sequence: unique sample key)
+    uint32_t sequence;      // Monotonic sample counter since boot
+    uint32_t timestampMs;   // millis() when the sample was taken
+    uint32_t freeHeap;      // Free heap when the sample was taken
+    uint8_t reportMask;     // REPORT_FIELD_* groups to upload (set by the network task)
+    PowerSnapshot power;
+    VoltageSnapshot voltage;
+    GpsSnapshot gps;
+    uint8_t geofenceEventCount;
+    GeofenceEvent geofenceEvents[GEOFENCE_EVENTS_PER_SAMPLE];
+    TrackSegment track;     // Route since the previous sample
+    WiFiLocation wifiLocation;  // Fingerprint estimate without a GPS fix (set by the network task)
+};
+
+#endif // SENSOR_SAMPLE_H
@@ -0,0 +1,151 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * SPSCQueue Class
+ * 
+ * Bounded lock-free single-producer/single-consumer ring queue for fixed-size records.
+ * Exactly one task (or ISR) may push and exactly one task may pop. Neither side ever
+ * blocks: a full queue rejects the push and counts it as dropped.
+ * 
+ * @tparam T        Record type (copied by value, should be trivially copyable)
+ * @tparam Capacity Number of slots, must be a power of two
+ */
+template <typename T, size_t Capacity>
+class SPSCQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SPSCQueue capacity must be a power of two");
+
+private:
+    T buffer[Capacity];
+    
+    // Free-running indices; only the consumer writes head, only the producer writes tail
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    
+    // Statistics (written by producer only)
+    std::atomic<uint32_t> droppedCount;
+    std::atomic<uint32_t> highWaterMark;
+
+public:
+    /**
+     * Constructor
+     */
+    SPSCQueue() : head(0), tail(0), droppedCount(0), highWaterMark(0) {
+    }
+    
+    /**
+     * Append a record (producer side only). Always inlined so an IRAM interrupt
+     * handler can push without calling into flash.
+     * @param item record to copy into the queue
+     * @return true if queued, false if the queue was full and the record was dropped
+     */
+    inline __attribute__((always_inline)) bool push(const T& item) {
+        uint32_t currentTail = tail.load(std::memory_order_relaxed);
+        uint32_t used = currentTail - head.load(std::memory_order_acquire);
+        
+        if (used >= Capacity) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        buffer[currentTail & (Capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        
+        if (used + 1 > highWaterMark.load(std::memory_order_relaxed)) {
+            highWaterMark.store(used + 1, std::memory_order_relaxed);
+        }
+        
+        return true;
+    }
+    
+    /**
+     * Reserve the next slot to build a record in place (producer side only).
+     * The consumer does not see it until commit()
+     * @return slot to fill, or nullptr if the queue is full (counted as dropped)
+     */
+    T* reserve() {
+        uint32_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) >= Capacity) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &buffer[currentTail & (Capacity - 1)];
+    }
+    
+    /**
+     * Publish the slot returned by the last reserve() (producer side only)
+     */
+    void commit() {
+        uint32_t currentTail = tail.load(std::memory_order_relaxed);
+        tail.store(currentTail + 1, std::memory_order_release);
+        
+        uint32_t used = currentTail + 1 - head.load(std::memory_order_acquire);
+        if (used > highWaterMark.load(std::memory_order_relaxed)) {
+            highWaterMark.store(used, std::memory_order_relaxed);
+        }
+    }
+    
+    /**
+     * Remove the oldest record (consumer side only)
+     * @param item destination for the record
+     * @return true if a record was removed, false if the queue was empty
+     */
+    bool pop(T& item) {
+        uint32_t currentHead = head.load(std::memory_order_relaxed);
+        
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        
+        item = buffer[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        
+        return true;
+    }
+    
+    /**
+     * Get number of queued records (approximate when called from a third task)
+     * @return records currently waiting
+     */
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    
+    /**
+     * Check if the queue holds no records
+     * @return true if empty
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+    
+    /**
+     * Get queue capacity
+     * @return number of slots
+     */
+    size_t capacity() const {
+        return Capacity;
+    }
+    
+    /**
+     * Get number of records rejected because the queue was full
+     * @return dropped record count
+     */
+    uint32_t getDroppedCount() const {
+        return droppedCount.load(std::memory_order_relaxed);
+    }
+    
+    /**
+     * Get the highest fill level observed since startup
+     * @return maximum number of queued records
+     */
+    uint32_t getHighWaterMark() const {
+        return highWaterMark.load(std::memory_order_relaxed);
+    }
+};
+
+#endif // SPSC_QUEUE_H
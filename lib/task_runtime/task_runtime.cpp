@@ -0,0 +1,508 @@
+#include "task_runtime.h"
+#include "config.h"
+#include "wifi_manager.h"
+#include "firebase_client.h"
+#include "gps_manager.h"
+#include "optocoupler_manager.h"
+#include "power_channels.h"
+#include "voltage_monitor.h"
+#include "geofence.h"
+#include "track_recorder.h"
+#include "wifi_fingerprint.h"
+#include "sample_journal.h"
+#include <Preferences.h>
+
+TaskRuntime::TaskRuntime() {
+    wifiMgr = nullptr;
+    firebaseClient = nullptr;
+    gpsMgr = nullptr;
+    optocouplerMgr = nullptr;
+    powerChannels = nullptr;
+    voltageMonitor = nullptr;
+    geofences = nullptr;
+    track = nullptr;
+    fingerprints = nullptr;
+    journal = nullptr;
+    sensorTaskHandle = nullptr;
+    networkTaskHandle = nullptr;
+    bootId = 0;
+    nextSequence = 0;
+    lastSampleTime = 0;
+    lastEpoch = 0;
+    samplesSent = 0;
+    samplesFailed = 0;
+    samplesSkipped = 0;
+    printTableRequested = false;
+    printJournalRequested = false;
+    encodingToggleRequested = false;
+    samplesJournaled = 0;
+    firstUploadTime = 0;
+}
+
+bool TaskRuntime::begin(WiFiManager* wifi, FirebaseClient* firebase, GPSManager* gps, OptocouplerManager* optocoupler,
+                        SampleJournal* sampleJournal) {
+    if (!wifi || !firebase || !gps || !optocoupler) {
+        DEBUG_PRINTLN("❌ TaskRuntime: Missing component");
+        return false;
+    }
+    
+    wifiMgr = wifi;
+    firebaseClient = firebase;
+    gpsMgr = gps;
+    optocouplerMgr = optocoupler;
+    journal = (sampleJournal && sampleJournal->isReady()) ? sampleJournal : nullptr;
+    reportFilter.begin(REPORT_BY_EXCEPTION);
+    
+    // Boot counter makes (bootId, sequence) unique across resets
+    Preferences prefs;
+    if (prefs.begin("system", false)) {
+        bootId = prefs.getUInt("boot_count", 0) + 1;
+        prefs.putUInt("boot_count", bootId);
+        prefs.end();
+    }
+    
+    // Network task first so the sensor task always has someone to notify
+    if (xTaskCreatePinnedToCore(networkTaskEntry, "network", NETWORK_TASK_STACK_SIZE, this,
+                                NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE) != pdPASS) {
+        DEBUG_PRINTLN("❌ TaskRuntime: Failed to create network task");
+        return false;
+    }
+    
+    if (xTaskCreatePinnedToCore(sensorTaskEntry, "sensor", SENSOR_TASK_STACK_SIZE, this,
+                                SENSOR_TASK_PRIORITY, &sensorTaskHandle, SENSOR_TASK_CORE) != pdPASS) {
+        DEBUG_PRINTLN("❌ TaskRuntime: Failed to create sensor task");
+        return false;
+    }
+    
+    DEBUG_PRINTLN("⚙️  TaskRuntime started");
+    
+    return true;
+}
+
+void TaskRuntime::attachPowerChannels(PowerChannels* channels) {
+    powerChannels = channels;
+}
+
+void TaskRuntime::attachVoltageMonitor(VoltageMonitor* monitor) {
+    voltageMonitor = monitor;
+}
+
+void TaskRuntime::attachGeofences(GeofenceEngine* engine) {
+    geofences = engine;
+}
+
+void TaskRuntime::attachTrackRecorder(TrackRecorder* recorder) {
+    track = recorder;
+}
+
+void TaskRuntime::attachWiFiFingerprints(WiFiFingerprintDb* database) {
+    fingerprints = database;
+}
+
+void TaskRuntime::sensorTaskEntry(void* param) {
+    static_cast<TaskRuntime*>(param)->sensorTaskLoop();
+}
+
+void TaskRuntime::networkTaskEntry(void* param) {
+    static_cast<TaskRuntime*>(param)->networkTaskLoop();
+}
+
+void TaskRuntime::sensorTaskLoop() {
+    TickType_t lastWake = xTaskGetTickCount();
+    
+    for (;;) {
+        // Handle serial commands
+        while (Serial.available()) {
+            handleSerialCommand(Serial.read());
+        }
+        
+        // Update GPS data; a geofence event or a full track window goes out right away
+        if (gpsMgr->update() && (geofences || track) && processFix()) {
+            publishSample();
+        }
+        
+        // Update optocoupler data
+        if (optocouplerMgr->update()) {
+            // Power state changed - show brief message
+            Serial.printf("🔌 Power: %s\n", optocouplerMgr->getPowerStatusString().c_str());
+        }
+        
+        // One register read debounces every power channel
+        if (powerChannels && powerChannels->tick()) {
+            Serial.printf("🔌 Channels: 0x%04lX (changed 0x%04lX)\n",
+                         (unsigned long)powerChannels->getPresentMask(),
+                         (unsigned long)powerChannels->getChangedMask());
+        }
+        
+        // Periodic sample hand-off to the network task
+        if (millis() - lastSampleTime >= SENSOR_READ_INTERVAL) {
+            lastSampleTime = millis();
+            publishSample();
+        }
+        
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_TASK_PERIOD_MS));
+    }
+}
+
+void TaskRuntime::networkTaskLoop() {
+    for (;;) {
+        // Sleep until a sample arrives (or poll WiFi state periodically);
+        // keep going without sleeping while there is a backlog to drain
+        bool backlog = journal && journal->getPendingCount() > 0 && wifiMgr->isWiFiConnected();
+        ulTaskNotifyTake(pdTRUE, backlog ? 0 : pdMS_TO_TICKS(NETWORK_TASK_IDLE_MS));
+        
+        // Advance the WiFi connection state machine (never blocks)
+        wifiMgr->update();
+        
+        // Drive the background scan; the table is only touched from this task
+        wifiMgr->updateScan();
+        reportFilter.observeScan(wifiMgr->getScanTable());
+        
+        // Switch encoding between requests, never while one is being streamed
+        if (encodingToggleRequested) {
+            encodingToggleRequested = false;
+            bool compact = firebaseClient->getEncoding() != PAYLOAD_ENCODING_COMPACT;
+            firebaseClient->setEncoding(compact ? PAYLOAD_ENCODING_COMPACT : PAYLOAD_ENCODING_JSON);
+            Serial.printf("📦 Payload encoding: %s\n", compact ? "COMPACT (CBOR)" : "JSON");
+        }
+        
+        SensorSample sample;
+        while (sampleQueue.pop(sample)) {
+            acceptSample(sample);
+        }
+        
+        // Live samples first, then one batch of the offline backlog
+        flushLiveBatch();
+        drainJournal();
+        
+        if (printTableRequested) {
+            printTableRequested = false;
+            wifiMgr->printConnectionInfo();
+            wifiMgr->printScanTable();
+            if (fingerprints) {
+                fingerprints->printStatus();
+            }
+            firebaseClient->printStatus();
+        }
+        
+        if (printJournalRequested) {
+            printJournalRequested = false;
+            if (journal) {
+                journal->printStatus();
+            } else {
+                Serial.println("Sample journal not available");
+            }
+        }
+    }
+}
+
+void TaskRuntime::handleSerialCommand(char command) {
+    if (command == 'g' || command == 'G') {
+        Serial.println("Printing GPS status...");
+        gpsMgr->printGPSStatus();
+        if (track) {
+            track->printStatus();
+        }
+    } else if (command == 'i' || command == 'I') {
+        Serial.println("Printing GPS debug info...");
+        gpsMgr->printDebugInfo();
+    } else if (command == 'p' || command == 'P') {
+        Serial.println("Printing power status...");
+        optocouplerMgr->printStatus();
+        if (voltageMonitor) {
+            voltageMonitor->printStatus();
+        }
+    } else if (command == 'o' || command == 'O') {
+        Serial.println("Printing power debug info...");
+        optocouplerMgr->printDebugInfo();
+    } else if (command == 'r' || command == 'R') {
+        Serial.println("Resetting power statistics...");
+        optocouplerMgr->resetStatistics();
+        if (powerChannels) {
+            powerChannels->resetStatistics();
+        }
+        if (voltageMonitor) {
+            voltageMonitor->resetStatistics();
+        }
+    } else if (command == 'm' || command == 'M') {
+        if (powerChannels) {
+            Serial.println("Printing power channels...");
+            powerChannels->printStatus();
+        } else {
+            Serial.println("Power channels not enabled");
+        }
+    } else if (command == 'w' || command == 'W') {
+        Serial.println("Requesting WiFi status...");
+        printTableRequested = true;
+    } else if (command == 'j' || command == 'J') {
+        Serial.println("Requesting journal status...");
+        printJournalRequested = true;
+    } else if (command == 'c' || command == 'C') {
+        Serial.println("Toggling payload encoding...");
+        encodingToggleRequested = true;
+    } else if (command == 'f' || command == 'F') {
+        if (geofences) {
+            Serial.println("Printing geofences...");
+            geofences->printStatus();
+        } else {
+            Serial.println("Geofences not enabled");
+        }
+    } else if (command == 't' || command == 'T') {
+        Serial.println("Printing task status...");
+        printStatus();
+    }
+}
+
+void TaskRuntime::publishSample() {
+    // Built in place in the queue slot - a sample (geofence events, track
+    // vertices) is too big to assemble on the sensor task stack. When the
+    // queue is full, events and route stay with their owners for the next one
+    SensorSample* slot = sampleQueue.reserve();
+    if (!slot) {
+        DEBUG_PRINTLN("⚠️  Sample queue full - sample dropped");
+        return;
+    }
+    
+    // The slot still holds an older sample
+    SensorSample& sample = *slot;
+    memset(&sample, 0, sizeof(sample));
+    sample.bootId = bootId;
+    sample.sequence = nextSequence++;
+    sample.timestampMs = millis();
+    sample.freeHeap = ESP.getFreeHeap();
+    sample.reportMask = REPORT_FIELD_ALL;
+    optocouplerMgr->getSnapshot(sample.power);
+    if (voltageMonitor) {
+        voltageMonitor->getSnapshot(sample.voltage);
+    }
+    gpsMgr->getSnapshot(sample.gps);
+    if (geofences) {
+        sample.geofenceEventCount = geofences->takeEvents(sample.geofenceEvents, GEOFENCE_EVENTS_PER_SAMPLE);
+    }
+    if (track) {
+        track->takeSegment(sample.track);
+    }
+    
+    sampleQueue.commit();
+    xTaskNotifyGive(networkTaskHandle);
+}
+
+bool TaskRuntime::processFix() {
+    // Once per navigation solution - several sentences make up one fix
+    GpsUartStats stats;
+    gpsMgr->getUartStats(stats);
+    if (stats.epochs == lastEpoch) {
+        return false;
+    }
+    lastEpoch = stats.epochs;
+    
+    GpsSnapshot gps;
+    gpsMgr->getSnapshot(gps);
+    if (!gps.locationValid) {
+        return false;
+    }
+    
+    // The filtered position keeps outliers from crossing a boundary or bending the route
+    const PositionEstimate& filtered = gps.filtered;
+    int32_t latE7 = filtered.valid ? filtered.latitudeE7 : gps.latitudeE7;
+    int32_t lonE7 = filtered.valid ? filtered.longitudeE7 : gps.longitudeE7;
+    uint32_t fixMs = millis() - gps.timeSinceUpdate;
+    
+    bool publish = false;
+    if (geofences && geofences->update(latE7, lonE7, fixMs)) {
+        publish = true;
+    }
+    if (track && track->add(latE7, lonE7, fixMs)) {
+        publish = true;
+    }
+    return publish;
+}
+
+void TaskRuntime::acceptSample(SensorSample& sample) {
+    bool online = wifiMgr->isWiFiConnected();
+    locateByWiFi(sample);
+    
+    // Nothing moved past its deadband - no upload, no journal entry
+    sample.reportMask = reportFilter.evaluate(sample, online);
+    if (sample.reportMask == 0) {
+        DEBUG_PRINTF("· Sample %lu unchanged - not reported\n", (unsigned long)sample.sequence);
+        return;
+    }
+    
+    if (online) {
+        // Collect into the live batch; sent when a flush trigger fires
+        liveBatch.add(sample, firebaseClient->measureSample(sample, wifiMgr));
+    } else {
+        Serial.println("\n❌ No WiFi - storing sample for later");
+        storeSample(sample);
+    }
+    
+    printSampleStatus(sample);
+}
+
+void TaskRuntime::locateByWiFi(SensorSample& sample) {
+    memset(&sample.wifiLocation, 0, sizeof(sample.wifiLocation));
+    if (!fingerprints) {
+        return;
+    }
+    
+    // Learn only from fixes good enough to be worth recalling: the filtered
+    // position when there is one, else a raw fix with a known, small error
+    // (filter disabled, restarting or gating fixes out)
+    const WiFiScanTable& table = wifiMgr->getScanTable();
+    const GpsSnapshot& gps = sample.gps;
+    const uint32_t learnAccuracyMm = WIFI_FP_LEARN_ACCURACY_M * 1000UL;
+    if (!gps.locationValid) {
+        fingerprints->estimate(table, sample.wifiLocation);
+    } else if (gps.filtered.valid) {
+        if (gps.filtered.uncertaintyMm <= learnAccuracyMm) {
+            fingerprints->learn(table, gps.filtered.latitudeE7, gps.filtered.longitudeE7, sample.timestampMs);
+        }
+    } else if (gps.accuracyMm > 0 && gps.accuracyMm <= learnAccuracyMm) {
+        fingerprints->learn(table, gps.latitudeE7, gps.longitudeE7, sample.timestampMs);
+    }
+}
+
+void TaskRuntime::flushLiveBatch() {
+    if (liveBatch.size() == 0) {
+        return;
+    }
+    
+    // Connection lost while collecting - keep the samples in the journal
+    if (!wifiMgr->isWiFiConnected()) {
+        for (int i = 0; i < liveBatch.size(); i++) {
+            storeSample(liveBatch.getSample(i));
+        }
+        liveBatch.clear();
+        return;
+    }
+    
+    if (!liveBatch.shouldFlush()) {
+        return;
+    }
+    
+    int count = liveBatch.size();
+    Serial.printf("\n--- Data Transmission (%d samples) ---\n", count);
+    
+    // Send data to Firebase (WiFi networks come from the latest scan table)
+    if (firebaseClient->sendBatch(liveBatch, wifiMgr)) {
+        samplesSent += count;
+        if (firstUploadTime == 0) {
+            firstUploadTime = millis();
+            Serial.printf("⏱️  First upload %lu ms after boot (WiFi up at %lu ms)\n",
+                         firstUploadTime, wifiMgr->getFirstConnectTime());
+        }
+        Serial.println("✅ Data sent to database");
+    } else {
+        samplesFailed += count;
+        Serial.println("❌ Data transmission failed");
+        for (int i = 0; i < count; i++) {
+            storeSample(liveBatch.getSample(i));
+        }
+    }
+    
+    liveBatch.clear();
+}
+
+void TaskRuntime::storeSample(const SensorSample& sample) {
+    if (journal && journal->append(sample)) {
+        samplesJournaled++;
+        DEBUG_PRINTF("💾 Sample journaled (%lu pending)\n", (unsigned long)journal->getPendingCount());
+    } else {
+        samplesSkipped++;
+    }
+}
+
+void TaskRuntime::drainJournal() {
+    // Yield to live samples as soon as one is waiting
+    if (!journal || journal->getPendingCount() == 0 || !wifiMgr->isWiFiConnected() || !sampleQueue.isEmpty()) {
+        return;
+    }
+    
+    unsigned long start = millis();
+    SensorSample sample;
+    
+    // Oldest first, as one multi-sample write
+    replayBatch.clear(true);
+    while (!replayBatch.isFull() && journal->peek(sample)) {
+        replayBatch.add(sample, firebaseClient->measureSample(sample, wifiMgr));
+    }
+    
+    if (replayBatch.size() == 0) {
+        return;
+    }
+    
+    if (firebaseClient->sendBatch(replayBatch, wifiMgr)) {
+        journal->ack();
+        Serial.printf("📤 Replayed %d stored samples (%lu pending)\n",
+                     replayBatch.size(), (unsigned long)journal->getPendingCount());
+    } else {
+        journal->rewind();
+    }
+    
+    journal->recordDrainTime(millis() - start);
+}
+
+void TaskRuntime::printSampleStatus(const SensorSample& sample) {
+    // Print compact system status
+    Serial.println("--- Status ---");
+    Serial.printf("Uptime: %lu min | Heap: %u KB | WiFi: %s\n", 
+                 millis()/60000, ESP.getFreeHeap()/1024, 
+                 wifiMgr->isWiFiConnected() ? "✓" : wifiMgr->getStateString());
+    
+    // Compact power status
+    const PowerSnapshot& power = sample.power;
+    Serial.printf("Power: %s", power.powerPresent ? "ON" : "OFF");
+    if (power.stateChanges > 0) {
+        unsigned long totalTime = power.totalOnTime + power.totalOffTime;
+        if (totalTime > 0) {
+            float uptime = (float)power.totalOnTime / totalTime * 100.0;
+            Serial.printf(" (%.1f%% uptime)", uptime);
+        }
+    }
+    Serial.println();
+    
+    // Upload batching
+    Serial.printf("Batch: %d/%d samples, %lu bytes, %lu ms old\n",
+                 liveBatch.size(), UPLOAD_BATCH_MAX_SAMPLES,
+                 (unsigned long)liveBatch.getEncodedBytes(), liveBatch.getAge());
+    
+    // Compact WiFi scan status
+    const WiFiScanTable& scanTable = wifiMgr->getScanTable();
+    const WiFiScanDiff& diff = scanTable.getLastDiff();
+    Serial.printf("Networks: %d (+%d -%d ~%d)\n", scanTable.size(),
+                 diff.appeared, diff.disappeared, diff.rssiChanged);
+    
+    // Compact GPS status
+    const GpsSnapshot& gps = sample.gps;
+    if (gps.locationValid) {
+        char latitude[16];
+        char longitude[16];
+        gpsFormatFixed(latitude, sizeof(latitude), gpsDivRound(gps.latitudeE7, 1000), 4);
+        gpsFormatFixed(longitude, sizeof(longitude), gpsDivRound(gps.longitudeE7, 1000), 4);
+        Serial.printf("GPS: %s,%s (%d sats)\n", latitude, longitude, gps.satellites);
+    } else {
+        Serial.printf("GPS: %s\n", gps.active ? "Searching..." : "Inactive");
+    }
+    
+    Serial.println("Commands: g=GPS p=Power o=Debug m=Channels f=Geofences r=Reset w=WiFi j=Journal c=Encoding t=Tasks | ----\n");
+}
+
+void TaskRuntime::printStatus() {
+    Serial.println("--- Task Runtime Status ---");
+    Serial.printf("Sensor Task: core %d, stack free %u bytes\n", SENSOR_TASK_CORE,
+                 sensorTaskHandle ? uxTaskGetStackHighWaterMark(sensorTaskHandle) : 0);
+    Serial.printf("Network Task: core %d, stack free %u bytes\n", NETWORK_TASK_CORE,
+                 networkTaskHandle ? uxTaskGetStackHighWaterMark(networkTaskHandle) : 0);
+    Serial.printf("Samples Produced: %lu\n", (unsigned long)nextSequence);
+    Serial.printf("Sample Queue: %u/%u (peak %lu, dropped %lu)\n",
+                 (unsigned)sampleQueue.size(), (unsigned)sampleQueue.capacity(),
+                 (unsigned long)sampleQueue.getHighWaterMark(),
+                 (unsigned long)sampleQueue.getDroppedCount());
+    Serial.printf("Samples Sent: %lu | Failed: %lu | Journaled: %lu | Lost: %lu\n",
+                 (unsigned long)samplesSent, (unsigned long)samplesFailed,
+                 (unsigned long)samplesJournaled, (unsigned long)samplesSkipped);
+    reportFilter.printStatus();
+    Serial.printf("First Upload: %lu ms after boot\n", firstUploadTime);
+    Serial.println("---");
+}
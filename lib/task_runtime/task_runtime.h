@@ -0,0 +1,164 @@
+#ifndef TASK_RUNTIME_H
+#define TASK_RUNTIME_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "spsc_queue.h"
+#include "sensor_sample.h"
+#include "sample_batch.h"
+#include "report_filter.h"
+
+// Forward declarations
+class WiFiManager;
+class FirebaseClient;
+class GPSManager;
+class OptocouplerManager;
+class PowerChannels;
+class VoltageMonitor;
+class GeofenceEngine;
+class TrackRecorder;
+class WiFiFingerprintDb;
+class SampleJournal;
+
+/**
+ * TaskRuntime Class
+ * 
+ * Runs the system as two pinned FreeRTOS tasks:
+ * - Sensor task (SENSOR_TASK_CORE): GPS parsing, geofence checks, track
+ *   recording, power detection (single and multi-channel), serial commands
+ * - Network task (NETWORK_TASK_CORE): WiFi upkeep, scanning, WiFi fingerprint
+ *   learning and lookup, and Firebase uploads
+ * 
+ * The tasks only exchange fixed-size SensorSample records through a lock-free
+ * SPSC queue, so a slow upload never delays sensing. Samples that cannot be sent
+ * are stored in the SampleJournal and replayed once connectivity returns.
+ * The ReportFilter drops samples (or field groups) that carry no change.
+ * Geofence events are published as soon as they are confirmed, without
+ * waiting for the sample interval, and flush the upload batch. A full
+ * track window is published early too, so no part of the route is lost.
+ */
+class TaskRuntime {
+private:
+    // Managed components
+    WiFiManager* wifiMgr;
+    FirebaseClient* firebaseClient;
+    GPSManager* gpsMgr;
+    OptocouplerManager* optocouplerMgr;
+    PowerChannels* powerChannels;
+    VoltageMonitor* voltageMonitor;
+    GeofenceEngine* geofences;
+    TrackRecorder* track;
+    WiFiFingerprintDb* fingerprints;
+    SampleJournal* journal;
+    
+    // Task handles
+    TaskHandle_t sensorTaskHandle;
+    TaskHandle_t networkTaskHandle;
+    
+    // Sensor -> network sample queue
+    SPSCQueue<SensorSample, SAMPLE_QUEUE_CAPACITY> sampleQueue;
+    
+    // Sensor task state
+    uint32_t bootId;
+    uint32_t nextSequence;
+    unsigned long lastSampleTime;
+    uint32_t lastEpoch;           // GPS epoch last passed to the fences and track
+    
+    // Network task report-by-exception filter
+    ReportFilter reportFilter;
+    
+    // Network task upload batches
+    SampleBatch liveBatch;
+    SampleBatch replayBatch;
+    
+    // Network task statistics
+    uint32_t samplesSent;
+    uint32_t samplesFailed;
+    uint32_t samplesSkipped;      // Lost: offline and not journaled
+    uint32_t samplesJournaled;
+    unsigned long firstUploadTime;
+    
+    // Console requests served by the network task (it owns the scan table)
+    volatile bool printTableRequested;
+    volatile bool printJournalRequested;
+    volatile bool encodingToggleRequested;
+    
+    // Task bodies
+    static void sensorTaskEntry(void* param);
+    static void networkTaskEntry(void* param);
+    void sensorTaskLoop();
+    void networkTaskLoop();
+    
+    // Internal methods
+    void handleSerialCommand(char command);
+    void publishSample();
+    bool processFix();
+    void acceptSample(SensorSample& sample);
+    void locateByWiFi(SensorSample& sample);
+    void flushLiveBatch();
+    void storeSample(const SensorSample& sample);
+    void drainJournal();
+    void printSampleStatus(const SensorSample& sample);
+
+public:
+    /**
+     * Constructor
+     */
+    TaskRuntime();
+    
+    /**
+     * Start sensor and network tasks
+     * @param wifi WiFi manager (owned by the network task afterwards)
+     * @param firebase Firebase client (owned by the network task afterwards)
+     * @param gps GPS manager (owned by the sensor task afterwards)
+     * @param optocoupler Optocoupler manager (owned by the sensor task afterwards)
+     * @param sampleJournal Offline sample store (optional, owned by the network task afterwards)
+     * @return true if both tasks were created
+     */
+    bool begin(WiFiManager* wifi, FirebaseClient* firebase, GPSManager* gps, OptocouplerManager* optocoupler,
+               SampleJournal* sampleJournal = nullptr);
+    
+    /**
+     * Attach a multi-channel power detector, ticked every sensor period
+     * (call before begin())
+     * @param channels Power channel detector (owned by the sensor task afterwards)
+     */
+    void attachPowerChannels(PowerChannels* channels);
+    
+    /**
+     * Attach a line voltage monitor whose aggregates go into every sample
+     * (call before begin())
+     * @param monitor Voltage monitor (runs its own acquisition task)
+     */
+    void attachVoltageMonitor(VoltageMonitor* monitor);
+    
+    /**
+     * Attach a geofence engine, checked on every new GPS fix
+     * (call before begin())
+     * @param engine Loaded geofences (owned by the sensor task afterwards)
+     */
+    void attachGeofences(GeofenceEngine* engine);
+    
+    /**
+     * Attach a track recorder fed with every GPS solution; each sample
+     * carries the simplified route since the previous one
+     * (call before begin())
+     * @param recorder Track recorder (owned by the sensor task afterwards)
+     */
+    void attachTrackRecorder(TrackRecorder* recorder);
+    
+    /**
+     * Attach a WiFi fingerprint database: samples with a GPS fix teach it,
+     * samples without one get its position estimate
+     * (call before begin())
+     * @param database Loaded fingerprints (owned by the network task afterwards)
+     */
+    void attachWiFiFingerprints(WiFiFingerprintDb* database);
+    
+    /**
+     * Print task and queue statistics to Serial
+     */
+    void printStatus();
+};
+
+#endif // TASK_RUNTIME_H
@@ -0,0 +1,197 @@
+#include "track_recorder.h"
+#include "gps_fixed.h"
+
+static_assert(TRACK_MAX_VERTICES >= 2 && TRACK_MAX_VERTICES <= 255, "Vertex count is 8 bit");
+static_assert(TRACK_WINDOW_FIXES >= TRACK_MAX_VERTICES, "Window must hold the vertices");
+
+static int appendPolylineValue(char* buffer, size_t size, int length, int32_t value) {
+    // Zigzag, then 5-bit groups (low first) offset by 63, 0x20 marks a continuation
+    uint32_t bits = value < 0 ? ~((uint32_t)value << 1) : (uint32_t)value << 1;
+    do {
+        uint32_t chunk = bits & 0x1F;
+        bits >>= 5;
+        if (bits != 0) {
+            chunk |= 0x20;
+        }
+        if ((size_t)length + 1 >= size) {
+            return -1;
+        }
+        buffer[length++] = (char)(chunk + 63);
+    } while (bits != 0);
+    return length;
+}
+
+int trackEncodePolyline(const TrackSegment& segment, char* buffer, size_t size) {
+    if (size == 0) {
+        return -1;
+    }
+    
+    int length = 0;
+    int32_t previousLat = 0;
+    int32_t previousLon = 0;
+    for (uint8_t i = 0; i < segment.pointCount && length >= 0; i++) {
+        int32_t lat = gpsDivRound(segment.latitudeE7[i], 100);
+        int32_t lon = gpsDivRound(segment.longitudeE7[i], 100);
+        length = appendPolylineValue(buffer, size, length, lat - previousLat);
+        if (length >= 0) {
+            length = appendPolylineValue(buffer, size, length, lon - previousLon);
+        }
+        previousLat = lat;
+        previousLon = lon;
+    }
+    
+    buffer[length >= 0 ? length : 0] = '\0';
+    return length;
+}
+
+TrackRecorder::TrackRecorder() {
+    fixCount = 0;
+    latScale = 1.0f;
+    lonScale = 1.0f;
+    fixesRecorded = 0;
+    segmentsTaken = 0;
+    verticesKept = 0;
+    toleranceWidened = 0;
+}
+
+bool TrackRecorder::add(int32_t latE7, int32_t lonE7, uint32_t nowMs) {
+    // Repeated positions (parked output) carry no route
+    if (fixCount > 0 && fixLat[fixCount - 1] == latE7 && fixLon[fixCount - 1] == lonE7) {
+        return false;
+    }
+    
+    // Nobody took the full window - keep the route current by replacing its end
+    if (fixCount >= TRACK_WINDOW_FIXES) {
+        fixCount = TRACK_WINDOW_FIXES - 1;
+    }
+    
+    fixLat[fixCount] = latE7;
+    fixLon[fixCount] = lonE7;
+    fixMs[fixCount] = nowMs;
+    fixCount++;
+    fixesRecorded++;
+    
+    return fixCount >= TRACK_WINDOW_FIXES;
+}
+
+float TrackRecorder::offsetSqCm2(uint16_t point, uint16_t first, uint16_t last) {
+    // Local flat frame around the first fix; distance to the segment, not the
+    // infinite line, so a route that doubles back is not cut short
+    float bx = (fixLon[last] - fixLon[first]) * lonScale;
+    float by = (fixLat[last] - fixLat[first]) * latScale;
+    float px = (fixLon[point] - fixLon[first]) * lonScale;
+    float py = (fixLat[point] - fixLat[first]) * latScale;
+    
+    float lengthSq = bx * bx + by * by;
+    float t = lengthSq > 0.0f ? (px * bx + py * by) / lengthSq : 0.0f;
+    if (t < 0.0f) {
+        t = 0.0f;
+    } else if (t > 1.0f) {
+        t = 1.0f;
+    }
+    float dx = px - t * bx;
+    float dy = py - t * by;
+    return dx * dx + dy * dy;
+}
+
+uint16_t TrackRecorder::simplify(uint32_t toleranceCm) {
+    // Iterative Douglas-Peucker: split each range at its farthest fix while
+    // that fix is off the chord by more than the tolerance
+    const float toleranceSq = (float)toleranceCm * toleranceCm;
+    memset(keep, 0, fixCount * sizeof(keep[0]));
+    keep[0] = true;
+    keep[fixCount - 1] = true;
+    uint16_t kept = 2;
+    
+    uint16_t ranges = 0;
+    rangeFirst[ranges] = 0;
+    rangeLast[ranges] = fixCount - 1;
+    ranges++;
+    
+    while (ranges > 0) {
+        ranges--;
+        uint16_t first = rangeFirst[ranges];
+        uint16_t last = rangeLast[ranges];
+        
+        uint16_t farthest = first;
+        float farthestSq = 0.0f;
+        for (uint16_t i = first + 1; i < last; i++) {
+            float offsetSq = offsetSqCm2(i, first, last);
+            if (offsetSq > farthestSq) {
+                farthestSq = offsetSq;
+                farthest = i;
+            }
+        }
+        if (farthestSq <= toleranceSq) {
+            continue;
+        }
+        
+        keep[farthest] = true;
+        kept++;
+        // Each split adds one range at most, so the stack never exceeds the window
+        rangeFirst[ranges] = first;
+        rangeLast[ranges] = farthest;
+        ranges++;
+        rangeFirst[ranges] = farthest;
+        rangeLast[ranges] = last;
+        ranges++;
+    }
+    
+    return kept;
+}
+
+void TrackRecorder::takeSegment(TrackSegment& segment) {
+    memset(&segment, 0, sizeof(segment));
+    if (fixCount < 2) {
+        return;
+    }
+    
+    latScale = (float)GPS_CM_PER_E7_NUM / GPS_CM_PER_E7_DEN;
+    lonScale = latScale * cosf(fixLat[0] * GPS_RAD_PER_E7);
+    
+    uint32_t toleranceCm = TRACK_TOLERANCE_M * 100UL;
+    uint16_t kept = simplify(toleranceCm);
+    while (kept > TRACK_MAX_VERTICES) {
+        toleranceCm *= 2;
+        toleranceWidened++;
+        kept = simplify(toleranceCm);
+    }
+    
+    // Still within the tolerance of the window start - nothing to report yet;
+    // the start stays, so slow drift adds up against it
+    uint16_t last = fixCount - 1;
+    if (kept == 2 && offsetSqCm2(last, 0, 0) <= (float)toleranceCm * toleranceCm) {
+        fixCount = 1;
+        return;
+    }
+    
+    for (uint16_t i = 0; i < fixCount; i++) {
+        if (keep[i]) {
+            segment.latitudeE7[segment.pointCount] = fixLat[i];
+            segment.longitudeE7[segment.pointCount] = fixLon[i];
+            segment.pointCount++;
+        }
+    }
+    segment.fixCount = fixCount;
+    segment.toleranceCm = toleranceCm;
+    segment.startMs = fixMs[0];
+    segment.endMs = fixMs[last];
+    segmentsTaken++;
+    verticesKept += segment.pointCount;
+    
+    // The last vertex starts the next window
+    fixLat[0] = fixLat[last];
+    fixLon[0] = fixLon[last];
+    fixMs[0] = fixMs[last];
+    fixCount = 1;
+}
+
+void TrackRecorder::printStatus() {
+    Serial.printf("Track: %u/%d fixes in window, tolerance %d m\n",
+                 fixCount, TRACK_WINDOW_FIXES, TRACK_TOLERANCE_M);
+    Serial.printf("Track Segments: %lu, %lu vertices from %lu fixes (%.1f%% kept), tolerance widened %lu times\n",
+                 (unsigned long)segmentsTaken, (unsigned long)verticesKept,
+                 (unsigned long)fixesRecorded,
+                 fixesRecorded ? 100.0 * verticesKept / fixesRecorded : 0.0,
+                 (unsigned long)toleranceWidened);
+}
@@ -0,0 +1,98 @@
+#ifndef TRACK_RECORDER_H
+#define TRACK_RECORDER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Longest encoded polyline of one segment (two values of up to 6 characters per vertex)
+#define TRACK_POLYLINE_MAX (TRACK_MAX_VERTICES * 12 + 1)
+
+/**
+ * Simplified route between two samples, fixed-size so it can travel in a sample
+ */
+struct TrackSegment {
+    uint8_t pointCount;           // Vertices kept (0 = no movement beyond the tolerance)
+    uint16_t fixCount;            // Fixes the vertices were simplified from
+    uint32_t toleranceCm;         // Error bound actually used
+    uint32_t startMs;             // millis() of the first and last vertex
+    uint32_t endMs;
+    int32_t latitudeE7[TRACK_MAX_VERTICES];
+    int32_t longitudeE7[TRACK_MAX_VERTICES];
+};
+
+/**
+ * Encode a segment as a polyline (Google polyline algorithm, 1e-5 degrees:
+ * zigzag deltas in base64-like 5-bit groups)
+ * @param segment vertices to encode
+ * @param buffer destination, TRACK_POLYLINE_MAX bytes always fit
+ * @param size size of buffer
+ * @return string length, or -1 if it does not fit
+ */
+int trackEncodePolyline(const TrackSegment& segment, char* buffer, size_t size);
+
+/**
+ * TrackRecorder Class
+ *
+ * Buffers every GPS solution between two samples and reduces the window
+ * with Douglas-Peucker when the sample is taken: a fix is kept only if
+ * leaving it out would move the route more than TRACK_TOLERANCE_M. If more
+ * than TRACK_MAX_VERTICES vertices remain, the tolerance is doubled until
+ * they fit.
+ *
+ * The last vertex of a segment starts the next window, so consecutive
+ * segments join into one route. A window that never left the tolerance
+ * around its first fix produces no segment and keeps that fix as its start,
+ * so slow drift is still caught once it adds up.
+ */
+class TrackRecorder {
+private:
+    // Fix window (the first fix is the previous segment's last vertex)
+    int32_t fixLat[TRACK_WINDOW_FIXES];
+    int32_t fixLon[TRACK_WINDOW_FIXES];
+    uint32_t fixMs[TRACK_WINDOW_FIXES];
+    uint16_t fixCount;
+    
+    // Douglas-Peucker work area
+    bool keep[TRACK_WINDOW_FIXES];
+    uint16_t rangeFirst[TRACK_WINDOW_FIXES];
+    uint16_t rangeLast[TRACK_WINDOW_FIXES];
+    float latScale;               // cm per E7 along each axis at the window's latitude
+    float lonScale;
+    
+    // Statistics
+    uint32_t fixesRecorded;
+    uint32_t segmentsTaken;
+    uint32_t verticesKept;
+    uint32_t toleranceWidened;
+    
+    uint16_t simplify(uint32_t toleranceCm);
+    float offsetSqCm2(uint16_t point, uint16_t first, uint16_t last);
+
+public:
+    /**
+     * Constructor
+     */
+    TrackRecorder();
+    
+    /**
+     * Add one position fix to the window
+     * @param latE7 latitude in 1e-7 degrees
+     * @param lonE7 longitude in 1e-7 degrees
+     * @param nowMs time of the fix (millis())
+     * @return true if the window is full and a segment should be taken now
+     */
+    bool add(int32_t latE7, int32_t lonE7, uint32_t nowMs);
+    
+    /**
+     * Simplify the window into a segment and start the next window
+     * @param segment destination record (pointCount 0 if there was no movement)
+     */
+    void takeSegment(TrackSegment& segment);
+    
+    /**
+     * Print window and simplification statistics to Serial
+     */
+    void printStatus();
+};
+
+#endif // TRACK_RECORDER_H
@@ -0,0 +1,138 @@
+#include "ubx_protocol.h"
+
+size_t ubxBuildFrame(uint8_t* out, size_t capacity, uint8_t msgClass, uint8_t msgId,
+                     const uint8_t* payload, uint16_t length) {
+    size_t size = (size_t)length + UBX_FRAME_OVERHEAD;
+    if (size > capacity) {
+        return 0;
+    }
+    
+    out[0] = UBX_SYNC_1;
+    out[1] = UBX_SYNC_2;
+    out[2] = msgClass;
+    out[3] = msgId;
+    ubxPutU16(out + 4, length);
+    if (length > 0) {
+        memcpy(out + 6, payload, length);
+    }
+    
+    // Checksum covers class through the end of the payload
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+    for (size_t i = 2; i < size - 2; i++) {
+        ckA += out[i];
+        ckB += ckA;
+    }
+    out[size - 2] = ckA;
+    out[size - 1] = ckB;
+    
+    return size;
+}
+
+UbxParser::UbxParser() {
+    frameCount = 0;
+    checksumErrors = 0;
+    reset();
+}
+
+void UbxParser::reset() {
+    state = SYNC_1;
+    msgClass = 0;
+    msgId = 0;
+    length = 0;
+    index = 0;
+    ckA = 0;
+    ckB = 0;
+}
+
+void UbxParser::accumulate(uint8_t byte) {
+    ckA += byte;
+    ckB += ckA;
+}
+
+bool UbxParser::feed(uint8_t byte) {
+    switch (state) {
+        case SYNC_1:
+            if (byte == UBX_SYNC_1) {
+                state = SYNC_2;
+            }
+            break;
+        case SYNC_2:
+            if (byte == UBX_SYNC_2) {
+                ckA = 0;
+                ckB = 0;
+                state = CLASS;
+            } else {
+                state = byte == UBX_SYNC_1 ? SYNC_2 : SYNC_1;
+            }
+            break;
+        case CLASS:
+            msgClass = byte;
+            accumulate(byte);
+            state = ID;
+            break;
+        case ID:
+            msgId = byte;
+            accumulate(byte);
+            state = LENGTH_1;
+            break;
+        case LENGTH_1:
+            length = byte;
+            accumulate(byte);
+            state = LENGTH_2;
+            break;
+        case LENGTH_2:
+            length |= (uint16_t)byte << 8;
+            accumulate(byte);
+            index = 0;
+            if (length > UBX_MAX_PAYLOAD) {
+                // Not a frame this parser keeps (or a false sync) - hunt again
+                state = SYNC_1;
+            } else {
+                state = length > 0 ? PAYLOAD : CHECKSUM_A;
+            }
+            break;
+        case PAYLOAD:
+            payload[index++] = byte;
+            accumulate(byte);
+            if (index >= length) {
+                state = CHECKSUM_A;
+            }
+            break;
+        case CHECKSUM_A:
+            if (byte == ckA) {
+                state = CHECKSUM_B;
+            } else {
+                checksumErrors++;
+                state = SYNC_1;
+            }
+            break;
+        case CHECKSUM_B:
+            state = SYNC_1;
+            if (byte == ckB) {
+                frameCount++;
+                return true;
+            }
+            checksumErrors++;
+            break;
+    }
+    
+    return false;
+}
+
+bool ubxDecodeNavPvt(const UbxParser& parser, UbxNavPvt& pvt) {
+    if (parser.getClass() != UBX_CLASS_NAV || parser.getId() != UBX_NAV_PVT) {
+        return false;
+    }
+    
+    uint16_t length = parser.getLength();
+    if (length != UBX_NAV_PVT_LEN && length != UBX_NAV_PVT_LEN_V14) {
+        return false;
+    }
+    
+    memcpy(&pvt, parser.getPayload(), length);
+    if (length < sizeof(pvt)) {
+        memset((uint8_t*)&pvt + length, 0, sizeof(pvt) - length);
+    }
+    return true;
+}
@@ -0,0 +1,206 @@
+#ifndef UBX_PROTOCOL_H
+#define UBX_PROTOCOL_H
+
+#include <Arduino.h>
+
+// Frame layout: sync (2), class, id, length (2), payload, checksum (2)
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+#define UBX_FRAME_OVERHEAD 8
+#define UBX_MAX_PAYLOAD 100           // Largest frame the parser keeps; longer ones are skipped
+
+// Message classes and IDs used by this project
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_AID 0x0B
+#define UBX_CLASS_NMEA 0xF0
+
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+#define UBX_CFG_RXM 0x11
+
+#define UBX_AID_INI 0x01
+#define UBX_AID_INI_LEN 48
+
+// AID-INI flag bits
+#define UBX_AID_INI_POS_VALID 0x0001
+#define UBX_AID_INI_TIME_VALID 0x0002
+#define UBX_AID_INI_LLA 0x0020        // Position is lat/lon/alt rather than ECEF
+
+#define UBX_NAV_PVT 0x07
+#define UBX_NAV_PVT_LEN 92            // Protocol 15+ (u-blox M8 and later)
+#define UBX_NAV_PVT_LEN_V14 84        // Protocol 14 (u-blox 7), no headVeh/magDec/magAcc
+
+// NAV-PVT flag bits
+#define UBX_PVT_VALID_DATE 0x01
+#define UBX_PVT_VALID_TIME 0x02
+#define UBX_PVT_GNSS_FIX_OK 0x01
+
+// NAV-PVT fixType values
+#define UBX_FIX_NONE 0
+#define UBX_FIX_DEAD_RECKONING 1
+#define UBX_FIX_2D 2
+#define UBX_FIX_3D 3
+#define UBX_FIX_GNSS_DR 4
+#define UBX_FIX_TIME_ONLY 5
+
+#define UBX_NMEA_GGA 0x00
+#define UBX_NMEA_GLL 0x01
+#define UBX_NMEA_GSA 0x02
+#define UBX_NMEA_GSV 0x03
+#define UBX_NMEA_RMC 0x04
+#define UBX_NMEA_VTG 0x05
+
+/**
+ * Little-endian field access (UBX payloads are little-endian)
+ */
+inline void ubxPutU16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+inline void ubxPutU32(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = value >> 24;
+}
+
+inline uint16_t ubxGetU16(const uint8_t* p) {
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+inline uint32_t ubxGetU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * NAV-PVT payload in its wire layout (little-endian, like the ESP32), so a
+ * verified frame decodes with a single copy and no field conversion
+ */
+struct __attribute__((packed)) UbxNavPvt {
+    uint32_t iTOW;                // GPS time of week of the solution (ms)
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;                // UBX_PVT_VALID_* bits
+    uint32_t tAcc;                // Time accuracy (ns)
+    int32_t nano;                 // Fraction of second (ns)
+    uint8_t fixType;              // UBX_FIX_* value
+    uint8_t flags;                // UBX_PVT_GNSS_FIX_OK bit
+    uint8_t flags2;
+    uint8_t numSV;
+    int32_t lon;                  // 1e-7 deg
+    int32_t lat;                  // 1e-7 deg
+    int32_t height;               // Above ellipsoid (mm)
+    int32_t hMSL;                 // Above mean sea level (mm)
+    uint32_t hAcc;                // Horizontal accuracy (mm)
+    uint32_t vAcc;                // Vertical accuracy (mm)
+    int32_t velN;                 // mm/s
+    int32_t velE;                 // mm/s
+    int32_t velD;                 // mm/s
+    int32_t gSpeed;               // Ground speed (mm/s)
+    int32_t headMot;              // Heading of motion (1e-5 deg)
+    uint32_t sAcc;                // Speed accuracy (mm/s)
+    uint32_t headAcc;             // Heading accuracy (1e-5 deg)
+    uint16_t pDOP;                // 0.01
+    uint8_t flags3;
+    uint8_t reserved1[5];
+    int32_t headVeh;              // Protocol 15+ only
+    int16_t magDec;
+    uint16_t magAcc;
+};
+
+static_assert(sizeof(UbxNavPvt) == UBX_NAV_PVT_LEN, "UbxNavPvt must match the NAV-PVT wire layout");
+
+/**
+ * Build a complete UBX frame (sync, header, payload, checksum)
+ * @param out destination buffer
+ * @param capacity size of out in bytes
+ * @param msgClass message class
+ * @param msgId message ID
+ * @param payload payload bytes (may be nullptr when length is 0)
+ * @param length payload length
+ * @return frame size in bytes, 0 if it does not fit
+ */
+size_t ubxBuildFrame(uint8_t* out, size_t capacity, uint8_t msgClass, uint8_t msgId,
+                     const uint8_t* payload, uint16_t length);
+
+/**
+ * UbxParser Class
+ *
+ * Byte-at-a-time UBX frame decoder. It hunts for the sync pair, so NMEA
+ * text interleaved on the same port is skipped. The 8-bit Fletcher
+ * checksum is accumulated as bytes arrive; a frame is only reported once
+ * it verifies.
+ */
+class UbxParser {
+private:
+    enum State : uint8_t {
+        SYNC_1,
+        SYNC_2,
+        CLASS,
+        ID,
+        LENGTH_1,
+        LENGTH_2,
+        PAYLOAD,
+        CHECKSUM_A,
+        CHECKSUM_B
+    };
+    
+    State state;
+    uint8_t msgClass;
+    uint8_t msgId;
+    uint16_t length;
+    uint16_t index;
+    uint8_t ckA;
+    uint8_t ckB;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+    uint32_t frameCount;
+    uint32_t checksumErrors;
+    
+    void accumulate(uint8_t byte);
+
+public:
+    /**
+     * Constructor
+     */
+    UbxParser();
+    
+    /**
+     * Feed one received byte
+     * @param byte next byte from the receiver
+     * @return true when it completed a frame with a valid checksum
+     */
+    bool feed(uint8_t byte);
+    
+    /**
+     * Discard any partial frame
+     */
+    void reset();
+    
+    uint8_t getClass() const { return msgClass; }
+    uint8_t getId() const { return msgId; }
+    uint16_t getLength() const { return length; }
+    const uint8_t* getPayload() const { return payload; }
+    uint32_t getFrameCount() const { return frameCount; }
+    uint32_t getChecksumErrors() const { return checksumErrors; }
+};
+
+/**
+ * Decode the frame last completed by a parser as NAV-PVT
+ * @param parser parser whose feed() just returned true
+ * @param pvt destination record (fields missing from protocol 14 are zeroed)
+ * @return true if the frame is a NAV-PVT of a known length
+ */
+bool ubxDecodeNavPvt(const UbxParser& parser, UbxNavPvt& pvt);
+
+#endif // UBX_PROTOCOL_H
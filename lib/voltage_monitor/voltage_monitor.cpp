@@ -0,0 +1,289 @@
+#include "voltage_monitor.h"
+#include <driver/adc.h>
+
+#define VOLTAGE_READ_TIMEOUT_MS 100
+
+#if VOLTAGE_MONITOR_ENABLED
+// GPIO behind each ADC1 channel; the input must not also be wired as a digital power input
+static constexpr int8_t adc1ChannelGpio[] = { 36, 37, 38, 39, 32, 33, 34, 35 };
+static constexpr int8_t voltageAdcGpio = adc1ChannelGpio[VOLTAGE_ADC_CHANNEL & 0x7];
+static_assert(voltageAdcGpio != OPTOCOUPLER_PIN, "VOLTAGE_ADC_CHANNEL shares its GPIO with OPTOCOUPLER_PIN");
+
+#if POWER_CHANNELS_ENABLED
+static constexpr int8_t powerChannelPins[] = POWER_CHANNEL_PINS;
+
+static constexpr bool pinListed(const int8_t* pins, size_t count, int8_t pin) {
+    return count > 0 && (pins[0] == pin || pinListed(pins + 1, count - 1, pin));
+}
+
+static_assert(!pinListed(powerChannelPins, sizeof(powerChannelPins), voltageAdcGpio),
+              "VOLTAGE_ADC_CHANNEL shares its GPIO with POWER_CHANNEL_PINS");
+#endif
+#endif
+
+VoltageMonitor::VoltageMonitor() {
+    enabled = false;
+    taskHandle = nullptr;
+    frameFill = 0;
+    dcOffset = 2048;
+    windowSumSq = 0;
+    windowSamples = 0;
+    windowCycles = 0;
+    inSag = false;
+    inSwell = false;
+    eventStartMs = 0;
+    lock = portMUX_INITIALIZER_UNLOCKED;
+    memset(&published, 0, sizeof(published));
+    published.minRmsMv = UINT32_MAX;
+    published.minRaw = UINT16_MAX;
+}
+
+bool VoltageMonitor::begin() {
+    // DMA driver: one interrupt per frame, VOLTAGE_DMA_FRAMES frames of slack for the task
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = sizeof(frame) * VOLTAGE_DMA_FRAMES;
+    init.conv_num_each_intr = sizeof(frame);
+    init.adc1_chan_mask = BIT(VOLTAGE_ADC_CHANNEL);
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) {
+        DEBUG_PRINTLN("❌ VoltageMonitor: ADC DMA initialization failed");
+        return false;
+    }
+    
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = VOLTAGE_ADC_CHANNEL & 0x7;
+    pattern.unit = 0;                     // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = true;
+    config.conv_limit_num = 250;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = VOLTAGE_SAMPLE_RATE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+    if (adc_digi_controller_configure(&config) != ESP_OK) {
+        DEBUG_PRINTLN("❌ VoltageMonitor: ADC DMA configuration failed");
+        adc_digi_deinitialize();
+        return false;
+    }
+    
+    if (xTaskCreatePinnedToCore(taskEntry, "voltage", VOLTAGE_TASK_STACK_SIZE, this,
+                                VOLTAGE_TASK_PRIORITY, &taskHandle, SENSOR_TASK_CORE) != pdPASS) {
+        DEBUG_PRINTLN("❌ VoltageMonitor: Failed to create acquisition task");
+        adc_digi_deinitialize();
+        return false;
+    }
+    
+    adc_digi_start();
+    enabled = true;
+    
+    DEBUG_PRINTF("⚡ VoltageMonitor started (%d Hz, %d samples/frame)\n",
+                 VOLTAGE_SAMPLE_RATE_HZ, VOLTAGE_FRAME_SAMPLES);
+    
+    return true;
+}
+
+void VoltageMonitor::taskEntry(void* param) {
+    static_cast<VoltageMonitor*>(param)->taskLoop();
+}
+
+void VoltageMonitor::taskLoop() {
+    for (;;) {
+        uint32_t length = 0;
+        esp_err_t result = adc_digi_read_bytes(frame + frameFill, sizeof(frame) - frameFill,
+                                               &length, VOLTAGE_READ_TIMEOUT_MS);
+        
+        if (result == ESP_ERR_INVALID_STATE) {
+            // The driver dropped data - the partial frame no longer spans one cycle
+            portENTER_CRITICAL(&lock);
+            published.overruns++;
+            portEXIT_CRITICAL(&lock);
+            frameFill = 0;
+            continue;
+        }
+        if (result != ESP_OK) {
+            continue;
+        }
+        
+        frameFill += length;
+        if (frameFill >= sizeof(frame)) {
+            processFrame(frame, frameFill);
+            frameFill = 0;
+        }
+    }
+}
+
+uint32_t VoltageMonitor::isqrt64(uint64_t value) {
+    // Bitwise integer square root (floor)
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+
+void VoltageMonitor::processFrame(const uint8_t* data, uint32_t length) {
+    const adc_digi_output_data_t* samples = (const adc_digi_output_data_t*)data;
+    uint32_t count = length / sizeof(adc_digi_output_data_t);
+    
+    // Block kernel: integer sum, sum of squares, min and max around the DC offset
+    int32_t sum = 0;
+    uint64_t sumSq = 0;
+    uint16_t minRaw = UINT16_MAX;
+    uint16_t maxRaw = 0;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (samples[i].type1.channel != (VOLTAGE_ADC_CHANNEL & 0x7)) {
+            continue;
+        }
+        uint16_t code = samples[i].type1.data;
+        if (code < minRaw) {
+            minRaw = code;
+        }
+        if (code > maxRaw) {
+            maxRaw = code;
+        }
+        int32_t centred = (int32_t)code - dcOffset;
+        sum += centred;
+        sumSq += (uint32_t)(centred * centred);
+        n++;
+    }
+    
+    if (n == 0) {
+        return;
+    }
+    
+    // Variance about the frame mean in Q16 counts^2, RMS in Q8 counts
+    int64_t meanQ8 = ((int64_t)sum << 8) / n;
+    int64_t varianceQ16 = (int64_t)((sumSq << 16) / n) - meanQ8 * meanQ8;
+    if (varianceQ16 < 0) {
+        varianceQ16 = 0;
+    }
+    uint32_t cycleRmsMv = (uint32_t)(((uint64_t)isqrt64(varianceQ16) * VOLTAGE_CAL_MV_PER_COUNT) >> 8);
+    
+    // A frame spans whole cycles, so its mean is the DC offset
+    dcOffset += (int32_t)((meanQ8 + 128) >> 8);
+    
+    // Window RMS over VOLTAGE_WINDOW_CYCLES cycles
+    windowSumSq += (uint64_t)varianceQ16 * n;
+    windowSamples += n;
+    windowCycles++;
+    uint32_t windowRmsMv = 0;
+    if (windowCycles >= VOLTAGE_WINDOW_CYCLES) {
+        windowRmsMv = (uint32_t)(((uint64_t)isqrt64(windowSumSq / windowSamples) * VOLTAGE_CAL_MV_PER_COUNT) >> 8);
+        windowSumSq = 0;
+        windowSamples = 0;
+        windowCycles = 0;
+    }
+    
+    uint32_t now = millis();
+    portENTER_CRITICAL(&lock);
+    if (windowRmsMv > 0) {
+        published.rmsMv = windowRmsMv;
+    }
+    if (cycleRmsMv < published.minRmsMv) {
+        published.minRmsMv = cycleRmsMv;
+    }
+    if (cycleRmsMv > published.maxRmsMv) {
+        published.maxRmsMv = cycleRmsMv;
+    }
+    if (minRaw < published.minRaw) {
+        published.minRaw = minRaw;
+    }
+    if (maxRaw > published.maxRaw) {
+        published.maxRaw = maxRaw;
+    }
+    updateEvents(cycleRmsMv, now);
+    portEXIT_CRITICAL(&lock);
+}
+
+void VoltageMonitor::updateEvents(uint32_t cycleRmsMv, uint32_t now) {
+    const uint32_t sagMv = (uint32_t)((uint64_t)VOLTAGE_NOMINAL_MV * VOLTAGE_SAG_PERCENT / 100);
+    const uint32_t swellMv = (uint32_t)((uint64_t)VOLTAGE_NOMINAL_MV * VOLTAGE_SWELL_PERCENT / 100);
+    const uint32_t hysteresisMv = (uint32_t)((uint64_t)VOLTAGE_NOMINAL_MV * VOLTAGE_HYSTERESIS_PERCENT / 100);
+    
+    // Events are counted when they start and timed when the voltage is back in band
+    if (inSag) {
+        if (cycleRmsMv > sagMv + hysteresisMv) {
+            inSag = false;
+            published.lastEventMs = now - eventStartMs;
+        }
+    } else if (cycleRmsMv < sagMv) {
+        inSag = true;
+        eventStartMs = now;
+        published.sagCount++;
+    }
+    
+    if (inSwell) {
+        if (cycleRmsMv < swellMv - hysteresisMv) {
+            inSwell = false;
+            published.lastEventMs = now - eventStartMs;
+        }
+    } else if (cycleRmsMv > swellMv) {
+        inSwell = true;
+        eventStartMs = now;
+        published.swellCount++;
+    }
+}
+
+void VoltageMonitor::getSnapshot(VoltageSnapshot& snapshot) {
+    portENTER_CRITICAL(&lock);
+    snapshot = published;
+    published.minRmsMv = UINT32_MAX;
+    published.maxRmsMv = 0;
+    published.minRaw = UINT16_MAX;
+    published.maxRaw = 0;
+    portEXIT_CRITICAL(&lock);
+    
+    // No complete cycle since the previous snapshot
+    if (snapshot.minRmsMv == UINT32_MAX) {
+        snapshot.minRmsMv = 0;
+        snapshot.minRaw = 0;
+    }
+    snapshot.enabled = enabled;
+}
+
+void VoltageMonitor::printStatus() {
+    if (!enabled) {
+        Serial.println("Voltage Monitor: disabled");
+        return;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    VoltageSnapshot current = published;
+    portEXIT_CRITICAL(&lock);
+    
+    Serial.printf("Line Voltage: %.1f V RMS (%d-cycle window)\n", current.rmsMv / 1000.0, VOLTAGE_WINDOW_CYCLES);
+    if (current.minRmsMv != UINT32_MAX) {
+        Serial.printf("Cycle RMS Range: %.1f - %.1f V, ADC %u - %u\n",
+                     current.minRmsMv / 1000.0, current.maxRmsMv / 1000.0,
+                     current.minRaw, current.maxRaw);
+    }
+    Serial.printf("Sags: %lu | Swells: %lu | Last Event: %lu ms%s\n",
+                 (unsigned long)current.sagCount, (unsigned long)current.swellCount,
+                 (unsigned long)current.lastEventMs,
+                 inSag ? " | SAG IN PROGRESS" : (inSwell ? " | SWELL IN PROGRESS" : ""));
+    Serial.printf("DMA Overruns: %lu\n", (unsigned long)current.overruns);
+}
+
+void VoltageMonitor::resetStatistics() {
+    portENTER_CRITICAL(&lock);
+    published.sagCount = 0;
+    published.swellCount = 0;
+    published.lastEventMs = 0;
+    published.overruns = 0;
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,95 @@
+#ifndef VOLTAGE_MONITOR_H
+#define VOLTAGE_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// One DMA frame holds one nominal mains cycle
+#define VOLTAGE_FRAME_SAMPLES (VOLTAGE_SAMPLE_RATE_HZ / MAINS_NOMINAL_HZ)
+
+/**
+ * Fixed-size copy of the voltage aggregates, safe to hand to another task
+ */
+struct VoltageSnapshot {
+    bool enabled;
+    uint32_t rmsMv;               // Line RMS over the last VOLTAGE_WINDOW_CYCLES cycles
+    uint32_t minRmsMv;            // Lowest single-cycle RMS since the previous snapshot
+    uint32_t maxRmsMv;            // Highest single-cycle RMS since the previous snapshot
+    uint16_t minRaw;              // Lowest ADC code since the previous snapshot
+    uint16_t maxRaw;              // Highest ADC code since the previous snapshot
+    uint32_t sagCount;
+    uint32_t swellCount;
+    uint32_t lastEventMs;         // Duration of the last completed sag or swell
+    uint32_t overruns;            // Frames lost because the task fell behind the DMA
+};
+
+/**
+ * VoltageMonitor Class
+ *
+ * Continuous line-voltage acquisition. The ADC runs in DMA (digital
+ * controller) mode at VOLTAGE_SAMPLE_RATE_HZ; the driver fills its DMA
+ * buffers in the background and a dedicated task consumes them one frame
+ * (one mains cycle) at a time, so sampling never involves the sensor loop.
+ *
+ * Each frame goes through an integer block kernel: samples are centred on
+ * the running DC offset, then sum, sum of squares, min and max are
+ * accumulated. Cycle RMS drives sag/swell detection against
+ * VOLTAGE_NOMINAL_MV; cycles are also combined into a
+ * VOLTAGE_WINDOW_CYCLES window RMS. Only these aggregates leave the task.
+ */
+class VoltageMonitor {
+private:
+    bool enabled;
+    TaskHandle_t taskHandle;
+    uint8_t frame[VOLTAGE_FRAME_SAMPLES * 2];
+    uint32_t frameFill;
+    
+    // Kernel state (acquisition task only)
+    int32_t dcOffset;             // ADC code of the waveform midpoint
+    uint64_t windowSumSq;         // Sum of squares over the window (Q16 counts^2)
+    uint32_t windowSamples;
+    uint8_t windowCycles;
+    bool inSag;
+    bool inSwell;
+    uint32_t eventStartMs;
+    
+    // Published aggregates (guarded by lock)
+    portMUX_TYPE lock;
+    VoltageSnapshot published;
+    
+    static void taskEntry(void* param);
+    void taskLoop();
+    void processFrame(const uint8_t* data, uint32_t length);
+    void updateEvents(uint32_t cycleRmsMv, uint32_t now);  // Called with lock held
+    static uint32_t isqrt64(uint64_t value);
+
+public:
+    /**
+     * Constructor
+     */
+    VoltageMonitor();
+    
+    /**
+     * Start DMA sampling and the acquisition task
+     * @return true if the ADC and task were started
+     */
+    bool begin();
+    
+    /**
+     * Copy the aggregates into a snapshot record and restart the min/max tracking
+     * @param snapshot destination record
+     */
+    void getSnapshot(VoltageSnapshot& snapshot);
+    
+    /**
+     * Print voltage aggregates to Serial
+     */
+    void printStatus();
+    
+    /**
+     * Reset event counters
+     */
+    void resetStatistics();
+};
+
+#endif // VOLTAGE_MONITOR_H
@@ -0,0 +1,417 @@
+#include "wifi_fingerprint.h"
+#include "gps_fixed.h"
+#include <esp_rom_crc.h>
+
+#define WIFI_FP_MAGIC 0x57465031      // "WFP1"
+
+static_assert(WIFI_FP_MAX_RECORDS <= 65535, "Slot numbers are 16 bit");
+static_assert(WIFI_FP_K <= WIFI_FP_CANDIDATES, "Neighbours come from the candidates");
+
+WiFiFingerprintDb::WiFiFingerprintDb() {
+    ready = false;
+    memset(index, 0, sizeof(index));
+    recordCount = 0;
+    nextSequence = 1;
+    lastLearnCycle = 0;
+    lastLearnMs = 0;
+    learned = 0;
+    refreshed = 0;
+    lookups = 0;
+    hits = 0;
+    lastLookupUs = 0;
+}
+
+bool WiFiFingerprintDb::begin() {
+    const size_t fileSize = sizeof(WiFiFingerprintRecord) * WIFI_FP_MAX_RECORDS;
+    File file = LittleFS.open(WIFI_FP_FILE, "r");
+    
+    if (file && file.size() == fileSize) {
+        WiFiFingerprintRecord record;
+        for (uint16_t slot = 0; slot < WIFI_FP_MAX_RECORDS; slot++) {
+            if (readSlot(file, slot, record)) {
+                indexSlot(slot, record);
+                recordCount++;
+                if (record.sequence >= nextSequence) {
+                    nextSequence = record.sequence + 1;
+                }
+            }
+        }
+        file.close();
+    } else {
+        // First use, or the record layout changed - start with empty slots
+        if (file) {
+            file.close();
+        }
+        file = LittleFS.open(WIFI_FP_FILE, "w");
+        if (!file) {
+            DEBUG_PRINTLN("❌ WiFiFingerprintDb: Cannot create " WIFI_FP_FILE);
+            return false;
+        }
+        WiFiFingerprintRecord empty;
+        memset(&empty, 0, sizeof(empty));
+        for (uint16_t slot = 0; slot < WIFI_FP_MAX_RECORDS; slot++) {
+            if (file.write((const uint8_t*)&empty, sizeof(empty)) != sizeof(empty)) {
+                DEBUG_PRINTLN("❌ WiFiFingerprintDb: Flash full");
+                file.close();
+                return false;
+            }
+        }
+        file.close();
+    }
+    
+    ready = true;
+    DEBUG_PRINTF("📶 WiFi fingerprints: %u of %d slots used\n", recordCount, WIFI_FP_MAX_RECORDS);
+    return true;
+}
+
+uint16_t WiFiFingerprintDb::hashBssid(uint64_t bssid) {
+    return (uint16_t)(bssid ^ (bssid >> 16) ^ (bssid >> 32));
+}
+
+uint64_t WiFiFingerprintDb::unpackBssid(const uint8_t* bytes) {
+    uint64_t bssid = 0;
+    for (int b = 0; b < 6; b++) {
+        bssid = (bssid << 8) | bytes[b];
+    }
+    return bssid;
+}
+
+bool WiFiFingerprintDb::readScan(const WiFiScanTable& table, Scan& scan) {
+    // Strongest access points of the latest cycle first (insertion into a
+    // short sorted list); entries kept until expiry carry an old position's RSSI
+    scan.apCount = 0;
+    for (int i = 0; i < table.size(); i++) {
+        const WiFiNetworkEntry& entry = table.getEntry(i);
+        if (!(entry.flags & WIFI_ENTRY_SEEN)) {
+            continue;
+        }
+        int position = scan.apCount;
+        while (position > 0 && scan.rssi[position - 1] < entry.rssi) {
+            position--;
+        }
+        if (position >= WIFI_FP_APS) {
+            continue;
+        }
+        int last = scan.apCount < WIFI_FP_APS ? scan.apCount : WIFI_FP_APS - 1;
+        for (int j = last; j > position; j--) {
+            scan.bssid[j] = scan.bssid[j - 1];
+            scan.rssi[j] = scan.rssi[j - 1];
+        }
+        scan.bssid[position] = entry.bssid;
+        scan.rssi[position] = entry.rssi;
+        if (scan.apCount < WIFI_FP_APS) {
+            scan.apCount++;
+        }
+    }
+    
+    for (uint8_t i = 0; i < scan.apCount; i++) {
+        scan.hash[i] = hashBssid(scan.bssid[i]);
+    }
+    return scan.apCount >= WIFI_FP_MIN_APS;
+}
+
+bool WiFiFingerprintDb::readSlot(File& file, uint16_t slot, WiFiFingerprintRecord& record) {
+    if (!file.seek((uint32_t)slot * sizeof(record)) ||
+        file.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+        return false;
+    }
+    return record.magic == WIFI_FP_MAGIC && record.apCount > 0 && record.apCount <= WIFI_FP_APS &&
+           record.crc == esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(WiFiFingerprintRecord, crc));
+}
+
+bool WiFiFingerprintDb::writeSlot(uint16_t slot, WiFiFingerprintRecord& record) {
+    record.magic = WIFI_FP_MAGIC;
+    record.crc = esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(WiFiFingerprintRecord, crc));
+    
+    File file = LittleFS.open(WIFI_FP_FILE, "r+");
+    if (!file) {
+        return false;
+    }
+    bool written = file.seek((uint32_t)slot * sizeof(record)) &&
+                   file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    file.close();
+    return written;
+}
+
+void WiFiFingerprintDb::indexSlot(uint16_t slot, const WiFiFingerprintRecord& record) {
+    IndexEntry& entry = index[slot];
+    entry.latitudeE7 = record.latitudeE7;
+    entry.longitudeE7 = record.longitudeE7;
+    entry.sequence = record.sequence;
+    entry.apCount = record.apCount;
+    for (uint8_t i = 0; i < record.apCount; i++) {
+        entry.hash[i] = hashBssid(unpackBssid(record.bssid[i]));
+    }
+}
+
+uint16_t WiFiFingerprintDb::chooseSlot(int32_t latE7, int32_t lonE7, bool& refresh) {
+    // The nearest fingerprint within the spacing, else an empty or the least recently written slot
+    const uint64_t spacingCm = WIFI_FP_SPACING_M * 100ULL;
+    uint64_t nearestSq = spacingCm * spacingCm;
+    uint16_t nearest = WIFI_FP_MAX_RECORDS;
+    uint16_t oldest = 0;
+    for (uint16_t slot = 0; slot < WIFI_FP_MAX_RECORDS; slot++) {
+        const IndexEntry& entry = index[slot];
+        if (entry.apCount == 0) {
+            if (index[oldest].apCount != 0) {
+                oldest = slot;
+            }
+            continue;
+        }
+        if (index[oldest].apCount != 0 && entry.sequence < index[oldest].sequence) {
+            oldest = slot;
+        }
+        uint64_t distanceSq = gpsDistanceSqCm2(entry.latitudeE7, entry.longitudeE7, latE7, lonE7);
+        if (distanceSq < nearestSq) {
+            nearestSq = distanceSq;
+            nearest = slot;
+        }
+    }
+    
+    refresh = nearest < WIFI_FP_MAX_RECORDS;
+    return refresh ? nearest : oldest;
+}
+
+bool WiFiFingerprintDb::learn(const WiFiScanTable& table, int32_t latE7, int32_t lonE7, uint32_t nowMs) {
+    if (!ready || table.getCycleCount() == lastLearnCycle) {
+        return false;
+    }
+    if (learned + refreshed > 0 && nowMs - lastLearnMs < WIFI_FP_LEARN_INTERVAL_MS) {
+        return false;
+    }
+    
+    Scan scan;
+    lastLearnCycle = table.getCycleCount();
+    if (!readScan(table, scan)) {
+        return false;
+    }
+    
+    bool refresh;
+    uint16_t slot = chooseSlot(latE7, lonE7, refresh);
+    
+    // Near an existing fingerprint: only refresh it from (almost) the same
+    // spot, and keep its position - moving it would let slots creep along a route
+    const uint64_t refreshCm = WIFI_FP_SPACING_M * 20ULL;
+    if (refresh) {
+        const IndexEntry& entry = index[slot];
+        if (gpsDistanceSqCm2(entry.latitudeE7, entry.longitudeE7, latE7, lonE7) > refreshCm * refreshCm) {
+            return false;
+        }
+        latE7 = entry.latitudeE7;
+        lonE7 = entry.longitudeE7;
+    }
+    
+    WiFiFingerprintRecord record;
+    memset(&record, 0, sizeof(record));
+    record.sequence = nextSequence++;
+    record.latitudeE7 = latE7;
+    record.longitudeE7 = lonE7;
+    record.apCount = scan.apCount;
+    for (uint8_t i = 0; i < scan.apCount; i++) {
+        record.rssi[i] = scan.rssi[i];
+        for (int b = 0; b < 6; b++) {
+            record.bssid[i][b] = (uint8_t)(scan.bssid[i] >> (40 - 8 * b));
+        }
+    }
+    
+    if (!writeSlot(slot, record)) {
+        DEBUG_PRINTLN("⚠️  WiFiFingerprintDb: Slot write failed");
+        return false;
+    }
+    
+    if (index[slot].apCount == 0) {
+        recordCount++;
+    }
+    indexSlot(slot, record);
+    lastLearnMs = nowMs;
+    if (refresh) {
+        refreshed++;
+    } else {
+        learned++;
+    }
+    return true;
+}
+
+float WiFiFingerprintDb::signalDistance(const Scan& scan, const WiFiFingerprintRecord& record) {
+    // RMS RSSI difference over the union; an access point one side did not
+    // see counts as WIFI_FP_MISSING_RSSI there
+    float sumSq = 0.0f;
+    uint8_t terms = 0;
+    uint8_t shared = 0;
+    bool matched[WIFI_FP_APS] = {};
+    
+    for (uint8_t i = 0; i < scan.apCount; i++) {
+        int other = WIFI_FP_MISSING_RSSI;
+        for (uint8_t j = 0; j < record.apCount; j++) {
+            if (!matched[j] && unpackBssid(record.bssid[j]) == scan.bssid[i]) {
+                matched[j] = true;
+                other = record.rssi[j];
+                shared++;
+                break;
+            }
+        }
+        float diff = (float)(scan.rssi[i] - other);
+        sumSq += diff * diff;
+        terms++;
+    }
+    for (uint8_t j = 0; j < record.apCount; j++) {
+        if (!matched[j]) {
+            float diff = (float)(record.rssi[j] - WIFI_FP_MISSING_RSSI);
+            sumSq += diff * diff;
+            terms++;
+        }
+    }
+    
+    // A hash collision is not a shared access point
+    if (shared < WIFI_FP_MIN_COMMON) {
+        return -1.0f;
+    }
+    return sqrtf(sumSq / terms);
+}
+
+bool WiFiFingerprintDb::estimate(const WiFiScanTable& table, WiFiLocation& location) {
+    memset(&location, 0, sizeof(location));
+    if (!ready || recordCount == 0) {
+        return false;
+    }
+    
+    uint32_t start = micros();
+    lookups++;
+    
+    Scan scan;
+    if (!readScan(table, scan)) {
+        return false;
+    }
+    
+    // Candidates from the RAM index: most shared BSSID hashes first
+    uint16_t candidates[WIFI_FP_CANDIDATES];
+    uint8_t candidateShared[WIFI_FP_CANDIDATES];
+    uint8_t candidateCount = 0;
+    for (uint16_t slot = 0; slot < WIFI_FP_MAX_RECORDS; slot++) {
+        const IndexEntry& entry = index[slot];
+        uint8_t shared = 0;
+        for (uint8_t i = 0; i < entry.apCount; i++) {
+            for (uint8_t j = 0; j < scan.apCount; j++) {
+                if (entry.hash[i] == scan.hash[j]) {
+                    shared++;
+                    break;
+                }
+            }
+        }
+        if (shared < WIFI_FP_MIN_COMMON) {
+            continue;
+        }
+        int position = candidateCount;
+        while (position > 0 && candidateShared[position - 1] < shared) {
+            position--;
+        }
+        if (position >= WIFI_FP_CANDIDATES) {
+            continue;
+        }
+        int last = candidateCount < WIFI_FP_CANDIDATES ? candidateCount : WIFI_FP_CANDIDATES - 1;
+        for (int j = last; j > position; j--) {
+            candidates[j] = candidates[j - 1];
+            candidateShared[j] = candidateShared[j - 1];
+        }
+        candidates[position] = slot;
+        candidateShared[position] = shared;
+        if (candidateCount < WIFI_FP_CANDIDATES) {
+            candidateCount++;
+        }
+    }
+    if (candidateCount == 0) {
+        return false;
+    }
+    
+    // The WIFI_FP_K nearest in signal space, read back from flash
+    File file = LittleFS.open(WIFI_FP_FILE, "r");
+    if (!file) {
+        return false;
+    }
+    float nearestDistance[WIFI_FP_K];
+    int32_t nearestLat[WIFI_FP_K];
+    int32_t nearestLon[WIFI_FP_K];
+    uint8_t nearestCount = 0;
+    WiFiFingerprintRecord record;
+    for (uint8_t c = 0; c < candidateCount; c++) {
+        if (!readSlot(file, candidates[c], record)) {
+            continue;
+        }
+        float distance = signalDistance(scan, record);
+        if (distance < 0.0f) {
+            continue;
+        }
+        int position = nearestCount;
+        while (position > 0 && nearestDistance[position - 1] > distance) {
+            position--;
+        }
+        if (position >= WIFI_FP_K) {
+            continue;
+        }
+        int last = nearestCount < WIFI_FP_K ? nearestCount : WIFI_FP_K - 1;
+        for (int j = last; j > position; j--) {
+            nearestDistance[j] = nearestDistance[j - 1];
+            nearestLat[j] = nearestLat[j - 1];
+            nearestLon[j] = nearestLon[j - 1];
+        }
+        nearestDistance[position] = distance;
+        nearestLat[position] = record.latitudeE7;
+        nearestLon[position] = record.longitudeE7;
+        if (nearestCount < WIFI_FP_K) {
+            nearestCount++;
+        }
+    }
+    file.close();
+    if (nearestCount == 0) {
+        return false;
+    }
+    
+    // Inverse signal distance weights (1 dB keeps an exact match finite);
+    // offsets from the best neighbour keep the sums small
+    float weightSum = 0.0f;
+    float latOffset = 0.0f;
+    float lonOffset = 0.0f;
+    for (uint8_t i = 0; i < nearestCount; i++) {
+        float weight = 1.0f / (nearestDistance[i] + 1.0f);
+        weightSum += weight;
+        latOffset += weight * (float)(nearestLat[i] - nearestLat[0]);
+        lonOffset += weight * (float)(nearestLon[i] - nearestLon[0]);
+    }
+    location.latitudeE7 = nearestLat[0] + (int32_t)lroundf(latOffset / weightSum);
+    location.longitudeE7 = nearestLon[0] + (int32_t)lroundf(lonOffset / weightSum);
+    
+    // Accuracy: weighted RMS spread of the neighbours, at least the learn spacing
+    float spreadSq = 0.0f;
+    for (uint8_t i = 0; i < nearestCount; i++) {
+        float weight = 1.0f / (nearestDistance[i] + 1.0f);
+        spreadSq += weight * (float)gpsDistanceSqCm2(location.latitudeE7, location.longitudeE7,
+                                                     nearestLat[i], nearestLon[i]);
+    }
+    float accuracyM = sqrtf(spreadSq / weightSum) / 100.0f;
+    if (accuracyM < WIFI_FP_SPACING_M) {
+        accuracyM = WIFI_FP_SPACING_M;
+    }
+    location.accuracyM = accuracyM < 65535.0f ? (uint16_t)accuracyM : 65535;
+    location.neighbours = nearestCount;
+    location.valid = true;
+    
+    hits++;
+    lastLookupUs = micros() - start;
+    return true;
+}
+
+int WiFiFingerprintDb::size() const {
+    return recordCount;
+}
+
+void WiFiFingerprintDb::printStatus() {
+    if (!ready) {
+        Serial.println("WiFi Fingerprints: unavailable");
+        return;
+    }
+    
+    Serial.printf("WiFi Fingerprints: %u/%d slots, %lu learned, %lu refreshed\n",
+                 recordCount, WIFI_FP_MAX_RECORDS, (unsigned long)learned, (unsigned long)refreshed);
+    Serial.printf("Fingerprint Lookups: %lu, %lu located, last %lu us\n",
+                 (unsigned long)lookups, (unsigned long)hits, (unsigned long)lastLookupUs);
+}
@@ -0,0 +1,137 @@
+#ifndef WIFI_FINGERPRINT_H
+#define WIFI_FINGERPRINT_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "config.h"
+#include "wifi_scan_table.h"
+
+/**
+ * Position estimated from WiFi fingerprints, fixed-size so it can travel in a sample
+ */
+struct WiFiLocation {
+    bool valid;
+    uint8_t neighbours;           // Fingerprints combined into the estimate
+    uint16_t accuracyM;           // Spread of the neighbours around the estimate
+    int32_t latitudeE7;
+    int32_t longitudeE7;
+};
+
+/**
+ * One fingerprint slot in WIFI_FP_FILE
+ */
+struct WiFiFingerprintRecord {
+    uint32_t magic;
+    uint32_t sequence;            // Learn order, restores the ring position at boot
+    int32_t latitudeE7;
+    int32_t longitudeE7;
+    uint8_t apCount;
+    int8_t rssi[WIFI_FP_APS];
+    uint8_t bssid[WIFI_FP_APS][6];
+    uint32_t crc;
+};
+
+/**
+ * WiFiFingerprintDb Class
+ *
+ * Learns (strongest access points, RSSI) -> position while GPS has a good
+ * fix and estimates the position from the current scan table when it has
+ * none.
+ *
+ * Fingerprints live in WIFI_FP_MAX_RECORDS fixed slots of one LittleFS file,
+ * at least WIFI_FP_SPACING_M apart. A scan from within a fifth of the
+ * spacing of an existing fingerprint refreshes its access points in place,
+ * so a unit that stays put keeps one slot current; a new position takes an
+ * empty or the least recently written slot. RAM only holds an
+ * index of the position, write order and 16-bit BSSID hashes of each slot.
+ *
+ * A lookup scores every slot by shared hashes, reads the best
+ * WIFI_FP_CANDIDATES from flash, ranks them by RMS RSSI difference over the
+ * union of their access points and averages the WIFI_FP_K nearest, weighted
+ * by inverse signal distance.
+ */
+class WiFiFingerprintDb {
+private:
+    struct IndexEntry {
+        int32_t latitudeE7;
+        int32_t longitudeE7;
+        uint32_t sequence;
+        uint8_t apCount;            // 0 = empty slot
+        uint16_t hash[WIFI_FP_APS];
+    };
+    
+    struct Scan {
+        uint8_t apCount;
+        uint64_t bssid[WIFI_FP_APS];
+        int8_t rssi[WIFI_FP_APS];
+        uint16_t hash[WIFI_FP_APS];
+    };
+    
+    bool ready;
+    IndexEntry index[WIFI_FP_MAX_RECORDS];
+    uint16_t recordCount;
+    uint32_t nextSequence;
+    uint32_t lastLearnCycle;
+    uint32_t lastLearnMs;
+    
+    // Statistics
+    uint32_t learned;
+    uint32_t refreshed;
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t lastLookupUs;
+    
+    static uint16_t hashBssid(uint64_t bssid);
+    static uint64_t unpackBssid(const uint8_t* bytes);
+    static bool readScan(const WiFiScanTable& table, Scan& scan);
+    bool readSlot(File& file, uint16_t slot, WiFiFingerprintRecord& record);
+    bool writeSlot(uint16_t slot, WiFiFingerprintRecord& record);
+    uint16_t chooseSlot(int32_t latE7, int32_t lonE7, bool& refresh);
+    void indexSlot(uint16_t slot, const WiFiFingerprintRecord& record);
+    float signalDistance(const Scan& scan, const WiFiFingerprintRecord& record);
+
+public:
+    /**
+     * Constructor
+     */
+    WiFiFingerprintDb();
+    
+    /**
+     * Open (or create) WIFI_FP_FILE and build the RAM index
+     * (LittleFS must be mounted)
+     * @return true if the database is usable
+     */
+    bool begin();
+    
+    /**
+     * Learn the current scan at a GPS position (rate limited; at most once
+     * per scan cycle and WIFI_FP_LEARN_INTERVAL_MS)
+     * @param table scan table with the access points seen here
+     * @param latE7 latitude in 1e-7 degrees
+     * @param lonE7 longitude in 1e-7 degrees
+     * @param nowMs current millis()
+     * @return true if a fingerprint was written
+     */
+    bool learn(const WiFiScanTable& table, int32_t latE7, int32_t lonE7, uint32_t nowMs);
+    
+    /**
+     * Estimate the position from the current scan
+     * @param table scan table with the access points seen here
+     * @param location destination (valid false if nothing matched)
+     * @return true if a position was estimated
+     */
+    bool estimate(const WiFiScanTable& table, WiFiLocation& location);
+    
+    /**
+     * Get number of stored fingerprints
+     * @return fingerprint count
+     */
+    int size() const;
+    
+    /**
+     * Print database and lookup statistics to Serial
+     */
+    void printStatus();
+};
+
+#endif // WIFI_FINGERPRINT_H
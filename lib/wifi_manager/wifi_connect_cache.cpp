@@ -0,0 +1,104 @@
+#include "wifi_connect_cache.h"
+#include <Preferences.h>
+
+#define WIFI_CACHE_MAGIC 0x57464331  // "WFC1"
+#define WIFI_CACHE_NAMESPACE "wifi_cache"
+#define WIFI_CACHE_KEY "record"
+
+// Not initialized at boot, so it survives every reset except power-on
+static RTC_NOINIT_ATTR WiFiConnectRecord rtcRecord;
+
+WiFiConnectCache::WiFiConnectCache() {
+    memset(&nvsRecord, 0, sizeof(nvsRecord));
+    nvsLoaded = false;
+}
+
+uint32_t WiFiConnectCache::computeChecksum(const WiFiConnectRecord& record) {
+    // FNV-1a over everything except the checksum itself
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(WiFiConnectRecord, checksum); i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t WiFiConnectCache::hashSSID(const char* ssid) {
+    uint32_t hash = 2166136261u;
+    while (*ssid) {
+        hash = (hash ^ (uint8_t)*ssid++) * 16777619u;
+    }
+    return hash;
+}
+
+bool WiFiConnectCache::isValid(const WiFiConnectRecord& record) {
+    return record.magic == WIFI_CACHE_MAGIC &&
+           record.ssidHash == hashSSID(WIFI_SSID) &&
+           record.checksum == computeChecksum(record) &&
+           record.channel > 0 && record.localIP != 0;
+}
+
+bool WiFiConnectCache::load(WiFiConnectRecord& record) {
+    if (isValid(rtcRecord)) {
+        record = rtcRecord;
+        return true;
+    }
+    
+    if (!nvsLoaded) {
+        Preferences prefs;
+        if (prefs.begin(WIFI_CACHE_NAMESPACE, true)) {
+            if (prefs.getBytesLength(WIFI_CACHE_KEY) == sizeof(nvsRecord)) {
+                prefs.getBytes(WIFI_CACHE_KEY, &nvsRecord, sizeof(nvsRecord));
+            }
+            prefs.end();
+        }
+        nvsLoaded = true;
+    }
+    
+    if (isValid(nvsRecord)) {
+        record = nvsRecord;
+        rtcRecord = nvsRecord;
+        return true;
+    }
+    
+    return false;
+}
+
+void WiFiConnectCache::store(WiFiConnectRecord& record) {
+    record.magic = WIFI_CACHE_MAGIC;
+    record.ssidHash = hashSSID(WIFI_SSID);
+    record.reserved = 0;
+    record.checksum = computeChecksum(record);
+    
+    rtcRecord = record;
+    
+    // Avoid flash wear - only touch NVS when something changed
+    if (nvsLoaded && memcmp(&nvsRecord, &record, sizeof(record)) == 0) {
+        return;
+    }
+    
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NAMESPACE, false)) {
+        prefs.putBytes(WIFI_CACHE_KEY, &record, sizeof(record));
+        prefs.end();
+        nvsRecord = record;
+        nvsLoaded = true;
+        DEBUG_PRINTLN("💾 WiFi connect cache saved");
+    }
+}
+
+void WiFiConnectCache::invalidate() {
+    memset(&rtcRecord, 0, sizeof(rtcRecord));
+    
+    if (nvsLoaded && nvsRecord.magic == 0) {
+        return;
+    }
+    
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NAMESPACE, false)) {
+        prefs.remove(WIFI_CACHE_KEY);
+        prefs.end();
+    }
+    memset(&nvsRecord, 0, sizeof(nvsRecord));
+    nvsLoaded = true;
+}
@@ -0,0 +1,65 @@
+#ifndef WIFI_CONNECT_CACHE_H
+#define WIFI_CONNECT_CACHE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Parameters of the last successful WiFi connection
+ */
+struct WiFiConnectRecord {
+    uint32_t magic;
+    uint32_t ssidHash;       // Record is ignored if WIFI_SSID changes
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t localIP;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns1;
+    uint32_t dns2;
+    uint32_t checksum;
+};
+
+/**
+ * WiFiConnectCache Class
+ * 
+ * Keeps the last good BSSID, channel and IP configuration in RTC memory (survives
+ * soft resets, watchdog and brownout resets) and in NVS (survives power loss).
+ * RTC memory is preferred on load; NVS is only written when the record changes.
+ */
+class WiFiConnectCache {
+private:
+    WiFiConnectRecord nvsRecord;
+    bool nvsLoaded;
+    
+    static uint32_t computeChecksum(const WiFiConnectRecord& record);
+    static uint32_t hashSSID(const char* ssid);
+    static bool isValid(const WiFiConnectRecord& record);
+    
+public:
+    /**
+     * Constructor
+     */
+    WiFiConnectCache();
+    
+    /**
+     * Load the cached connection record
+     * @param record destination record
+     * @return true if a valid record for the configured SSID exists
+     */
+    bool load(WiFiConnectRecord& record);
+    
+    /**
+     * Store a connection record (RTC always, NVS only if changed)
+     * @param record record to store (magic, hash and checksum are filled in)
+     */
+    void store(WiFiConnectRecord& record);
+    
+    /**
+     * Forget the cached record (after a failed fast connect)
+     */
+    void invalidate();
+};
+
+#endif // WIFI_CONNECT_CACHE_H
@@ -1,60 +1,270 @@
 #include "wifi_manager.h"
 #include "config.h"
 
-WiFiManager::WiFiManager() : isConnected(false), lastConnectionAttempt(0) {
+#define WIFI_OWN_LEAVE_WINDOW_MS 2000 // ASSOC_LEAVE this soon after our own disconnect is ours
+
+WiFiManager::WiFiManager() : state(WIFI_STATE_IDLE), lastConnectionAttempt(0),
+                             backoffDelay(WIFI_BACKOFF_MIN_MS), retryDelay(0), lastConnectDuration(0),
+                             connectAttempts(0), connectSuccesses(0), connectFailures(0),
+                             disconnectCount(0), fastAttempt(false), fastConnectDisabled(false),
+                             lastConnectWasFast(false), firstConnectTime(0),
+                             fastConnectSuccesses(0), fastConnectFailures(0), gotIpPending(false), disconnectPending(false),
+                             lastDisconnectReason(0), ownLeaveTime(0),
+                             scanInProgress(false), lastScanStart(0), scanFailures(0) {
 }
 
 bool WiFiManager::begin() {
     WiFi.mode(WIFI_STA);
+    
+    // Reconnects are owned by the state machine, not the driver
+    WiFi.setAutoReconnect(false);
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        handleEvent(event, info);
+    });
+    
     return connect();
 }
 
+void WiFiManager::handleEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    // Runs in the WiFi event task - only flag the event here
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            gotIpPending = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // WiFi.disconnect(), and WiFi.begin() dropping the previous
+            // attempt, report ASSOC_LEAVE asynchronously - often after the
+            // next attempt started. It is not that attempt's failure
+            if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE &&
+                millis() - ownLeaveTime < WIFI_OWN_LEAVE_WINDOW_MS) {
+                break;
+            }
+            lastDisconnectReason = info.wifi_sta_disconnected.reason;
+            disconnectPending = true;
+            break;
+        default:
+            break;
+    }
+}
+
 bool WiFiManager::connect() {
-    Serial.print("Connecting to WiFi");
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    
-    // Set DNS servers to help with DNS resolution
-    IPAddress dns1(8, 8, 8, 8);       // Google DNS
-    IPAddress dns2(1, 1, 1, 1);       // Cloudflare DNS
-    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE, dns1, dns2);
-    
-    unsigned long startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && 
-           millis() - startTime < WIFI_CONNECTION_TIMEOUT) {
-        delay(WIFI_RETRY_DELAY);
-        Serial.print(".");
+    if (state == WIFI_STATE_CONNECTING || state == WIFI_STATE_CONNECTED) {
+        return false;
     }
     
-    if (WiFi.status() == WL_CONNECTED) {
-        isConnected = true;
-        Serial.println("\nWiFi Connected!");
-        printNetworkInfo();
+    // Not over a running scan - update() starts the attempt when it ends
+    if (scanInProgress) {
+        state = WIFI_STATE_IDLE;
         return true;
+    }
+    
+    startAttempt();
+    return true;
+}
+
+void WiFiManager::startAttempt() {
+    gotIpPending = false;
+    disconnectPending = false;
+    
+    WiFiConnectRecord cached;
+    fastAttempt = !fastConnectDisabled && connectCache.load(cached);
+    
+    // IP configuration must be in place before WiFi.begin() starts DHCP
+    ownLeaveTime = millis();
+    if (fastAttempt) {
+        Serial.printf("Connecting to WiFi (fast: ch%d, cached IP)...\n", cached.channel);
+        WiFi.config(IPAddress(cached.localIP), IPAddress(cached.gateway), IPAddress(cached.subnet),
+                    IPAddress(cached.dns1), IPAddress(cached.dns2));
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cached.channel, cached.bssid);
     } else {
-        isConnected = false;
-        Serial.println("\nWiFi Connection Failed!");
-        return false;
+        Serial.println("Connecting to WiFi...");
+        
+        // Set DNS servers to help with DNS resolution
+        IPAddress dns1(8, 8, 8, 8);       // Google DNS
+        IPAddress dns2(1, 1, 1, 1);       // Cloudflare DNS
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE, dns1, dns2);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     }
+    
+    state = WIFI_STATE_CONNECTING;
+    lastConnectionAttempt = millis();
+    connectAttempts++;
 }
 
-bool WiFiManager::isWiFiConnected() {
-    bool connected = WiFi.status() == WL_CONNECTED;
-    if (isConnected != connected) {
-        isConnected = connected;
-        if (!connected) {
-            Serial.println("WiFi connection lost!");
+void WiFiManager::enterBackoff(unsigned long delayMs) {
+    state = WIFI_STATE_BACKOFF;
+    retryDelay = delayMs;
+    lastConnectionAttempt = millis();
+    
+    DEBUG_PRINTF("WiFi retry in %lu ms\n", retryDelay);
+}
+
+void WiFiManager::recordFailure() {
+    connectFailures++;
+    
+    if (fastAttempt) {
+        // Cached AP or lease is no longer usable - fall back to a full connect now
+        fastConnectFailures++;
+        fastConnectDisabled = true;
+        connectCache.invalidate();
+        Serial.println("Fast reconnect failed - falling back to full connect");
+        enterBackoff(0);
+        return;
+    }
+    
+    enterBackoff(backoffDelay);
+    backoffDelay = min(backoffDelay * 2, (unsigned long)WIFI_BACKOFF_MAX_MS);
+}
+
+bool WiFiManager::attemptDue(unsigned long now) {
+    return state == WIFI_STATE_IDLE ||
+           (state == WIFI_STATE_BACKOFF && now - lastConnectionAttempt >= retryDelay);
+}
+
+void WiFiManager::update() {
+    unsigned long now = millis();
+    
+    if (disconnectPending) {
+        disconnectPending = false;
+        
+        if (state == WIFI_STATE_CONNECTED) {
+            disconnectCount++;
+            Serial.printf("WiFi connection lost! (reason %d)\n", lastDisconnectReason);
+            // First retry after a drop happens right away
+            enterBackoff(0);
+        } else if (state == WIFI_STATE_CONNECTING) {
+            Serial.printf("WiFi Connection Failed! (reason %d)\n", lastDisconnectReason);
+            recordFailure();
+        }
+    }
+    
+    if (gotIpPending) {
+        gotIpPending = false;
+        
+        if (state != WIFI_STATE_CONNECTED) {
+            state = WIFI_STATE_CONNECTED;
+            connectSuccesses++;
+            lastConnectDuration = now - lastConnectionAttempt;
+            lastConnectWasFast = fastAttempt;
+            backoffDelay = WIFI_BACKOFF_MIN_MS;
+            if (firstConnectTime == 0) {
+                firstConnectTime = now;
+            }
+            if (fastAttempt) {
+                fastConnectSuccesses++;
+            }
+            Serial.printf("WiFi Connected! (%s, %lu ms)\n", fastAttempt ? "fast" : "full", lastConnectDuration);
+            printNetworkInfo();
+            saveConnectCache();
         }
     }
-    return connected;
+    
+    // A running scan holds the radio off-channel and delays association
+    // (the fast path only has WIFI_FAST_CONNECT_TIMEOUT) - start once it ends
+    if (scanInProgress && attemptDue(now)) {
+        return;
+    }
+    
+    switch (state) {
+        case WIFI_STATE_IDLE:
+            startAttempt();
+            break;
+        
+        case WIFI_STATE_CONNECTING:
+            if (now - lastConnectionAttempt >= (fastAttempt ? WIFI_FAST_CONNECT_TIMEOUT : WIFI_CONNECTION_TIMEOUT)) {
+                Serial.println("WiFi Connection Failed! (timeout)");
+                // Its ASSOC_LEAVE event is dropped in handleEvent()
+                ownLeaveTime = millis();
+                WiFi.disconnect();
+                recordFailure();
+            }
+            break;
+        
+        case WIFI_STATE_BACKOFF:
+            if (now - lastConnectionAttempt >= retryDelay) {
+                startAttempt();
+            }
+            break;
+        
+        case WIFI_STATE_CONNECTED:
+            break;
+    }
+}
+
+bool WiFiManager::isWiFiConnected() {
+    return state == WIFI_STATE_CONNECTED && WiFi.status() == WL_CONNECTED;
 }
 
 void WiFiManager::reconnect() {
-    if (!isWiFiConnected()) {
-        Serial.println("Attempting to reconnect WiFi...");
-        connect();
+    // Never blocks - just advances the state machine
+    update();
+}
+
+WiFiConnectionState WiFiManager::getState() {
+    return state;
+}
+
+const char* WiFiManager::getStateString() {
+    switch (state) {
+        case WIFI_STATE_IDLE:       return "IDLE";
+        case WIFI_STATE_CONNECTING: return "CONNECTING";
+        case WIFI_STATE_CONNECTED:  return "CONNECTED";
+        default:                    return "BACKOFF";
     }
 }
 
+uint32_t WiFiManager::getConnectAttempts() {
+    return connectAttempts;
+}
+
+uint32_t WiFiManager::getConnectSuccesses() {
+    return connectSuccesses;
+}
+
+uint32_t WiFiManager::getConnectFailures() {
+    return connectFailures;
+}
+
+uint32_t WiFiManager::getDisconnectCount() {
+    return disconnectCount;
+}
+
+unsigned long WiFiManager::getLastConnectDuration() {
+    return lastConnectDuration;
+}
+
+unsigned long WiFiManager::getFirstConnectTime() {
+    return firstConnectTime;
+}
+
+bool WiFiManager::wasLastConnectFast() {
+    return lastConnectWasFast;
+}
+
+void WiFiManager::saveConnectCache() {
+    uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) {
+        return;
+    }
+    
+    WiFiConnectRecord record;
+    memcpy(record.bssid, bssid, sizeof(record.bssid));
+    record.channel = WiFi.channel();
+    record.localIP = WiFi.localIP();
+    record.gateway = WiFi.gatewayIP();
+    record.subnet = WiFi.subnetMask();
+    record.dns1 = WiFi.dnsIP(0);
+    record.dns2 = WiFi.dnsIP(1);
+    connectCache.store(record);
+    
+    // A full connect refreshed the cache - the fast path may be used again
+    fastConnectDisabled = false;
+}
+
+uint8_t WiFiManager::getLastDisconnectReason() {
+    return lastDisconnectReason;
+}
+
 int WiFiManager::scanNetworks() {
     Serial.println("Scanning WiFi networks...");
     int networkCount = WiFi.scanNetworks();
@@ -65,9 +275,90 @@ int WiFiManager::scanNetworks() {
                      i + 1, WiFi.SSID(i).c_str(), WiFi.RSSI(i));
     }
     
+    mergeScanResults(networkCount);
+    
     return networkCount;
 }
 
+bool WiFiManager::startScan() {
+    if (scanInProgress) {
+        return false;
+    }
+    
+    // Non-blocking scan - results are collected by updateScan()
+    int16_t result = WiFi.scanNetworks(true);
+    lastScanStart = millis();
+    
+    if (result == WIFI_SCAN_FAILED) {
+        scanFailures++;
+        DEBUG_PRINTLN("⚠️  WiFi scan could not be started");
+        return false;
+    }
+    
+    scanInProgress = true;
+    return true;
+}
+
+bool WiFiManager::updateScan() {
+    if (!scanInProgress) {
+        // The driver rejects a scan while associating; a due attempt goes first
+        unsigned long now = millis();
+        if (state == WIFI_STATE_CONNECTING || attemptDue(now)) {
+            return false;
+        }
+        if (lastScanStart == 0 || now - lastScanStart >= WIFI_SCAN_INTERVAL) {
+            startScan();
+        }
+        return false;
+    }
+    
+    int16_t result = WiFi.scanComplete();
+    if (result == WIFI_SCAN_RUNNING) {
+        return false;
+    }
+    
+    scanInProgress = false;
+    
+    if (result < 0) {
+        scanFailures++;
+        DEBUG_PRINTLN("⚠️  WiFi scan failed");
+        return false;
+    }
+    
+    mergeScanResults(result);
+    return true;
+}
+
+void WiFiManager::mergeScanResults(int networkCount) {
+    if (networkCount < 0) {
+        return;
+    }
+    
+    uint32_t now = millis();
+    scanTable.beginCycle();
+    
+    for (int i = 0; i < networkCount; i++) {
+        scanTable.upsert(WiFi.BSSID(i), WiFi.SSID(i).c_str(), WiFi.RSSI(i), WiFi.channel(i), now);
+    }
+    
+    scanTable.endCycle(now);
+    
+    // Release driver-side result memory
+    WiFi.scanDelete();
+    
+    DEBUG_PRINTF("WiFi scan: %d networks (+%d -%d ~%d)\n", scanTable.size(),
+                 scanTable.getLastDiff().appeared, scanTable.getLastDiff().disappeared,
+                 scanTable.getLastDiff().rssiChanged);
+}
+
+bool WiFiManager::isScanInProgress() {
+    return scanInProgress;
+}
+
+const WiFiScanTable& WiFiManager::getScanTable() {
+    return scanTable;
+}
+
 String WiFiManager::getNetworkSSID(int index) {
     return WiFi.SSID(index);
 }
@@ -87,3 +378,44 @@ void WiFiManager::printNetworkInfo() {
     DEBUG_PRINTF("DNS: %s\n", WiFi.dnsIP().toString().c_str());
     DEBUG_PRINTF("RSSI: %d dBm\n", WiFi.RSSI());
 }
+
+void WiFiManager::printScanTable() {
+    const WiFiScanDiff& diff = scanTable.getLastDiff();
+    
+    Serial.println("--- WiFi Scan Table ---");
+    Serial.printf("Networks: %d | Cycles: %lu | Failures: %lu\n", scanTable.size(),
+                 (unsigned long)scanTable.getCycleCount(), (unsigned long)scanFailures);
+    Serial.printf("Last Cycle: +%d appeared, -%d disappeared, ~%d RSSI changed\n",
+                 diff.appeared, diff.disappeared, diff.rssiChanged);
+    
+    char bssid[18];
+    for (int i = 0; i < scanTable.size(); i++) {
+        const WiFiNetworkEntry& entry = scanTable.getEntry(i);
+        WiFiScanTable::formatBssid(entry.bssid, bssid);
+        Serial.printf("  %s ch%-2d %4d dBm %s%s\n", bssid, entry.channel, entry.rssi,
+                     entry.ssid, (entry.flags & WIFI_ENTRY_APPEARED) ? " (new)" : "");
+    }
+    
+    Serial.println("---");
+}
+
+void WiFiManager::printConnectionInfo() {
+    Serial.println("--- WiFi Connection ---");
+    Serial.printf("State: %s\n", getStateString());
+    Serial.printf("Attempts: %lu | Successes: %lu | Failures: %lu | Drops: %lu\n",
+                 (unsigned long)connectAttempts, (unsigned long)connectSuccesses,
+                 (unsigned long)connectFailures, (unsigned long)disconnectCount);
+    Serial.printf("Last Connect Time: %lu ms (%s)\n", lastConnectDuration, lastConnectWasFast ? "fast" : "full");
+    Serial.printf("First Connect After Boot: %lu ms\n", firstConnectTime);
+    Serial.printf("Fast Reconnects: %lu ok / %lu failed\n",
+                 (unsigned long)fastConnectSuccesses, (unsigned long)fastConnectFailures);
+    Serial.printf("Last Disconnect Reason: %d\n", lastDisconnectReason);
+    if (state == WIFI_STATE_BACKOFF) {
+        unsigned long elapsed = millis() - lastConnectionAttempt;
+        Serial.printf("Next Attempt In: %lu ms\n", elapsed < retryDelay ? retryDelay - elapsed : 0);
+    }
+    if (state == WIFI_STATE_CONNECTED) {
+        Serial.printf("IP: %s | RSSI: %d dBm\n", WiFi.localIP().toString().c_str(), WiFi.RSSI());
+    }
+    Serial.println("---");
+}
@@ -4,23 +4,88 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include "config.h"
+#include "wifi_scan_table.h"
+#include "wifi_connect_cache.h"
+
+// Connection state machine states
+enum WiFiConnectionState : uint8_t {
+    WIFI_STATE_IDLE = 0,     // No attempt running yet
+    WIFI_STATE_CONNECTING,   // WiFi.begin() issued, waiting for GOT_IP
+    WIFI_STATE_CONNECTED,    // Associated and holding an IP address
+    WIFI_STATE_BACKOFF       // Waiting before the next attempt
+};
 
 class WiFiManager {
 private:
-    bool isConnected;
+    // Connection state machine (advanced by update() from the owning task)
+    WiFiConnectionState state;
     unsigned long lastConnectionAttempt;
+    unsigned long backoffDelay;      // Delay applied after the next failed attempt
+    unsigned long retryDelay;        // Delay of the current backoff period
+    unsigned long lastConnectDuration;
+    uint32_t connectAttempts;
+    uint32_t connectSuccesses;
+    uint32_t connectFailures;
+    uint32_t disconnectCount;
+    
+    // Fast reconnect (cached BSSID/channel/static IP)
+    WiFiConnectCache connectCache;
+    bool fastAttempt;                // Current attempt uses the cached parameters
+    bool fastConnectDisabled;        // Cached parameters failed - use full connects
+    bool lastConnectWasFast;
+    unsigned long firstConnectTime;  // millis() of the first connection after boot
+    uint32_t fastConnectSuccesses;
+    uint32_t fastConnectFailures;
+    
+    // Set from the WiFi event task, consumed by update()
+    volatile bool gotIpPending;
+    volatile bool disconnectPending;
+    volatile uint8_t lastDisconnectReason;
+    volatile unsigned long ownLeaveTime;  // millis() of our last WiFi.disconnect()/begin()
     
+    void handleEvent(arduino_event_id_t event, arduino_event_info_t info);
+    void startAttempt();
+    void enterBackoff(unsigned long delayMs);
+    void recordFailure();
+    bool attemptDue(unsigned long now);
+    void saveConnectCache();
+    
+    // Asynchronous scan state
+    WiFiScanTable scanTable;
+    bool scanInProgress;
+    unsigned long lastScanStart;
+    uint32_t scanFailures;
+    
+    void mergeScanResults(int networkCount);
+
 public:
     WiFiManager();
     bool begin();
     bool connect();
     bool isWiFiConnected();
     void reconnect();
+    void update();
+    WiFiConnectionState getState();
+    const char* getStateString();
+    uint32_t getConnectAttempts();
+    uint32_t getConnectSuccesses();
+    uint32_t getConnectFailures();
+    uint32_t getDisconnectCount();
+    unsigned long getLastConnectDuration();
+    unsigned long getFirstConnectTime();
+    bool wasLastConnectFast();
+    uint8_t getLastDisconnectReason();
     int scanNetworks();
+    bool startScan();
+    bool updateScan();
+    bool isScanInProgress();
+    const WiFiScanTable& getScanTable();
     String getNetworkSSID(int index);
     int getNetworkRSSI(int index);
     IPAddress getLocalIP();
     void printNetworkInfo();
+    void printConnectionInfo();
+    void printScanTable();
 };
 
 #endif // WIFI_MANAGER_H
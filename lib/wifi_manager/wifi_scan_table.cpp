@@ -0,0 +1,142 @@
+#include "wifi_scan_table.h"
+
+static uint64_t packBssid(const uint8_t* bssid) {
+    uint64_t key = 0;
+    for (int i = 0; i < 6; i++) {
+        key = (key << 8) | bssid[i];
+    }
+    return key;
+}
+
+WiFiScanTable::WiFiScanTable() {
+    entryCount = 0;
+    cycleCount = 0;
+    lastCycleTime = 0;
+    memset(&lastDiff, 0, sizeof(lastDiff));
+    memset(&pendingDiff, 0, sizeof(pendingDiff));
+}
+
+int WiFiScanTable::findEntry(uint64_t bssid) const {
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].bssid == bssid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int WiFiScanTable::findWeakestEntry() const {
+    int weakest = -1;
+    for (int i = 0; i < entryCount; i++) {
+        if (weakest < 0 || entries[i].rssi < entries[weakest].rssi) {
+            weakest = i;
+        }
+    }
+    return weakest;
+}
+
+void WiFiScanTable::removeEntry(int index) {
+    // Order is not significant - move the last entry into the hole
+    entryCount--;
+    if (index != entryCount) {
+        entries[index] = entries[entryCount];
+    }
+}
+
+void WiFiScanTable::beginCycle() {
+    for (int i = 0; i < entryCount; i++) {
+        entries[i].flags = 0;
+    }
+    memset(&pendingDiff, 0, sizeof(pendingDiff));
+}
+
+void WiFiScanTable::upsert(const uint8_t* bssid, const char* ssid, int rssi, int channel, uint32_t now) {
+    if (!bssid) {
+        return;
+    }
+    
+    uint64_t key = packBssid(bssid);
+    int index = findEntry(key);
+    
+    if (index < 0) {
+        if (entryCount < WIFI_SCAN_TABLE_SIZE) {
+            index = entryCount++;
+        } else {
+            // Table full - only a stronger network may take the weakest slot
+            index = findWeakestEntry();
+            if (rssi <= entries[index].rssi) {
+                return;
+            }
+            if (pendingDiff.disappearedCount < WIFI_SCAN_TABLE_SIZE) {
+                pendingDiff.disappearedBssids[pendingDiff.disappearedCount++] = entries[index].bssid;
+            }
+            pendingDiff.disappeared++;
+        }
+        
+        WiFiNetworkEntry& entry = entries[index];
+        entry.bssid = key;
+        entry.reportedRssi = rssi;
+        entry.firstSeen = now;
+        entry.flags = WIFI_ENTRY_APPEARED;
+        pendingDiff.appeared++;
+    }
+    
+    WiFiNetworkEntry& entry = entries[index];
+    strncpy(entry.ssid, ssid ? ssid : "", sizeof(entry.ssid) - 1);
+    entry.ssid[sizeof(entry.ssid) - 1] = '\0';
+    entry.rssi = rssi;
+    entry.channel = channel;
+    entry.lastSeen = now;
+    entry.flags |= WIFI_ENTRY_SEEN;
+    
+    int delta = rssi - entry.reportedRssi;
+    if (!(entry.flags & WIFI_ENTRY_APPEARED) && abs(delta) >= WIFI_RSSI_CHANGE_THRESHOLD) {
+        entry.flags |= WIFI_ENTRY_RSSI_CHANGED;
+        entry.reportedRssi = rssi;
+        pendingDiff.rssiChanged++;
+    }
+}
+
+void WiFiScanTable::endCycle(uint32_t now) {
+    // Expire networks that have not been seen for a while
+    for (int i = entryCount - 1; i >= 0; i--) {
+        if (!(entries[i].flags & WIFI_ENTRY_SEEN) && now - entries[i].lastSeen >= WIFI_NETWORK_EXPIRY_MS) {
+            if (pendingDiff.disappearedCount < WIFI_SCAN_TABLE_SIZE) {
+                pendingDiff.disappearedBssids[pendingDiff.disappearedCount++] = entries[i].bssid;
+            }
+            pendingDiff.disappeared++;
+            removeEntry(i);
+        }
+    }
+    
+    lastDiff = pendingDiff;
+    lastCycleTime = now;
+    cycleCount++;
+}
+
+int WiFiScanTable::size() const {
+    return entryCount;
+}
+
+const WiFiNetworkEntry& WiFiScanTable::getEntry(int index) const {
+    return entries[index];
+}
+
+const WiFiScanDiff& WiFiScanTable::getLastDiff() const {
+    return lastDiff;
+}
+
+uint32_t WiFiScanTable::getCycleCount() const {
+    return cycleCount;
+}
+
+uint32_t WiFiScanTable::getLastCycleTime() const {
+    return lastCycleTime;
+}
+
+void WiFiScanTable::formatBssid(uint64_t bssid, char* buffer) {
+    snprintf(buffer, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
+             (unsigned)((bssid >> 40) & 0xFF), (unsigned)((bssid >> 32) & 0xFF),
+             (unsigned)((bssid >> 24) & 0xFF), (unsigned)((bssid >> 16) & 0xFF),
+             (unsigned)((bssid >> 8) & 0xFF), (unsigned)(bssid & 0xFF));
+}
@@ -0,0 +1,124 @@
+#ifndef WIFI_SCAN_TABLE_H
+#define WIFI_SCAN_TABLE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * One access point tracked by the scan table
+ */
+struct WiFiNetworkEntry {
+    uint64_t bssid;          // 48-bit BSSID packed into the low bytes (table key)
+    char ssid[33];           // Zero-terminated SSID (max 32 chars)
+    int8_t rssi;             // Latest RSSI in dBm
+    int8_t reportedRssi;     // RSSI at the last reported change (diff reference)
+    uint8_t channel;
+    uint8_t flags;           // WIFI_ENTRY_* flags for the latest cycle
+    uint32_t firstSeen;      // millis() when first seen
+    uint32_t lastSeen;       // millis() when last seen
+};
+
+// Per-cycle entry flags
+#define WIFI_ENTRY_SEEN          0x01
+#define WIFI_ENTRY_APPEARED      0x02
+#define WIFI_ENTRY_RSSI_CHANGED  0x04
+
+/**
+ * Changes produced by the latest completed scan cycle
+ */
+struct WiFiScanDiff {
+    uint8_t appeared;
+    uint8_t disappeared;
+    uint8_t rssiChanged;
+    uint8_t disappearedCount;                             // entries stored below
+    uint64_t disappearedBssids[WIFI_SCAN_TABLE_SIZE];
+};
+
+/**
+ * WiFiScanTable Class
+ * 
+ * Preallocated table of access points keyed by BSSID. Scan results are merged
+ * cycle by cycle; each cycle produces a diff (appeared, disappeared, RSSI moved
+ * beyond WIFI_RSSI_CHANGE_THRESHOLD). When the table is full the weakest entry
+ * is replaced by a stronger newcomer.
+ */
+class WiFiScanTable {
+private:
+    WiFiNetworkEntry entries[WIFI_SCAN_TABLE_SIZE];
+    uint8_t entryCount;
+    WiFiScanDiff lastDiff;
+    WiFiScanDiff pendingDiff;
+    uint32_t cycleCount;
+    uint32_t lastCycleTime;
+    
+    int findEntry(uint64_t bssid) const;
+    int findWeakestEntry() const;
+    void removeEntry(int index);
+    
+public:
+    /**
+     * Constructor
+     */
+    WiFiScanTable();
+    
+    /**
+     * Start merging a new scan cycle (clears per-cycle flags)
+     */
+    void beginCycle();
+    
+    /**
+     * Insert or update one scan result
+     * @param bssid 6-byte BSSID
+     * @param ssid network name
+     * @param rssi signal strength in dBm
+     * @param channel WiFi channel
+     * @param now current millis()
+     */
+    void upsert(const uint8_t* bssid, const char* ssid, int rssi, int channel, uint32_t now);
+    
+    /**
+     * Finish a scan cycle: expire stale entries and publish the cycle diff
+     * @param now current millis()
+     */
+    void endCycle(uint32_t now);
+    
+    /**
+     * Get number of tracked networks
+     * @return entry count
+     */
+    int size() const;
+    
+    /**
+     * Get tracked network by position
+     * @param index 0..size()-1
+     * @return entry reference
+     */
+    const WiFiNetworkEntry& getEntry(int index) const;
+    
+    /**
+     * Get changes from the latest completed cycle
+     * @return diff of the last cycle
+     */
+    const WiFiScanDiff& getLastDiff() const;
+    
+    /**
+     * Get number of completed scan cycles
+     * @return cycle count
+     */
+    uint32_t getCycleCount() const;
+    
+    /**
+     * Get time of the latest completed cycle
+     * @return millis() timestamp (0 if no cycle completed)
+     */
+    uint32_t getLastCycleTime() const;
+    
+    /**
+     * Format a packed BSSID as "AA:BB:CC:DD:EE:FF"
+     * @param bssid packed BSSID
+     * @param buffer destination (at least 18 bytes)
+     */
+    static void formatBssid(uint64_t bssid, char* buffer);
+};
+
+#endif // WIFI_SCAN_TABLE_H
@@ -11,8 +11,13 @@
  * - Power state monitoring with debouncing and statistics
  * - WiFi network scanning and mapping  
  * - Real-time Firebase data storage
+ * - Store-and-forward sample journal on LittleFS for offline periods
+ * - Circle and polygon geofences with immediate enter/exit/dwell reports
+ * - Route between samples as a simplified, polyline-encoded track
+ * - WiFi fingerprint position fallback learned while GPS has a fix
  * - Web dashboard with interactive map
  * - Comprehensive status monitoring
+ * - Sensor and network work split across pinned FreeRTOS tasks
  * 
  * Hardware:
  * - ESP32 DevKit v1
@@ -30,15 +35,26 @@
 #include "firebase_client.h"
 #include "gps_manager.h"
 #include "optocoupler_manager.h"
+#include "power_channels.h"
+#include "voltage_monitor.h"
+#include "task_runtime.h"
+#include "sample_journal.h"
+#include "geofence.h"
+#include "track_recorder.h"
+#include "wifi_fingerprint.h"
 
 // Global objects
 WiFiManager wifiManager;
 FirebaseClient firebaseClient;
 GPSManager gpsManager;
 OptocouplerManager optocouplerManager;
-
-// Timing variables
-unsigned long lastDataSend = 0;
+PowerChannels powerChannels;
+VoltageMonitor voltageMonitor;
+SampleJournal sampleJournal;
+GeofenceEngine geofenceEngine;
+TrackRecorder trackRecorder;
+WiFiFingerprintDb wifiFingerprints;
+TaskRuntime taskRuntime;
 
 void setup() {
     Serial.begin(SERIAL_BAUD_RATE);
@@ -58,7 +74,30 @@ void setup() {
     } else {
         Serial.println("❌ Optocoupler initialization failed");
     }
-    
+
+#if POWER_CHANNELS_ENABLED
+    // Initialize multi-channel power detection
+    Serial.println("Initializing power channels...");
+    static const int8_t channelPins[] = POWER_CHANNEL_PINS;
+    if (powerChannels.begin(channelPins, sizeof(channelPins), POWER_CHANNEL_ACTIVE_LOW)) {
+        Serial.printf("✅ %d power channels initialized\n", powerChannels.size());
+        taskRuntime.attachPowerChannels(&powerChannels);
+    } else {
+        Serial.println("❌ Power channel initialization failed");
+    }
+#endif
+
+#if VOLTAGE_MONITOR_ENABLED
+    // Start continuous line voltage sampling (own task, ADC DMA)
+    Serial.println("Initializing line voltage sampling...");
+    if (voltageMonitor.begin()) {
+        Serial.println("✅ Line voltage sampling running");
+        taskRuntime.attachVoltageMonitor(&voltageMonitor);
+    } else {
+        Serial.println("❌ Line voltage sampling failed to start");
+    }
+#endif
+
     // Initialize GPS manager
     Serial.println("Initializing GPS module...");
     if (gpsManager.begin(&Serial2, GPS_BAUDRATE)) {
@@ -67,13 +106,13 @@ void setup() {
         Serial.println("❌ GPS module initialization failed");
     }
     
-    // Connect to WiFi
+    // Connect to WiFi (non-blocking - completes in the network task)
     Serial.println("Starting WiFi connection...");
     
     if (wifiManager.begin()) {
-        Serial.println("✅ WiFi connection successful");
+        Serial.println("✅ WiFi connection started");
     } else {
-        Serial.println("❌ WiFi connection failed - entering retry mode");
+        Serial.println("❌ WiFi connection could not be started - entering retry mode");
     }
     
     // Initialize Firebase client
@@ -84,100 +123,55 @@ void setup() {
         Serial.println("❌ Firebase client initialization failed");
     }
     
-    Serial.println("\n🚀 System ready - starting main loop\n");
-}
-
-void loop() {
-    // Handle serial commands
-    if (Serial.available()) {
-        char command = Serial.read();
-        if (command == 'g' || command == 'G') {
-            Serial.println("Printing GPS status...");
-            gpsManager.printGPSStatus();
-        } else if (command == 'i' || command == 'I') {
-            Serial.println("Printing GPS debug info...");
-            gpsManager.printDebugInfo();
-        } else if (command == 'p' || command == 'P') {
-            Serial.println("Printing power status...");
-            optocouplerManager.printStatus();
-        } else if (command == 'o' || command == 'O') {
-            Serial.println("Printing power debug info...");
-            optocouplerManager.printDebugInfo();
-        } else if (command == 'r' || command == 'R') {
-            Serial.println("Resetting power statistics...");
-            optocouplerManager.resetStatistics();
-        }
+    // Mount the offline sample journal
+    Serial.println("Initializing sample journal...");
+    if (sampleJournal.begin()) {
+        Serial.println("✅ Sample journal ready");
+        firebaseClient.attachJournal(&sampleJournal);
+    } else {
+        Serial.println("❌ Sample journal unavailable - offline samples will be lost");
     }
-    
-    // Check WiFi connection
-    if (!wifiManager.isWiFiConnected()) {
-        wifiManager.reconnect();
+
+#if GEOFENCE_ENABLED
+    // Load geofences from the filesystem the journal mounted
+    Serial.println("Loading geofences...");
+    if (geofenceEngine.begin()) {
+        Serial.printf("✅ %d geofences loaded\n", geofenceEngine.size());
+        taskRuntime.attachGeofences(&geofenceEngine);
+    } else {
+        Serial.println("❌ No geofences loaded");
     }
-    
-    // Update GPS data
-    gpsManager.update();
-    
-    // Update optocoupler data
-    if (optocouplerManager.update()) {
-        // Power state changed - show brief message
-        Serial.printf("🔌 Power: %s\n", optocouplerManager.getPowerStatusString().c_str());
+#endif
+
+#if TRACK_ENABLED
+    // Route between samples, simplified before it is queued
+    taskRuntime.attachTrackRecorder(&trackRecorder);
+    Serial.printf("✅ Track recording enabled (%d m tolerance)\n", TRACK_TOLERANCE_M);
+#endif
+
+#if WIFI_FINGERPRINT_ENABLED
+    // Fingerprint slots live next to the journal on LittleFS
+    Serial.println("Loading WiFi fingerprints...");
+    if (wifiFingerprints.begin()) {
+        Serial.printf("✅ %d WiFi fingerprints loaded\n", wifiFingerprints.size());
+        taskRuntime.attachWiFiFingerprints(&wifiFingerprints);
+    } else {
+        Serial.println("❌ WiFi fingerprints unavailable - default coordinates without GPS");
     }
-    
-    // Periodic data transmission
-    if (millis() - lastDataSend >= SENSOR_READ_INTERVAL) {
-        lastDataSend = millis();
-        
-        // Scan WiFi networks
-        Serial.println("\n--- Data Transmission ---");
-        int networkCount = wifiManager.scanNetworks();
-        
-        // Send data to Firebase
-        if (wifiManager.isWiFiConnected()) {
-            bool success = firebaseClient.sendData(
-                networkCount,
-                &wifiManager,
-                &gpsManager,         // Pass GPS manager to Firebase client
-                &optocouplerManager  // Pass optocoupler manager to Firebase client
-            );
-            
-            if (success) {
-                Serial.println("✅ Data sent to database");
-            } else {
-                Serial.println("❌ Data transmission failed");
-            }
-        } else {
-            Serial.println("❌ No WiFi - skipping transmission");
-        }
-        
-        // Print compact system status
-        Serial.println("--- Status ---");
-        Serial.printf("Uptime: %lu min | Heap: %u KB | WiFi: %s\n", 
-                     millis()/60000, ESP.getFreeHeap()/1024, 
-                     wifiManager.isWiFiConnected() ? "✓" : "✗");
-        
-        // Compact power status
-        Serial.printf("Power: %s", optocouplerManager.getPowerStatusString().c_str());
-        if (optocouplerManager.getStateChangeCount() > 0) {
-            unsigned long totalTime = optocouplerManager.getTotalPowerOnTime() + optocouplerManager.getTotalPowerOffTime();
-            if (totalTime > 0) {
-                float uptime = (float)optocouplerManager.getTotalPowerOnTime() / totalTime * 100.0;
-                Serial.printf(" (%.1f%% uptime)", uptime);
-            }
-        }
-        Serial.println();
-        
-        // Compact GPS status
-        if (gpsManager.isLocationValid()) {
-            Serial.printf("GPS: %.4f,%.4f (%d sats)\n", 
-                         gpsManager.getLatitude(), gpsManager.getLongitude(),
-                         gpsManager.getSatelliteCount());
-        } else {
-            Serial.printf("GPS: %s\n", gpsManager.isGPSActive() ? "Searching..." : "Inactive");
-        }
-        
-        Serial.println("Commands: g=GPS p=Power o=Debug r=Reset | ----\n");
+#endif
+
+    // Start sensor and network tasks
+    Serial.println("Starting task runtime...");
+    if (taskRuntime.begin(&wifiManager, &firebaseClient, &gpsManager, &optocouplerManager, &sampleJournal)) {
+        Serial.println("✅ Sensor and network tasks running");
+    } else {
+        Serial.println("❌ Task runtime failed to start");
     }
     
-    // Small delay to prevent watchdog issues
-    delay(100);
+    Serial.println("\n🚀 System ready - tasks running\n");
+}
+
+void loop() {
+    // All work happens in the sensor and network tasks
+    vTaskDelete(NULL);
 }
@@ -0,0 +1,377 @@
+#!/usr/bin/env python3
+"""
+Expand compact (CBOR) samples back to the JSON shape written in JSON mode.
+
+Input is the /iot-data-compact node, either exported from the Firebase
+console or fetched over REST:
+
+    python3 tools/decode_compact.py export.json
+    python3 tools/decode_compact.py --url https://<db>.firebaseio.com --auth <secret>
+
+Add --stats to print bytes per sample: compact as stored vs the equivalent
+JSON payload. The field tables mirror lib/firebase_client/payload_schema.h.
+"""
+
+import argparse
+import base64
+import json
+import sys
+import urllib.request
+
+SCHEMA_VERSIONS = (1, 2)
+
+# Device constants dropped from the compact payload (include/config.h)
+OPTOCOUPLER_PIN = 34
+OPTOCOUPLER_ACTIVE_LOW = True
+OPTOCOUPLER_DEBOUNCE_MS = 50
+DEFAULT_LATITUDE = 52.5200
+DEFAULT_LONGITUDE = 13.4050
+
+FIELD_SCHEMA, FIELD_TIMESTAMP, FIELD_POWER, FIELD_SYSTEM, FIELD_GPS, FIELD_NETWORKS, FIELD_REPORT, FIELD_VOLTAGE = range(8)
+FIELD_GEOFENCE, FIELD_TRACK, FIELD_WIFI_LOCATION = 8, 9, 10
+
+# Report-by-exception groups (lib/sensor_sample/sensor_sample.h)
+REPORT_FIELD_POWER = 0x01
+REPORT_FIELD_LOCATION = 0x02
+REPORT_FIELD_GPS = 0x04
+REPORT_FIELD_NETWORKS = 0x08
+REPORT_FIELD_SYSTEM = 0x10
+REPORT_FIELD_GEOFENCE = 0x20
+REPORT_FIELD_TRACK = 0x40
+REPORT_FIELD_ALL = 0x7F
+REPORT_HEARTBEAT = 0x80
+
+POWER_FIELDS = {
+    1: "status_boolean",
+    2: "stability",
+    3: "time_since_change",
+    4: "state_changes",
+    5: "total_on_time",
+    6: "total_off_time",
+    7: "last_power_on",
+    8: "last_power_off",
+}
+POWER_OUTAGES, POWER_OUTAGE_WINDOWS, POWER_MAINS = 9, 10, 11
+OUTAGE_WINDOWS = ("minute", "hour", "day")
+
+SYSTEM_FIELDS = {
+    1: "uptime_ms",
+    2: "free_heap",
+    3: "wifi_connected",
+    4: "wifi_connect_attempts",
+    5: "wifi_disconnects",
+    6: "wifi_connect_ms",
+    7: "wifi_connect_fast",
+    8: "wifi_first_connect_ms",
+    9: "sample_sequence",
+    10: "boot_id",
+    11: "batch_samples",
+    12: "batch_bytes",
+    13: "batch_latency_ms",
+    14: "replayed",
+    15: "journal_pending",
+    16: "journal_dropped",
+    17: "http_connect_ms",
+    18: "http_ttfb_ms",
+    19: "http_total_ms",
+    20: "http_reused",
+    21: "http_heap_used",
+    22: "tls_handshakes",
+    23: "wifi_networks_detected",
+    24: "wifi_networks_appeared",
+    25: "wifi_networks_disappeared",
+    26: "wifi_rssi_changes",
+}
+
+GPS_ACTIVE, GPS_LOCATION_VALID, GPS_TIME_VALID, GPS_QUALITY, GPS_SATELLITES = range(1, 6)
+GPS_LATITUDE_E7, GPS_LONGITUDE_E7, GPS_ALTITUDE_CM, GPS_SPEED_CMH = range(6, 10)
+GPS_DATETIME, GPS_TIME_SINCE_UPDATE = 10, 11
+GPS_FILTERED_LATITUDE_E7, GPS_FILTERED_LONGITUDE_E7, GPS_FILTERED_ACCURACY_MM = range(12, 15)
+GPS_VELOCITY_NORTH_MMS, GPS_VELOCITY_EAST_MMS = 15, 16
+GPS_MOTION, GPS_TTFF_MS, GPS_START_AID = 17, 18, 19
+
+STABILITY_NAMES = ["STABLE", "SETTLING", "UNSTABLE"]
+QUALITY_NAMES = ["NO_SIGNAL", "POOR", "FAIR", "GOOD", "EXCELLENT"]
+MOTION_NAMES = ["UNKNOWN", "MOVING", "PARKED"]
+GEOFENCE_EVENT_NAMES = ["ENTER", "EXIT", "DWELL"]
+AID_NAMES = ["none", "position", "time", "position+time",
+             "ephemeris", "position+ephemeris", "time+ephemeris", "position+time+ephemeris"]
+
+_BREAK = object()
+
+
+class CborReader:
+    """Decoder for the CBOR subset the firmware emits."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def _byte(self):
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def _argument(self, info):
+        if info < 24:
+            return info
+        size = {24: 1, 25: 2, 26: 4, 27: 8}[info]
+        value = int.from_bytes(self.data[self.pos:self.pos + size], "big")
+        self.pos += size
+        return value
+
+    def read(self):
+        initial = self._byte()
+        if initial == 0xFF:
+            return _BREAK
+        major, info = initial >> 5, initial & 0x1F
+
+        if major == 7:
+            return {20: False, 21: True, 22: None}[info]
+
+        if info == 31:
+            items = []
+            while True:
+                item = self.read()
+                if item is _BREAK:
+                    break
+                items.append(item)
+            if major == 4:
+                return items
+            if major == 5:
+                return dict(zip(items[0::2], items[1::2]))
+            raise ValueError("unsupported indefinite item")
+
+        value = self._argument(info)
+        if major == 0:
+            return value
+        if major == 1:
+            return -1 - value
+        if major in (2, 3):
+            raw = self.data[self.pos:self.pos + value]
+            self.pos += value
+            return bytes(raw) if major == 2 else raw.decode("utf-8", "replace")
+        if major == 4:
+            return [self.read() for _ in range(value)]
+        if major == 5:
+            return {self.read(): self.read() for _ in range(value)}
+        raise ValueError("unsupported major type %d" % major)
+
+
+def signal_strength(rssi):
+    return "STRONG" if rssi > -50 else ("MEDIUM" if rssi > -70 else "WEAK")
+
+
+def expand(raw):
+    """Compact sample map -> dict in the JSON payload shape."""
+    if raw.get(FIELD_SCHEMA) not in SCHEMA_VERSIONS:
+        raise ValueError("unknown schema version %r" % raw.get(FIELD_SCHEMA))
+
+    # Version 1 samples always carried every group
+    mask = raw.get(FIELD_REPORT, REPORT_FIELD_ALL)
+    sample = {"timestamp": raw[FIELD_TIMESTAMP]}
+    if mask & REPORT_FIELD_SYSTEM:
+        sample["datetime"] = None
+    sample["report"] = {"fields": mask & REPORT_FIELD_ALL, "heartbeat": bool(mask & REPORT_HEARTBEAT)}
+
+    power = raw.get(FIELD_POWER)
+    if not mask & REPORT_FIELD_POWER:
+        pass
+    elif power is not None:
+        out = {POWER_FIELDS[k]: v for k, v in power.items() if k in POWER_FIELDS}
+        if POWER_OUTAGE_WINDOWS in power:
+            outages = {"since_boot": power.get(POWER_OUTAGES, 0)}
+            for name, (count, total, longest, flickers) in zip(OUTAGE_WINDOWS, power[POWER_OUTAGE_WINDOWS]):
+                outages[name] = {
+                    "count": count,
+                    "total_ms": total,
+                    "longest_ms": longest,
+                    "mean_ms": total // count if count else 0,
+                    "flickers": flickers,
+                }
+            out["outages"] = outages
+        if POWER_MAINS in power:
+            frequency, sags, missing, dropouts, last, longest = power[POWER_MAINS]
+            out["mains"] = {
+                "frequency_hz": frequency / 1000.0 if frequency else None,
+                "sags": sags,
+                "missing_cycles": missing,
+                "dropouts": dropouts,
+                "last_dropout_ms": last,
+                "longest_dropout_ms": longest,
+            }
+        out = dict(status="ON" if out["status_boolean"] else "OFF", **out)
+        out["stability"] = STABILITY_NAMES[min(out["stability"], 2)]
+        total = out["total_on_time"] + out["total_off_time"]
+        out["uptime_percentage"] = round(out["total_on_time"] / total * 100.0, 2) if total else 0.0
+        out["source"] = "OPTOCOUPLER"
+        out["config"] = "Pin=%d, ActiveLow=%s, Debounce=%dms" % (
+            OPTOCOUPLER_PIN, "YES" if OPTOCOUPLER_ACTIVE_LOW else "NO", OPTOCOUPLER_DEBOUNCE_MS)
+        sample["external_power"] = out
+    else:
+        sample["external_power"] = {"status": "UNKNOWN", "status_boolean": False, "source": "NOT_INITIALIZED"}
+
+    voltage = raw.get(FIELD_VOLTAGE)
+    if mask & REPORT_FIELD_POWER and voltage is not None:
+        rms, min_rms, max_rms, min_raw, max_raw, sags, swells, last_event, overruns = voltage
+        sample["external_power"]["value"] = round(rms / 1000.0, 1)
+        sample["external_power"]["voltage"] = {
+            "rms_v": round(rms / 1000.0, 1),
+            "min_rms_v": round(min_rms / 1000.0, 1),
+            "max_rms_v": round(max_rms / 1000.0, 1),
+            "min_raw": min_raw,
+            "max_raw": max_raw,
+            "sags": sags,
+            "swells": swells,
+            "last_event_ms": last_event,
+            "overruns": overruns,
+        }
+
+    if mask & REPORT_FIELD_SYSTEM:
+        system = {SYSTEM_FIELDS[k]: v for k, v in raw.get(FIELD_SYSTEM, {}).items() if k in SYSTEM_FIELDS}
+        system.setdefault("wifi_networks_detected", 0)
+        sample["system"] = system
+
+    gps = raw.get(FIELD_GPS)
+    fix = gps is not None and gps.get(GPS_LOCATION_VALID)
+    if mask & REPORT_FIELD_LOCATION:
+        if fix:
+            sample["location"] = {
+                "lat": gps[GPS_LATITUDE_E7] / 1e7,
+                "lng": gps[GPS_LONGITUDE_E7] / 1e7,
+                "source": "GPS",
+            }
+            if GPS_FILTERED_LATITUDE_E7 in gps:
+                sample["location"]["filtered"] = {
+                    "lat": gps[GPS_FILTERED_LATITUDE_E7] / 1e7,
+                    "lng": gps[GPS_FILTERED_LONGITUDE_E7] / 1e7,
+                    "accuracy_m": gps[GPS_FILTERED_ACCURACY_MM] / 1000.0,
+                    "velocity_north_ms": gps[GPS_VELOCITY_NORTH_MMS] / 1000.0,
+                    "velocity_east_ms": gps[GPS_VELOCITY_EAST_MMS] / 1000.0,
+                }
+        elif FIELD_WIFI_LOCATION in raw:
+            lat, lon, accuracy, neighbours = raw[FIELD_WIFI_LOCATION]
+            sample["location"] = {
+                "lat": lat / 1e7,
+                "lng": lon / 1e7,
+                "source": "WIFI",
+                "accuracy_m": accuracy,
+                "fingerprints": neighbours,
+            }
+        else:
+            sample["location"] = {"lat": DEFAULT_LATITUDE, "lng": DEFAULT_LONGITUDE, "source": "DEFAULT"}
+
+    if not mask & REPORT_FIELD_GPS:
+        pass
+    elif fix:
+        info = {
+            "altitude": gps[GPS_ALTITUDE_CM] / 100.0,
+            "speed_kmh": gps[GPS_SPEED_CMH] / 100.0,
+            "satellites": gps[GPS_SATELLITES],
+            "signal_quality": QUALITY_NAMES[min(gps[GPS_QUALITY], 4)],
+            "motion": MOTION_NAMES[min(gps.get(GPS_MOTION, 0), 2)],
+        }
+        if GPS_DATETIME in gps:
+            info["gps_time"] = "%04d-%02d-%02d %02d:%02d:%02d" % tuple(gps[GPS_DATETIME])
+        else:
+            info["gps_time"] = "INVALID"
+        info["time_since_update"] = gps[GPS_TIME_SINCE_UPDATE]
+        info["active"] = gps[GPS_ACTIVE]
+        info["time_valid"] = gps[GPS_TIME_VALID]
+        info["ttff_ms"] = gps.get(GPS_TTFF_MS, 0)
+        info["start_aid"] = AID_NAMES[gps.get(GPS_START_AID, 0) & 0x07]
+        sample["gps_info"] = info
+    elif gps is not None:
+        sample["gps_info"] = {
+            "active": gps[GPS_ACTIVE],
+            "satellites": gps[GPS_SATELLITES],
+            "signal_quality": QUALITY_NAMES[min(gps[GPS_QUALITY], 4)],
+            "time_since_update": gps[GPS_TIME_SINCE_UPDATE],
+            "ttff_ms": gps.get(GPS_TTFF_MS, 0),
+            "start_aid": AID_NAMES[gps.get(GPS_START_AID, 0) & 0x07],
+        }
+    else:
+        sample["gps_info"] = {"active": False, "status": "GPS_NOT_INITIALIZED"}
+
+    events = raw.get(FIELD_GEOFENCE)
+    if mask & REPORT_FIELD_GEOFENCE and events:
+        sample["geofence_events"] = [{
+            "fence": fence,
+            "event": GEOFENCE_EVENT_NAMES[min(event, 2)],
+            "age_ms": age,
+            "lat": lat / 1e7,
+            "lng": lon / 1e7,
+            "inside_ms": inside,
+        } for fence, event, age, lat, lon, inside in events]
+
+    track = raw.get(FIELD_TRACK)
+    if mask & REPORT_FIELD_TRACK and track:
+        polyline, points, fixes, start_age, duration, tolerance = track
+        sample["track"] = {
+            "polyline": polyline,
+            "points": points,
+            "fixes": fixes,
+            "tolerance_m": tolerance / 100.0,
+            "start_age_ms": start_age,
+            "duration_ms": duration,
+        }
+
+    networks = raw.get(FIELD_NETWORKS)
+    if networks:
+        sample["wifi_networks"] = [{
+            "ssid": ssid,
+            "bssid": ":".join("%02X" % b for b in bssid),
+            "channel": channel,
+            "rssi": rssi,
+            "signal_strength": signal_strength(rssi),
+        } for bssid, rssi, channel, ssid in networks]
+
+    return sample
+
+
+def load(args):
+    if args.url:
+        url = args.url.rstrip("/") + "/iot-data-compact.json"
+        if args.auth:
+            url += "?auth=" + args.auth
+        with urllib.request.urlopen(url) as response:
+            return json.load(response) or {}
+    with open(args.input) as handle:
+        data = json.load(handle)
+    # Accept either the node itself or a whole-database export
+    return data.get("iot-data-compact", data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="Firebase JSON export")
+    parser.add_argument("--url", help="database URL to fetch /iot-data-compact from")
+    parser.add_argument("--auth", help="database secret or ID token for --url")
+    parser.add_argument("--stats", action="store_true", help="print bytes per sample instead of samples")
+    args = parser.parse_args()
+    if not args.input and not args.url:
+        parser.error("give an export file or --url")
+
+    expanded = {}
+    compact_bytes = 0
+    json_bytes = 0
+    for key, encoded in sorted(load(args).items()):
+        sample = expand(CborReader(base64.b64decode(encoded)).read())
+        expanded[key] = sample
+        compact_bytes += len(encoded) + 2
+        json_bytes += len(json.dumps(sample, separators=(",", ":")))
+
+    if args.stats:
+        count = max(len(expanded), 1)
+        print("samples: %d" % len(expanded))
+        print("compact: %.0f bytes/sample" % (compact_bytes / count))
+        print("json:    %.0f bytes/sample" % (json_bytes / count))
+        if json_bytes:
+            print("ratio:   %.0f%%" % (compact_bytes * 100.0 / json_bytes))
+    else:
+        json.dump(expanded, sys.stdout, indent=2)
+        print()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,266 @@
+/*
+ * Host throughput benchmark: NMEA through TinyGPS++ vs UBX NAV-PVT through
+ * lib/ubx_protocol, using the same per-fix field reads as GPSManager.
+ *
+ * Build from the repository root after a PlatformIO build has fetched
+ * TinyGPS++ into .pio/libdeps:
+ *
+ *   TGPS=.pio/libdeps/esp32dev/TinyGPSPlus/src
+ *   g++ -O2 -DARDUINO=100 -Itools/gps_parse_bench -Ilib/ubx_protocol -Ilib/gps_manager -I$TGPS \
+ *       tools/gps_parse_bench/gps_parse_bench.cpp lib/ubx_protocol/ubx_protocol.cpp \
+ *       $TGPS/TinyGPS++.cpp -o gps_parse_bench
+ *   ./gps_parse_bench [epochs]
+ *
+ * Three streams of identical solutions are timed: the NEO-6M default NMEA
+ * set, GGA+RMC only (GPS_UBX_CONFIG) and NAV-PVT (GPS_PROTOCOL_UBX).
+ *
+ * The per-fix pipeline after parsing (unit conversion, deadband distance,
+ * formatting) is timed twice: the earlier double code and the int32
+ * fixed-point code from gps_fixed.h. The host has a double precision FPU,
+ * so this understates the gap on the ESP32, where double is emulated.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <TinyGPS++.h>
+#include "ubx_protocol.h"
+#include "gps_fixed.h"
+
+static void appendSentence(std::string& out, const char* body) {
+    uint8_t checksum = 0;
+    for (const char* c = body; *c; c++) {
+        checksum ^= (uint8_t)*c;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), "$%s*%02X\r\n", body, checksum);
+    out += line;
+}
+
+static void appendNmeaEpoch(std::string& out, int epoch, bool defaultSet) {
+    int hour = 12 + epoch / 18000 % 12;
+    int minute = epoch / 300 % 60;
+    int second = epoch / 5 % 60;
+    int centi = epoch % 5 * 20;
+    double minutesLat = 7.03812 + (epoch % 100) * 0.00001;
+    char body[100];
+    
+    snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d.%02d,A,48%08.5f,N,01131.00000,E,0.022,,230394,,,A",
+             hour, minute, second, centi, minutesLat);
+    appendSentence(out, body);
+    if (defaultSet) {
+        snprintf(body, sizeof(body), "GPVTG,,T,,M,0.022,N,0.041,K,A");
+        appendSentence(out, body);
+    }
+    snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.%02d,48%08.5f,N,01131.00000,E,1,08,0.9,545.4,M,46.9,M,,",
+             hour, minute, second, centi, minutesLat);
+    appendSentence(out, body);
+    if (defaultSet) {
+        appendSentence(out, "GPGSA,A,3,04,05,09,12,24,25,29,31,,,,,1.8,0.9,1.5");
+        appendSentence(out, "GPGSV,3,1,10,04,36,074,42,05,13,298,36,09,21,222,39,12,63,291,44");
+        appendSentence(out, "GPGSV,3,2,10,24,48,152,45,25,29,059,40,29,12,300,33,31,09,142,31");
+        appendSentence(out, "GPGSV,3,3,10,02,05,032,,20,02,181,");
+        snprintf(body, sizeof(body), "GPGLL,48%08.5f,N,01131.00000,E,%02d%02d%02d.%02d,A,A",
+                 minutesLat, hour, minute, second, centi);
+        appendSentence(out, body);
+    }
+}
+
+static void appendPvtEpoch(std::string& out, int epoch) {
+    UbxNavPvt pvt = {};
+    pvt.iTOW = 302400000 + epoch * 200;
+    pvt.year = 1994;
+    pvt.month = 3;
+    pvt.day = 23;
+    pvt.hour = 12 + epoch / 18000 % 12;
+    pvt.min = epoch / 300 % 60;
+    pvt.sec = epoch / 5 % 60;
+    pvt.valid = UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME;
+    pvt.fixType = UBX_FIX_3D;
+    pvt.flags = UBX_PVT_GNSS_FIX_OK;
+    pvt.numSV = 8;
+    pvt.lat = 481173020 + epoch % 100 * 2;
+    pvt.lon = 115166667;
+    pvt.hMSL = 545400;
+    pvt.gSpeed = 11;
+    
+    uint8_t frame[UBX_NAV_PVT_LEN + UBX_FRAME_OVERHEAD];
+    size_t size = ubxBuildFrame(frame, sizeof(frame), UBX_CLASS_NAV, UBX_NAV_PVT,
+                                (const uint8_t*)&pvt, sizeof(pvt));
+    out.append((const char*)frame, size);
+}
+
+struct Result {
+    uint32_t fixes;
+    double sink;
+};
+
+static Result runNmea(const std::string& stream) {
+    TinyGPSPlus gps;
+    Result result = {0, 0.0};
+    for (char c : stream) {
+        if (gps.encode(c) && gps.location.isValid()) {
+            // The per-sentence reads GPSManager::publishFix() does
+            result.fixes++;
+            result.sink += gps.location.lat() + gps.location.lng() +
+                           gps.altitude.meters() + gps.speed.kmph() + gps.satellites.value();
+        }
+    }
+    return result;
+}
+
+static Result runUbx(const std::string& stream) {
+    UbxParser parser;
+    UbxNavPvt pvt;
+    Result result = {0, 0.0};
+    for (char c : stream) {
+        if (parser.feed((uint8_t)c) && ubxDecodeNavPvt(parser, pvt)) {
+            // The conversions GPSManager::publishPvt() does
+            result.fixes++;
+            result.sink += pvt.lat * 1e-7 + pvt.lon * 1e-7 + pvt.hMSL / 1000.0 +
+                           pvt.gSpeed * 0.0036 + pvt.numSV;
+        }
+    }
+    return result;
+}
+
+template <typename Run>
+static void bench(const char* name, const std::string& stream, int epochs, Run run) {
+    using namespace std::chrono;
+    const int rounds = 20;
+    double best = 1e30;
+    Result result = {0, 0.0};
+    
+    for (int i = 0; i < rounds; i++) {
+        steady_clock::time_point start = steady_clock::now();
+        result = run(stream);
+        double elapsed = duration<double, std::nano>(steady_clock::now() - start).count();
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    
+    printf("%-14s %7.1f B/epoch %9.1f ns/epoch %6.2f ns/B %8.1f MB/s  (%u fix updates, sink %.0f)\n",
+           name, (double)stream.size() / epochs, best / epochs, best / stream.size(),
+           stream.size() / best * 1000.0, result.fixes, result.sink);
+}
+
+/**
+ * Parsed fields in TinyGPS++'s raw form, the input to both pipelines
+ */
+struct RawFix {
+    RawDegrees lat;
+    RawDegrees lng;
+    int32_t altitudeCm;
+    int32_t speedKnots100;
+};
+
+static Result pipelineDouble(const std::vector<RawFix>& fixes) {
+    Result result = {0, 0.0};
+    double lastLat = 0.0;
+    double lastLng = 0.0;
+    char text[96];
+    
+    for (const RawFix& fix : fixes) {
+        // TinyGPS++ lat()/lng()/meters()/kmph()
+        double lat = (fix.lat.deg + fix.lat.billionths / 1000000000.0) * (fix.lat.negative ? -1 : 1);
+        double lng = (fix.lng.deg + fix.lng.billionths / 1000000000.0) * (fix.lng.negative ? -1 : 1);
+        double altitude = fix.altitudeCm / 100.0;
+        double speed = fix.speedKnots100 / 100.0 * 1.852;
+        
+        // Previous ReportFilter::locationChanged()
+        double lat1 = radians(lastLat);
+        double lat2 = radians(lat);
+        double x = radians(lng - lastLng) * cos((lat1 + lat2) / 2.0);
+        double y = lat2 - lat1;
+        double distance = sqrt(x * x + y * y) * 6371000.0;
+        if (distance >= 25) {
+            lastLat = lat;
+            lastLng = lng;
+            result.fixes++;
+        }
+        
+        int length = snprintf(text, sizeof(text), "%.7f,%.7f,%.2f,%.2f", lat, lng, altitude, speed);
+        result.sink += length;
+    }
+    return result;
+}
+
+static Result pipelineFixed(const std::vector<RawFix>& fixes) {
+    Result result = {0, 0.0};
+    int32_t lastLat = 0;
+    int32_t lastLng = 0;
+    const uint64_t deadbandCm = 2500;
+    char text[4][16];
+    
+    for (const RawFix& fix : fixes) {
+        int32_t lat = gpsRawToE7(fix.lat.deg, fix.lat.billionths, fix.lat.negative);
+        int32_t lng = gpsRawToE7(fix.lng.deg, fix.lng.billionths, fix.lng.negative);
+        int32_t altitudeMm = fix.altitudeCm * 10;
+        int32_t speedMms = gpsKnotsHundredthsToMms(fix.speedKnots100);
+        
+        if (gpsDistanceSqCm2(lastLat, lastLng, lat, lng) >= deadbandCm * deadbandCm) {
+            lastLat = lat;
+            lastLng = lng;
+            result.fixes++;
+        }
+        
+        result.sink += gpsFormatFixed(text[0], sizeof(text[0]), lat, 7);
+        result.sink += gpsFormatFixed(text[1], sizeof(text[1]), lng, 7);
+        result.sink += gpsFormatFixed(text[2], sizeof(text[2]), gpsDivRound(altitudeMm, 10), 2);
+        result.sink += gpsFormatFixed(text[3], sizeof(text[3]), gpsDivRound(speedMms * 36, 100), 2);
+    }
+    return result;
+}
+
+template <typename Run>
+static void benchPipeline(const char* name, const std::vector<RawFix>& fixes, Run run) {
+    using namespace std::chrono;
+    double best = 1e30;
+    Result result = {0, 0.0};
+    
+    for (int i = 0; i < 20; i++) {
+        steady_clock::time_point start = steady_clock::now();
+        result = run(fixes);
+        double elapsed = duration<double, std::nano>(steady_clock::now() - start).count();
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    
+    printf("%-14s %9.1f ns/fix  (%u deadband crossings, sink %.0f)\n",
+           name, best / fixes.size(), result.fixes, result.sink);
+}
+
+int main(int argc, char** argv) {
+    int epochs = argc > 1 ? atoi(argv[1]) : 10000;
+    std::string nmeaDefault;
+    std::string nmeaFiltered;
+    std::string ubx;
+    
+    for (int i = 0; i < epochs; i++) {
+        appendNmeaEpoch(nmeaDefault, i, true);
+        appendNmeaEpoch(nmeaFiltered, i, false);
+        appendPvtEpoch(ubx, i);
+    }
+    
+    printf("%d epochs, best of 20 runs\n", epochs);
+    bench("NMEA default", nmeaDefault, epochs, runNmea);
+    bench("NMEA GGA+RMC", nmeaFiltered, epochs, runNmea);
+    bench("UBX NAV-PVT", ubx, epochs, runUbx);
+    
+    // A walk north-east in ~5 m steps, restarting every 2000 fixes
+    std::vector<RawFix> fixes(epochs);
+    for (int i = 0; i < epochs; i++) {
+        fixes[i].lat = {48, 117302000u + (uint32_t)(i % 2000) * 45000, false};
+        fixes[i].lng = {11, 516666000u + (uint32_t)(i % 2000) * 60000, false};
+        fixes[i].altitudeCm = 54540 + i % 50;
+        fixes[i].speedKnots100 = 972 + i % 30;
+    }
+    
+    printf("\nPer-fix pipeline (conversion, deadband distance, formatting)\n");
+    benchPipeline("double", fixes, pipelineDouble);
+    benchPipeline("int32 fixed", fixes, pipelineFixed);
+    return 0;
+}